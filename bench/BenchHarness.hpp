@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Bench {
+
+    // Run `fn` until at least `minSeconds` have elapsed (and at least `minIters` times)
+    // and return the median time of one call in milliseconds.
+    template <typename Fn>
+    double MedianMs(Fn&& fn, double minSeconds = 0.25, int minIters = 5) {
+        using Clock = std::chrono::steady_clock;
+        fn(); // warmup
+
+        std::vector<double> samples;
+        auto start = Clock::now();
+        while (static_cast<int>(samples.size()) < minIters ||
+               std::chrono::duration<double>(Clock::now() - start).count() < minSeconds) {
+            auto t0 = Clock::now();
+            fn();
+            samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+}
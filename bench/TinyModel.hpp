@@ -0,0 +1,148 @@
+#pragma once
+
+// Builds a tiny super-resolution ONNX model in memory, so benchmarks can exercise
+// real ONNX Runtime inference without shipping model files.
+//
+// Graph: input [N, 3, H, W] -> Conv 3x3 (3 -> 3*s*s channels) -> DepthToSpace(s) -> output.
+// The convolution copies each input channel to every sub-pixel of its output block,
+// so the model computes an exact nearest-neighbour upscale (same result as the stub).
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Bench {
+
+    namespace Proto {
+
+        // Minimal protobuf wire-format writer (varint and length-delimited fields only).
+        inline void Varint(std::string& out, uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<char>(v | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<char>(v));
+        }
+
+        inline void Tag(std::string& out, int field, int wireType) {
+            Varint(out, (static_cast<uint64_t>(field) << 3) | wireType);
+        }
+
+        inline void Int(std::string& out, int field, int64_t v) {
+            Tag(out, field, 0);
+            Varint(out, static_cast<uint64_t>(v));
+        }
+
+        inline void Bytes(std::string& out, int field, const std::string& bytes) {
+            Tag(out, field, 2);
+            Varint(out, bytes.size());
+            out += bytes;
+        }
+
+    }
+
+    namespace Onnx {
+
+        // Field numbers and enums from onnx.proto
+        inline std::string IntAttribute(const std::string& name, int64_t value) {
+            std::string a;
+            Proto::Bytes(a, 1, name);
+            Proto::Int(a, 3, value);
+            Proto::Int(a, 20, 2); // AttributeProto::INT
+            return a;
+        }
+
+        inline std::string IntsAttribute(const std::string& name, const std::vector<int64_t>& values) {
+            std::string a;
+            Proto::Bytes(a, 1, name);
+            for (int64_t v : values) Proto::Int(a, 8, v);
+            Proto::Int(a, 20, 7); // AttributeProto::INTS
+            return a;
+        }
+
+        inline std::string Node(const std::vector<std::string>& inputs, const std::string& output,
+                                const std::string& opType, const std::vector<std::string>& attributes) {
+            std::string n;
+            for (const auto& in : inputs) Proto::Bytes(n, 1, in);
+            Proto::Bytes(n, 2, output);
+            Proto::Bytes(n, 3, opType + "_0");
+            Proto::Bytes(n, 4, opType);
+            for (const auto& a : attributes) Proto::Bytes(n, 5, a);
+            return n;
+        }
+
+        inline std::string FloatTensor(const std::string& name, const std::vector<int64_t>& dims, const std::vector<float>& data) {
+            std::string t;
+            for (int64_t d : dims) Proto::Int(t, 1, d);
+            Proto::Int(t, 2, 1); // TensorProto::FLOAT
+            Proto::Bytes(t, 8, name);
+            std::string raw(data.size() * sizeof(float), '\0');
+            std::memcpy(&raw[0], data.data(), raw.size()); // Little-endian, as ONNX expects
+            Proto::Bytes(t, 9, raw);
+            return t;
+        }
+
+        // Float NCHW value with 3 channels and symbolic batch/height/width
+        inline std::string ImageValueInfo(const std::string& name) {
+            std::string shape;
+            for (const char* dim : {"N", "C", "H", "W"}) {
+                std::string d;
+                if (std::string(dim) == "C") Proto::Int(d, 1, 3);
+                else Proto::Bytes(d, 2, std::string(name) + "_" + dim);
+                Proto::Bytes(shape, 1, d);
+            }
+            std::string tensorType;
+            Proto::Int(tensorType, 1, 1); // FLOAT
+            Proto::Bytes(tensorType, 2, shape);
+            std::string type;
+            Proto::Bytes(type, 1, tensorType);
+
+            std::string v;
+            Proto::Bytes(v, 1, name);
+            Proto::Bytes(v, 2, type);
+            return v;
+        }
+
+    }
+
+    // Serialized ModelProto of the tiny x`scale` model (opset 13).
+    inline std::string BuildTinyUpscaleModel(int scale) {
+        int blocks = scale * scale;
+        int outChannels = 3 * blocks;
+
+        // DepthToSpace (DCR): output channel c at sub-pixel (i, j) reads depth (i * scale + j) * 3 + c
+        std::vector<float> weights(static_cast<size_t>(outChannels) * 3 * 3 * 3, 0.0f);
+        for (int block = 0; block < blocks; ++block) {
+            for (int c = 0; c < 3; ++c) {
+                int oc = block * 3 + c;
+                weights[((static_cast<size_t>(oc) * 3 + c) * 3 + 1) * 3 + 1] = 1.0f; // Kernel center
+            }
+        }
+        std::vector<float> bias(outChannels, 0.0f);
+
+        std::string graph;
+        Proto::Bytes(graph, 1, Onnx::Node({"input", "conv_w", "conv_b"}, "features", "Conv",
+                                          {Onnx::IntsAttribute("kernel_shape", {3, 3}),
+                                           Onnx::IntsAttribute("pads", {1, 1, 1, 1})}));
+        Proto::Bytes(graph, 1, Onnx::Node({"features"}, "output", "DepthToSpace",
+                                          {Onnx::IntAttribute("blocksize", scale)}));
+        Proto::Bytes(graph, 2, "tiny_upscale");
+        Proto::Bytes(graph, 5, Onnx::FloatTensor("conv_w", {outChannels, 3, 3, 3}, weights));
+        Proto::Bytes(graph, 5, Onnx::FloatTensor("conv_b", {outChannels}, bias));
+        Proto::Bytes(graph, 11, Onnx::ImageValueInfo("input"));
+        Proto::Bytes(graph, 12, Onnx::ImageValueInfo("output"));
+
+        std::string opset;
+        Proto::Bytes(opset, 1, "");
+        Proto::Int(opset, 2, 13);
+
+        std::string model;
+        Proto::Int(model, 1, 7); // IR version
+        Proto::Bytes(model, 2, "enhancer-bench");
+        Proto::Bytes(model, 7, graph);
+        Proto::Bytes(model, 8, opset);
+        return model;
+    }
+
+}
@@ -0,0 +1,124 @@
+// Microbenchmark: fused per-pixel kernels vs. the original OpenCV-based implementations.
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include "core/ImageUtils.hpp"
+#include "core/SimdKernels.hpp"
+#include "BenchHarness.hpp"
+
+namespace {
+
+    // Original ImageUtils::PreProcess: cvtColor, convertTo, split and copy.
+    std::vector<float> LegacyPreProcess(const cv::Mat& img) {
+        cv::Mat rgb;
+        cv::cvtColor(img, rgb, cv::COLOR_BGR2RGB);
+
+        cv::Mat float_img;
+        rgb.convertTo(float_img, CV_32F, 1.0 / 255.0);
+
+        std::vector<float> output;
+        output.reserve(img.channels() * img.rows * img.cols);
+
+        std::vector<cv::Mat> channels;
+        cv::split(float_img, channels);
+
+        for (const auto& c : channels) {
+            output.insert(output.end(), (float*)c.datastart, (float*)c.dataend);
+        }
+        return output;
+    }
+
+    // Original ImageUtils::PostProcess plus the copy into the canvas done by Engine.
+    void LegacyPostProcess(const float* outputData, int height, int width, cv::Mat canvasRoi) {
+        std::vector<cv::Mat> cv_channels;
+        int channel_size = height * width;
+        for (int i = 0; i < 3; ++i) {
+            cv_channels.push_back(cv::Mat(height, width, CV_32F, const_cast<float*>(outputData + i * channel_size)));
+        }
+
+        cv::Mat rgb;
+        cv::merge(cv_channels, rgb);
+        cv::threshold(rgb, rgb, 1.0, 1.0, cv::THRESH_TRUNC);
+        cv::threshold(rgb, rgb, 0.0, 0.0, cv::THRESH_TOZERO);
+
+        cv::Mat bgr;
+        cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+
+        cv::Mat final_img;
+        bgr.convertTo(final_img, CV_8U, 255.0);
+        final_img.copyTo(canvasRoi);
+    }
+
+    void BenchPostProcess(int tileSize, int scale) {
+        int outSize = tileSize * scale;
+        cv::Mat output(3 * outSize, outSize, CV_32F);
+        cv::randu(output, cv::Scalar::all(-0.1), cv::Scalar::all(1.1));
+        const float* data = output.ptr<float>(0);
+
+        cv::Mat canvas(outSize * 2, outSize * 2, CV_8UC3);
+        cv::Mat roi = canvas(cv::Rect(outSize / 2, outSize / 2, outSize, outSize));
+
+        double legacyMs = Bench::MedianMs([&] {
+            LegacyPostProcess(data, outSize, outSize, roi);
+        });
+
+        std::cout << "postprocess " << std::setw(4) << tileSize << " x" << scale << "  legacy  "
+                  << std::fixed << std::setprecision(3) << legacyMs << " ms" << std::endl;
+
+        for (Core::Simd::Level level : {Core::Simd::Level::Scalar, Core::Simd::Level::SSE41, Core::Simd::Level::AVX2}) {
+            if (level > Core::Simd::DetectedLevel()) continue;
+            Core::Simd::SetMaxLevel(level);
+            double fusedMs = Bench::MedianMs([&] {
+                Core::ImageUtils::PostProcessInto(data, outSize, outSize, cv::Rect(0, 0, outSize, outSize), roi);
+            });
+            std::cout << "postprocess " << std::setw(4) << tileSize << " x" << scale << "  " << std::setw(6) << std::left
+                      << Core::Simd::LevelName(level) << std::right << "  " << fusedMs << " ms  ("
+                      << std::setprecision(2) << legacyMs / fusedMs << "x)" << std::setprecision(3) << std::endl;
+        }
+        Core::Simd::SetMaxLevel(Core::Simd::Level::AVX2);
+    }
+
+    void BenchPreProcess(int tileSize) {
+        // Tiles are ROIs of a larger image, as in Engine::ProcessImage
+        cv::Mat image(tileSize * 2, tileSize * 2, CV_8UC3);
+        cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat tile = image(cv::Rect(tileSize / 2, tileSize / 2, tileSize, tileSize));
+
+        std::vector<float> buffer(static_cast<size_t>(3) * tileSize * tileSize);
+
+        double legacyMs = Bench::MedianMs([&] {
+            // Legacy path also needed the SplitTiles clone
+            std::vector<float> out = LegacyPreProcess(tile.clone());
+            (void)out;
+        });
+
+        std::cout << "preprocess " << std::setw(4) << tileSize << "  legacy  "
+                  << std::fixed << std::setprecision(3) << legacyMs << " ms" << std::endl;
+
+        for (Core::Simd::Level level : {Core::Simd::Level::Scalar, Core::Simd::Level::SSE41, Core::Simd::Level::AVX2}) {
+            if (level > Core::Simd::DetectedLevel()) continue;
+            Core::Simd::SetMaxLevel(level);
+            double fusedMs = Bench::MedianMs([&] {
+                Core::ImageUtils::PreProcessInto(tile, buffer.data());
+            });
+            std::cout << "preprocess " << std::setw(4) << tileSize << "  " << std::setw(6) << std::left
+                      << Core::Simd::LevelName(level) << std::right << "  " << fusedMs << " ms  ("
+                      << std::setprecision(2) << legacyMs / fusedMs << "x)" << std::setprecision(3) << std::endl;
+        }
+        Core::Simd::SetMaxLevel(Core::Simd::Level::AVX2);
+    }
+
+}
+
+int main() {
+    cv::setNumThreads(1); // Per-tile kernels run on one core each
+    std::cout << "SIMD level: " << Core::Simd::LevelName(Core::Simd::DetectedLevel()) << std::endl;
+
+    for (int tileSize : {256, 512}) {
+        BenchPreProcess(tileSize);
+    }
+    for (int tileSize : {256, 512}) {
+        BenchPostProcess(tileSize, 4);
+    }
+    return 0;
+}
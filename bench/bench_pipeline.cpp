@@ -0,0 +1,420 @@
+// Stage benchmarks for the whole enhancement pipeline, with JSON output so results can
+// be compared between releases. Runs headless and CPU-only: inference uses the stub
+// model and a tiny ONNX model generated at startup (see TinyModel.hpp).
+//
+// Usage: enhancer-bench [--quick] [--filter <stage>] [--json <file>] [--min-time <seconds>]
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "core/Engine.hpp"
+#include "core/ImageUtils.hpp"
+#include "core/InferenceSession.hpp"
+#include "core/SimdKernels.hpp"
+#include "core/TileBlender.hpp"
+#include "BenchHarness.hpp"
+#include "TinyModel.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    struct Config {
+        bool quick = false;
+        std::string filter;
+        std::string jsonPath;
+        double minSeconds = 0.25;
+
+        std::vector<cv::Size> imageSizes;
+        std::vector<int> tileSizes;
+        std::vector<int> overlaps;
+        std::vector<int> scales;
+    };
+
+    struct Result {
+        std::string stage;
+        std::vector<std::pair<std::string, std::string>> params;
+        double medianMs = 0;
+        double megapixels = 0; // Pixels handled per call, for throughput
+    };
+
+    using Params = std::vector<std::pair<std::string, std::string>>;
+
+    class Runner {
+    public:
+        explicit Runner(const Config& config) : config_(config) {}
+
+        bool Enabled(const std::string& stage) const {
+            return config_.filter.empty() || stage.find(config_.filter) != std::string::npos;
+        }
+
+        void Run(const std::string& stage, Params params, double megapixels, const std::function<void()>& fn) {
+            Result r;
+            r.stage = stage;
+            r.params = std::move(params);
+            r.megapixels = megapixels;
+            r.medianMs = Bench::MedianMs(fn, config_.minSeconds, config_.quick ? 3 : 5);
+
+            std::cout << std::left << std::setw(14) << stage;
+            for (const auto& p : r.params) std::cout << " " << p.first << "=" << p.second;
+            std::cout << std::right << "  " << std::fixed << std::setprecision(3) << r.medianMs << " ms";
+            if (megapixels > 0) std::cout << "  (" << std::setprecision(1) << megapixels / (r.medianMs / 1000.0) << " MP/s)";
+            std::cout << std::endl;
+            results_.push_back(std::move(r));
+        }
+
+        const std::vector<Result>& Results() const { return results_; }
+
+    private:
+        const Config& config_;
+        std::vector<Result> results_;
+    };
+
+    std::string Str(int v) { return std::to_string(v); }
+    std::string SizeStr(const cv::Size& s) { return Str(s.width) + "x" + Str(s.height); }
+    double Megapixels(const cv::Size& s) { return s.area() / 1e6; }
+
+    // Smooth, photo-like content (noise compresses unrealistically badly)
+    cv::Mat MakeImage(const cv::Size& size) {
+        cv::Mat small(std::max(2, size.height / 16), std::max(2, size.width / 16), CV_8UC3);
+        cv::randu(small, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat img;
+        cv::resize(small, img, size, 0, 0, cv::INTER_LINEAR);
+        return img;
+    }
+
+    // Very smooth content with textured (noisy) blocks on a checkerboard, so that some
+    // tiles have much more detail than others
+    cv::Mat MakeMixedImage(const cv::Size& size) {
+        cv::Mat small(std::max(2, size.height / 128), std::max(2, size.width / 128), CV_8UC3);
+        cv::randu(small, cv::Scalar::all(0), cv::Scalar::all(255));
+        cv::Mat img;
+        cv::resize(small, img, size, 0, 0, cv::INTER_LINEAR);
+        cv::Mat noise(size, CV_8UC3);
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(255));
+        const int block = 160;
+        for (int y = 0; y < size.height; ++y) {
+            uint8_t* dst = img.ptr<uint8_t>(y);
+            const uint8_t* src = noise.ptr<uint8_t>(y);
+            for (int x = 0; x < size.width; ++x) {
+                if ((x / block + y / block) % 2 == 0) continue;
+                for (int c = 0; c < 3; ++c) dst[3 * x + c] = static_cast<uint8_t>((dst[3 * x + c] + src[3 * x + c]) / 2);
+            }
+        }
+        return img;
+    }
+
+    double Psnr(const cv::Mat& reference, const cv::Mat& test) {
+        double sum = 0;
+        for (int y = 0; y < reference.rows; ++y) {
+            const uint8_t* a = reference.ptr<uint8_t>(y);
+            const uint8_t* b = test.ptr<uint8_t>(y);
+            for (int i = 0; i < reference.cols * reference.channels(); ++i) sum += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        double mse = sum / (static_cast<double>(reference.total()) * reference.channels());
+        return mse == 0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    // Model output of one tile: CHW floats in [0, 1]
+    std::vector<float> MakeTileOutput(int height, int width) {
+        cv::Mat planes(3 * height, width, CV_32F);
+        cv::randu(planes, cv::Scalar::all(0.0), cv::Scalar::all(1.0));
+        return std::vector<float>(planes.ptr<float>(0), planes.ptr<float>(0) + planes.total());
+    }
+
+    void BenchCodecs(Runner& runner, const Config& config, const fs::path& dir) {
+        for (const cv::Size& size : config.imageSizes) {
+            cv::Mat img = MakeImage(size);
+            for (std::string format : {"png", "jpg"}) {
+                fs::path path = dir / ("bench_" + SizeStr(size) + "." + format);
+                Params params = {{"size", SizeStr(size)}, {"format", format}};
+
+                if (runner.Enabled("SaveImage")) {
+                    runner.Run("SaveImage", params, Megapixels(size), [&]() { Core::ImageUtils::SaveImage(path.wstring(), img); });
+                }
+                Core::ImageUtils::SaveImage(path.wstring(), img);
+
+                if (runner.Enabled("LoadImage")) {
+                    runner.Run("LoadImage", params, Megapixels(size), [&]() { Core::ImageUtils::LoadImage(path.wstring()); });
+                }
+                if (runner.Enabled("imdecode")) {
+                    std::ifstream file(path, std::ios::binary);
+                    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    runner.Run("imdecode", params, Megapixels(size), [&]() { cv::imdecode(bytes, cv::IMREAD_COLOR); });
+                }
+            }
+        }
+    }
+
+    void BenchTiling(Runner& runner, const Config& config) {
+        for (const cv::Size& size : config.imageSizes) {
+            cv::Mat img = MakeImage(size);
+            for (int tile : config.tileSizes) {
+                for (int overlap : config.overlaps) {
+                    if (runner.Enabled("SplitTiles")) {
+                        runner.Run("SplitTiles", {{"size", SizeStr(size)}, {"tile", Str(tile)}, {"overlap", Str(overlap)}},
+                                   Megapixels(size), [&]() { Core::ImageUtils::SplitTiles(img, tile, overlap); });
+                    }
+                }
+            }
+        }
+    }
+
+    void BenchTileKernels(Runner& runner, const Config& config) {
+        for (int tile : config.tileSizes) {
+            cv::Mat img = MakeImage(cv::Size(tile, tile));
+            double mp = Megapixels(img.size());
+            if (runner.Enabled("PreProcess")) {
+                runner.Run("PreProcess", {{"tile", Str(tile)}}, mp, [&]() { Core::ImageUtils::PreProcess(img); });
+            }
+            for (int scale : config.scales) {
+                int outSize = tile * scale;
+                std::vector<float> output = MakeTileOutput(outSize, outSize);
+                if (runner.Enabled("PostProcess")) {
+                    runner.Run("PostProcess", {{"tile", Str(tile)}, {"scale", Str(scale)}}, Megapixels(cv::Size(outSize, outSize)),
+                               [&]() { Core::ImageUtils::PostProcess(output.data(), 3, outSize, outSize); });
+                }
+            }
+        }
+    }
+
+    void BenchInference(Runner& runner, const Config& config, const fs::path& dir) {
+        if (!runner.Enabled("Run")) return;
+        for (int scale : config.scales) {
+            // Stub: no ORT session at all; tiny: real ORT with a 3x3 conv + pixel shuffle
+            fs::path tinyPath = dir / ("tiny_x" + Str(scale) + ".onnx");
+            std::ofstream(tinyPath, std::ios::binary) << Bench::BuildTinyUpscaleModel(scale);
+
+            for (const auto& model : std::vector<std::pair<std::string, fs::path>>{{"stub", dir / "stub.onnx"}, {"tiny", tinyPath}}) {
+                Core::InferenceSession session;
+                if (!session.LoadModel(model.second.wstring())) {
+                    std::cerr << "Skipping Run/" << model.first << ": model failed to load." << std::endl;
+                    continue;
+                }
+                for (int tile : config.tileSizes) {
+                    std::vector<float> input = Core::ImageUtils::PreProcess(MakeImage(cv::Size(tile, tile)));
+                    std::vector<int64_t> dims = {1, 3, tile, tile};
+                    runner.Run("Run", {{"model", model.first}, {"tile", Str(tile)}, {"scale", Str(scale)}},
+                               Megapixels(cv::Size(tile, tile)), [&]() { session.Run(input, dims); });
+                }
+            }
+        }
+    }
+
+    void BenchMerge(Runner& runner, const Config& config) {
+        for (const cv::Size& size : config.imageSizes) {
+            for (int scale : config.scales) {
+                cv::Size outSize(size.width * scale, size.height * scale);
+                for (int tile : config.tileSizes) {
+                    for (int overlap : config.overlaps) {
+                        Params params = {{"size", SizeStr(size)}, {"tile", Str(tile)}, {"overlap", Str(overlap)}, {"scale", Str(scale)}};
+                        std::vector<cv::Rect> rects = Core::ImageUtils::TileRects(size, tile, overlap);
+                        int outTileW = rects[0].width * scale;
+                        int outTileH = rects[0].height * scale;
+
+                        if (runner.Enabled("MergeTiles")) {
+                            // ImageUtils API: 8-bit tiles in output coordinates
+                            std::vector<Core::ImageTile> tiles;
+                            cv::Mat tileImage = MakeImage(cv::Size(outTileW, outTileH));
+                            for (const cv::Rect& r : rects) {
+                                tiles.push_back({tileImage, r.x * scale, r.y * scale, outTileW, outTileH});
+                            }
+                            runner.Run("MergeTiles", params, Megapixels(outSize), [&]() {
+                                Core::ImageUtils::MergeTiles(tiles, outSize.width, outSize.height, tile * scale, overlap * scale);
+                            });
+                        }
+
+                        // Engine path: model outputs (float CHW) blended straight into the canvas
+                        std::vector<float> output = MakeTileOutput(outTileH, outTileW);
+                        Core::TileLayout layout = Core::TileLayout::FromInput(size, tile, overlap, scale);
+                        cv::Mat canvas(outSize, CV_8UC3);
+                        for (auto mode : {Core::TileMergeMode::Feather, Core::TileMergeMode::CropToCenter}) {
+                            std::string name = mode == Core::TileMergeMode::Feather ? "Blend/feather" : "Blend/crop";
+                            if (!runner.Enabled(name)) continue;
+                            runner.Run(name, params, Megapixels(outSize), [&]() {
+                                Core::TileBlender blender(layout, mode);
+                                for (size_t row = 0; row < layout.ys.size(); ++row) {
+                                    for (size_t col = 0; col < layout.xs.size(); ++col) {
+                                        blender.AddTile(static_cast<int>(col), static_cast<int>(row), output.data(), canvas, 0);
+                                    }
+                                    blender.FinishTileRow(static_cast<int>(row), canvas, 0);
+                                }
+                            });
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void BenchSharpen(Runner& runner, const Config& config) {
+        if (!runner.Enabled("Sharpen")) return;
+        for (const cv::Size& size : config.imageSizes) {
+            cv::Mat img = MakeImage(size);
+            runner.Run("Sharpen", {{"size", SizeStr(size)}}, Megapixels(size), [&]() { Core::ImageUtils::Sharpen(img, 0.5); });
+        }
+    }
+
+    void BenchEndToEnd(Runner& runner, const Config& config, const fs::path& dir) {
+        if (!runner.Enabled("ProcessFile")) return;
+        for (const cv::Size& size : config.imageSizes) {
+            fs::path input = dir / ("e2e_" + SizeStr(size) + ".png");
+            Core::ImageUtils::SaveImage(input.wstring(), MakeImage(size));
+            for (int scale : config.scales) {
+                Core::EngineOptions opts;
+                opts.modelPath = (dir / "stub.onnx").wstring();
+                opts.scale = scale;
+                Core::Engine engine(opts);
+                if (!engine.Initialize()) continue;
+
+                fs::path output = dir / ("e2e_" + SizeStr(size) + "_out.png");
+                runner.Run("ProcessFile", {{"model", "stub"}, {"size", SizeStr(size)}, {"scale", Str(scale)},
+                                           {"tile", Str(opts.tileSize)}, {"overlap", Str(opts.tileOverlap)}},
+                           Megapixels(size), [&]() { engine.ProcessFile(input.wstring(), output.wstring()); });
+            }
+        }
+    }
+
+    // Adaptive compute: throughput for each detail threshold (0 = every tile inferred),
+    // with the PSNR of its output against that all-network output
+    void BenchAdaptive(Runner& runner, const Config& config, const fs::path& dir) {
+        if (!runner.Enabled("Adaptive")) return;
+        for (const cv::Size& size : config.imageSizes) {
+            fs::path input = dir / ("adaptive_" + SizeStr(size) + ".png");
+            Core::ImageUtils::SaveImage(input.wstring(), MakeMixedImage(size));
+            for (int scale : config.scales) {
+                fs::path tinyPath = dir / ("adaptive_x" + Str(scale) + ".onnx");
+                std::ofstream(tinyPath, std::ios::binary) << Bench::BuildTinyUpscaleModel(scale);
+
+                cv::Mat baseline;
+                for (double threshold : {0.0, 10.0, 30.0, 100.0}) {
+                    Core::EngineOptions opts;
+                    opts.modelPath = tinyPath.wstring();
+                    opts.scale = scale;
+                    opts.tileReuseBytes = 0; // Measure routing alone
+                    opts.detailThreshold = threshold;
+                    opts.collectStats = true;
+                    Core::Engine engine(opts);
+                    if (!engine.Initialize()) break;
+
+                    fs::path output = dir / ("adaptive_" + SizeStr(size) + "_out.png");
+                    if (!engine.ProcessFile(input.wstring(), output.wstring())) break;
+                    cv::Mat enhanced = Core::ImageUtils::LoadImage(output.wstring());
+                    if (threshold == 0) baseline = enhanced;
+                    const Core::Telemetry::Stats& stats = engine.Stats()->Report().totals;
+
+                    std::ostringstream psnr, skipped;
+                    psnr << std::fixed << std::setprecision(2) << Psnr(baseline, enhanced);
+                    skipped << std::fixed << std::setprecision(2) << stats.TileSkipRatio();
+                    runner.Run("Adaptive", {{"model", "tiny"}, {"size", SizeStr(size)}, {"scale", Str(scale)},
+                                            {"threshold", Str(static_cast<int>(threshold))}, {"resampled", skipped.str()},
+                                            {"psnr_db", psnr.str()}},
+                               Megapixels(size), [&]() { engine.ProcessFile(input.wstring(), output.wstring()); });
+                }
+            }
+        }
+    }
+
+    std::string JsonEscape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    void WriteJson(const std::string& path, const Config& config, const std::vector<Result>& results) {
+        std::time_t now = std::time(nullptr);
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::ofstream out(path);
+        out << std::setprecision(6);
+        out << "{\n  \"meta\": {\n"
+            << "    \"timestamp\": \"" << timestamp << "\",\n"
+            << "    \"simd\": \"" << Core::Simd::LevelName(Core::Simd::ActiveLevel()) << "\",\n"
+            << "    \"ort_version\": \"" << JsonEscape(OrtGetApiBase()->GetVersionString()) << "\",\n"
+            << "    \"opencv_version\": \"" << JsonEscape(CV_VERSION) << "\",\n"
+            << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"quick\": " << (config.quick ? "true" : "false") << "\n"
+            << "  },\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "    {\"stage\": \"" << JsonEscape(r.stage) << "\", \"params\": {";
+            for (size_t p = 0; p < r.params.size(); ++p) {
+                out << (p ? ", " : "") << "\"" << JsonEscape(r.params[p].first) << "\": \"" << JsonEscape(r.params[p].second) << "\"";
+            }
+            out << "}, \"median_ms\": " << r.medianMs;
+            if (r.megapixels > 0) out << ", \"megapixels_per_s\": " << r.megapixels / (r.medianMs / 1000.0);
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    Config config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            config.quick = true;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            config.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            config.jsonPath = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            config.minSeconds = std::stod(argv[++i]);
+        } else {
+            std::cout << "Usage: enhancer-bench [--quick] [--filter <stage>] [--json <file>] [--min-time <seconds>]\n";
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (config.quick) {
+        config.imageSizes = {cv::Size(640, 480)};
+        config.tileSizes = {128};
+        config.overlaps = {16};
+        config.scales = {2};
+        config.minSeconds = std::min(config.minSeconds, 0.1);
+    } else {
+        config.imageSizes = {cv::Size(640, 480), cv::Size(1920, 1080), cv::Size(2560, 1440)};
+        config.tileSizes = {128, 256};
+        config.overlaps = {8, 16, 32};
+        config.scales = {2, 4};
+    }
+
+    fs::path dir = fs::temp_directory_path() / "enhancer_bench";
+    fs::create_directories(dir);
+    std::ofstream(dir / "stub.onnx").close();
+
+    std::cout << "SIMD level: " << Core::Simd::LevelName(Core::Simd::ActiveLevel()) << std::endl;
+    Runner runner(config);
+    BenchCodecs(runner, config, dir);
+    BenchTiling(runner, config);
+    BenchTileKernels(runner, config);
+    BenchInference(runner, config, dir);
+    BenchMerge(runner, config);
+    BenchSharpen(runner, config);
+    BenchEndToEnd(runner, config, dir);
+    BenchAdaptive(runner, config, dir);
+
+    if (!config.jsonPath.empty()) {
+        WriteJson(config.jsonPath, config, runner.Results());
+        std::cout << "Results written to " << config.jsonPath << std::endl;
+    }
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return 0;
+}
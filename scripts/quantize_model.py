@@ -0,0 +1,106 @@
+"""Build reduced-precision variants of a super-resolution model for enhancer-cli --precision.
+
+    python scripts/quantize_model.py --model models/x4.onnx --calibration samples/
+
+writes models/x4.int8.onnx (static QDQ quantization calibrated on tiles cut from the
+images in samples/) and models/x4.fp16.onnx (float16 weights, float32 inputs and
+outputs). The engine checks each variant against the FP32 model before using it.
+
+Requires: onnx, onnxruntime, onnxconverter-common, opencv-python, numpy.
+"""
+
+import argparse
+import os
+import sys
+
+import numpy as np
+
+
+def variant_path(model, suffix):
+    stem, ext = os.path.splitext(model)
+    return stem + suffix + ext
+
+
+def load_tiles(directory, tile, max_tiles):
+    """BGR -> RGB, [0, 1], NCHW tiles, preprocessed like ImageUtils::PreProcessInto."""
+    import cv2
+
+    tiles = []
+    for name in sorted(os.listdir(directory)):
+        img = cv2.imread(os.path.join(directory, name), cv2.IMREAD_COLOR)
+        if img is None:
+            continue
+        h, w = img.shape[:2]
+        for y in range(0, max(1, h - tile + 1), tile):
+            for x in range(0, max(1, w - tile + 1), tile):
+                crop = img[y:y + tile, x:x + tile]
+                rgb = cv2.cvtColor(crop, cv2.COLOR_BGR2RGB).astype(np.float32) / 255.0
+                tiles.append(np.ascontiguousarray(rgb.transpose(2, 0, 1)[np.newaxis]))
+                if len(tiles) >= max_tiles:
+                    return tiles
+    return tiles
+
+
+def quantize_int8(model, output, calibration, tile, max_tiles, dynamic):
+    from onnxruntime.quantization import (CalibrationDataReader, QuantFormat, QuantType,
+                                          quantize_dynamic, quantize_static)
+
+    if dynamic:
+        quantize_dynamic(model, output, weight_type=QuantType.QInt8)
+        return
+
+    if not calibration:
+        sys.exit("Static INT8 quantization needs --calibration <dir> (or use --dynamic).")
+    tiles = load_tiles(calibration, tile, max_tiles)
+    if not tiles:
+        sys.exit("No readable images in " + calibration)
+
+    import onnx
+    input_name = onnx.load(model, load_external_data=False).graph.input[0].name
+
+    class TileReader(CalibrationDataReader):
+        def __init__(self):
+            self.it = iter(tiles)
+
+        def get_next(self):
+            t = next(self.it, None)
+            return None if t is None else {input_name: t}
+
+    quantize_static(model, output, TileReader(), quant_format=QuantFormat.QDQ,
+                    activation_type=QuantType.QUInt8, weight_type=QuantType.QInt8,
+                    per_channel=True)
+
+
+def convert_fp16(model, output):
+    import onnx
+    from onnxconverter_common import float16
+
+    # Float32 inputs and outputs, so the engine's tensors stay unchanged
+    converted = float16.convert_float_to_float16(onnx.load(model), keep_io_types=True)
+    onnx.save(converted, output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--model", required=True, help="FP32 ONNX model")
+    parser.add_argument("--calibration", help="Directory of sample images for static INT8 calibration")
+    parser.add_argument("--precision", choices=["int8", "fp16", "all"], default="all")
+    parser.add_argument("--dynamic", action="store_true", help="Dynamic INT8 quantization (no calibration)")
+    parser.add_argument("--tile", type=int, default=128, help="Calibration tile size (default: 128)")
+    parser.add_argument("--max-tiles", type=int, default=64, help="Calibration tiles (default: 64)")
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.model):
+        sys.exit("Model not found: " + args.model)
+    if args.precision in ("int8", "all"):
+        out = variant_path(args.model, ".int8")
+        quantize_int8(args.model, out, args.calibration, args.tile, args.max_tiles, args.dynamic)
+        print("Wrote " + out)
+    if args.precision in ("fp16", "all"):
+        out = variant_path(args.model, ".fp16")
+        convert_fp16(args.model, out)
+        print("Wrote " + out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#include "Autotuner.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace Core {
+
+    namespace Autotuner {
+
+        namespace {
+
+            using Clock = std::chrono::steady_clock;
+
+            int CoreCount() {
+                return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            }
+
+            std::vector<int> WorkerCandidates(const AutotuneOptions& options) {
+                if (options.device != Device::CPU) return {1};
+                if (!options.workerCounts.empty()) return options.workerCounts;
+                std::vector<int> counts;
+                for (int w = 1; w <= CoreCount(); w *= 2) counts.push_back(w);
+                return counts;
+            }
+
+            struct BenchWorker {
+                InferenceSession* session = nullptr;
+                std::vector<float> input;
+                std::vector<float> output;
+                std::vector<int64_t> inputDims;
+                std::vector<int64_t> outputDims;
+                size_t runs = 0;
+                bool ok = true;
+            };
+
+            // Input pixels per second for one candidate, or 0 if inference failed
+            double Measure(const std::vector<std::unique_ptr<InferenceSession>>& sessions, int tileSize, int batch,
+                           const AutotuneOptions& options) {
+                int outTile = tileSize * options.scale;
+                std::vector<BenchWorker> workers(sessions.size());
+                for (size_t w = 0; w < sessions.size(); ++w) {
+                    BenchWorker& worker = workers[w];
+                    worker.session = sessions[w].get();
+                    worker.input.assign(static_cast<size_t>(batch) * 3 * tileSize * tileSize, 0.5f);
+                    worker.output.resize(static_cast<size_t>(batch) * 3 * outTile * outTile);
+                    worker.inputDims = {batch, 3, tileSize, tileSize};
+                    worker.outputDims = {batch, 3, outTile, outTile};
+                    // Warm-up: binds the buffers and lets ORT size its arenas
+                    if (!worker.session->RunInto(worker.input.data(), worker.inputDims, worker.output.data(), worker.outputDims)) {
+                        return 0;
+                    }
+                }
+
+                auto start = Clock::now();
+                auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                                            std::chrono::duration<double>(options.secondsPerCandidate));
+                std::vector<std::thread> threads;
+                for (auto& worker : workers) {
+                    threads.emplace_back([&worker, deadline]() {
+                        // At least one timed run, however slow
+                        do {
+                            if (!worker.session->RunInto(worker.input.data(), worker.inputDims,
+                                                         worker.output.data(), worker.outputDims)) {
+                                worker.ok = false;
+                                return;
+                            }
+                            worker.runs++;
+                        } while (Clock::now() < deadline);
+                    });
+                }
+                for (auto& t : threads) t.join();
+                double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+                size_t tiles = 0;
+                for (const auto& worker : workers) {
+                    if (!worker.ok) return 0;
+                    tiles += worker.runs * static_cast<size_t>(batch);
+                }
+                // Neighbouring tiles share `overlap` pixels, so only the rest is new input
+                double step = std::max(1, tileSize - options.tileOverlap);
+                return seconds > 0 ? static_cast<double>(tiles) * step * step / seconds : 0;
+            }
+
+        }
+
+        size_t EstimateMemory(int tileSize, int batchSize, int workers, int scale) {
+            size_t inputFloats = 3ull * tileSize * tileSize;
+            size_t outputFloats = inputFloats * scale * scale;
+            return 2 * sizeof(float) * (inputFloats + outputFloats) * batchSize * workers;
+        }
+
+        bool Tune(const AutotuneOptions& options, TuneProfile& best) {
+            bool found = false;
+            int cores = CoreCount();
+            for (int workerCount : WorkerCandidates(options)) {
+                if (workerCount < 1) continue;
+                SessionThreading threading;
+                threading.intraOpThreads = workerCount > 1 ? std::max(1, cores / workerCount) : 0;
+
+                std::vector<std::unique_ptr<InferenceSession>> sessions;
+                for (int w = 0; w < workerCount; ++w) {
+                    auto session = std::make_unique<InferenceSession>();
+                    session->SetModelCacheDir(options.modelCacheDir);
+                    if (!session->LoadModel(options.modelPath, options.device, threading)) {
+                        std::cerr << "Autotune: failed to load model." << std::endl;
+                        return false;
+                    }
+                    sessions.push_back(std::move(session));
+                }
+
+                // Static model dimensions leave nothing to choose
+                std::vector<int64_t> shape = sessions[0]->GetInputShape();
+                std::vector<int> tileSizes = options.tileSizes;
+                std::vector<int> batchSizes = options.batchSizes;
+                if (shape.size() == 4 && shape[2] > 0) tileSizes = {static_cast<int>(shape[2])};
+                if (!shape.empty() && shape[0] > 0) batchSizes = {1};
+
+                for (int tileSize : tileSizes) {
+                    if (tileSize <= options.tileOverlap) continue;
+                    for (int batch : batchSizes) {
+                        if (batch < 1) continue;
+                        if (options.memoryBudgetBytes > 0 &&
+                            EstimateMemory(tileSize, batch, workerCount, options.scale) > options.memoryBudgetBytes) {
+                            continue;
+                        }
+                        double rate = Measure(sessions, tileSize, batch, options);
+                        std::cout << "Autotune: tile " << tileSize << ", batch " << batch << ", " << workerCount
+                                  << " worker(s): " << rate / 1e6 << " MP/s" << std::endl;
+                        if (rate > 0 && (!found || rate > best.pixelsPerSecond)) {
+                            best.tileSize = tileSize;
+                            best.tileBatchSize = batch;
+                            best.inferenceWorkers = workerCount;
+                            best.intraOpThreads = threading.intraOpThreads;
+                            best.pixelsPerSecond = rate;
+                            found = true;
+                        }
+                    }
+                }
+            }
+            if (!found) std::cerr << "Autotune: no candidate fits the memory budget." << std::endl;
+            return found;
+        }
+
+        std::wstring ProfilePath(const std::wstring& dir, const AutotuneOptions& options) {
+            uint64_t modelHash = 0;
+            Hash::File(options.modelPath, modelHash);
+            std::string key = "model=" + Hash::ToHex(modelHash) +
+                              ";device=" + std::to_string(static_cast<int>(options.device)) +
+                              ";scale=" + std::to_string(options.scale) +
+                              ";overlap=" + std::to_string(options.tileOverlap) +
+                              ";budget=" + std::to_string(options.memoryBudgetBytes) +
+                              ";cores=" + std::to_string(CoreCount());
+            std::wstring name = std::filesystem::path(options.modelPath).stem().wstring() + L"-";
+            std::string hex = Hash::ToHex(Hash::String(key));
+            name += std::wstring(hex.begin(), hex.end()) + L".tune";
+            return (std::filesystem::path(dir) / name).wstring();
+        }
+
+        bool LoadProfile(const std::wstring& path, TuneProfile& profile) {
+            std::ifstream file(std::filesystem::path(path), std::ios::in);
+            if (!file.is_open()) return false;
+            TuneProfile loaded;
+            std::string line;
+            try {
+                while (std::getline(file, line)) {
+                    size_t eq = line.find('=');
+                    if (eq == std::string::npos) continue;
+                    std::string key = line.substr(0, eq), value = line.substr(eq + 1);
+                    if (key == "tile_size") loaded.tileSize = std::stoi(value);
+                    else if (key == "tile_batch") loaded.tileBatchSize = std::stoi(value);
+                    else if (key == "workers") loaded.inferenceWorkers = std::stoi(value);
+                    else if (key == "intra_threads") loaded.intraOpThreads = std::stoi(value);
+                    else if (key == "pixels_per_second") loaded.pixelsPerSecond = std::stod(value);
+                }
+            } catch (const std::exception&) {
+                return false;
+            }
+            if (loaded.tileSize < 1 || loaded.tileBatchSize < 1 || loaded.inferenceWorkers < 1 || loaded.intraOpThreads < 0) {
+                return false;
+            }
+            profile = loaded;
+            return true;
+        }
+
+        bool SaveProfile(const std::wstring& path, const TuneProfile& profile) {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+            std::filesystem::path temp = FileUtils::TempPathFor(path);
+            {
+                std::ofstream file(temp);
+                if (!file.is_open()) return false;
+                file << "tile_size=" << profile.tileSize << "\n"
+                     << "tile_batch=" << profile.tileBatchSize << "\n"
+                     << "workers=" << profile.inferenceWorkers << "\n"
+                     << "intra_threads=" << profile.intraOpThreads << "\n"
+                     << "pixels_per_second=" << static_cast<uint64_t>(profile.pixelsPerSecond) << "\n";
+                if (!file) {
+                    file.close();
+                    std::filesystem::remove(temp, ec);
+                    return false;
+                }
+            }
+            return FileUtils::Publish(temp, path);
+        }
+
+    }
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "InferenceSession.hpp"
+
+namespace Core {
+
+    // Tile and threading settings picked for one model on one machine
+    struct TuneProfile {
+        int tileSize = 256;
+        int tileBatchSize = 1;
+        int inferenceWorkers = 1;
+        int intraOpThreads = 0;
+        double pixelsPerSecond = 0; // Measured input pixels per second, tile overlap excluded
+    };
+
+    struct AutotuneOptions {
+        std::wstring modelPath;
+        std::wstring modelCacheDir;
+        Device device = Device::CPU;
+        int scale = 4;
+        int tileOverlap = 16;
+
+        // Candidate grid. Empty workerCounts tries 1, 2, 4, ... up to the core count
+        // (one worker on GPU devices); each worker gets cores / workers intra-op threads.
+        std::vector<int> tileSizes = {128, 192, 256, 384, 512};
+        std::vector<int> batchSizes = {1, 2, 4};
+        std::vector<int> workerCounts;
+
+        size_t memoryBudgetBytes = 0; // Estimated inference memory limit per candidate; 0 = unlimited
+        double secondsPerCandidate = 0.5;
+    };
+
+    // Finds the highest-throughput tile configuration by running every candidate
+    // through real InferenceSessions on synthetic tiles, and stores the winner in a
+    // small profile file so later runs can skip the benchmark.
+    namespace Autotuner {
+
+        // Benchmark the grid. False if the model cannot be loaded or nothing fits the budget.
+        bool Tune(const AutotuneOptions& options, TuneProfile& best);
+
+        // Profile file in `dir` for this model file, device, scale, overlap, budget and core count
+        std::wstring ProfilePath(const std::wstring& dir, const AutotuneOptions& options);
+
+        bool LoadProfile(const std::wstring& path, TuneProfile& profile);
+        bool SaveProfile(const std::wstring& path, const TuneProfile& profile);
+
+        // Inference memory estimate for one candidate: the tile tensors of every worker
+        // plus about as much again for the model's intermediate activations
+        size_t EstimateMemory(int tileSize, int batchSize, int workers, int scale);
+
+    }
+
+}
@@ -0,0 +1,164 @@
+#include "BatchJournal.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Core {
+
+    namespace {
+
+        std::FILE* OpenFile(const fs::path& path, const char* mode) {
+#ifdef _WIN32
+            std::wstring wmode(mode, mode + std::strlen(mode));
+            return _wfopen(path.c_str(), wmode.c_str());
+#else
+            return std::fopen(path.c_str(), mode);
+#endif
+        }
+
+        std::vector<std::string> Split(const std::string& line) {
+            std::vector<std::string> fields;
+            std::istringstream in(line);
+            std::string field;
+            while (std::getline(in, field, '\t')) fields.push_back(field);
+            return fields;
+        }
+
+    }
+
+    BatchJournal::BatchJournal(const std::wstring& path, const std::string& settingsKey)
+        : path_(path), settingsKey_(settingsKey), lastSync_(std::chrono::steady_clock::now()) {}
+
+    BatchJournal::~BatchJournal() {
+        Sync();
+        if (file_) std::fclose(file_);
+    }
+
+    bool BatchJournal::Open(bool resume) {
+        std::error_code ec;
+        bool append = false;
+        if (resume && fs::exists(path_, ec)) {
+            Read();
+            append = !files_.empty() || !bands_.empty();
+        }
+
+        file_ = OpenFile(path_, append ? "ab" : "wb");
+        if (!file_) {
+            std::wcerr << L"Cannot write the batch journal: " << path_ << std::endl;
+            return false;
+        }
+        if (!append) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Append("J\t1\t" + settingsKey_, true);
+        }
+        return true;
+    }
+
+    void BatchJournal::Read() {
+        std::ifstream in{fs::path(path_), std::ios::binary};
+        std::string line;
+        bool header = false;
+        size_t torn = 0;
+        while (std::getline(in, line)) {
+            // The last field is the hash of the line before it
+            size_t tab = line.rfind('\t');
+            if (tab == std::string::npos || Hash::ToHex(Hash::String(line.substr(0, tab))) != line.substr(tab + 1)) {
+                torn++;
+                continue;
+            }
+            std::vector<std::string> f = Split(line.substr(0, tab));
+            if (!header) {
+                if (f.size() != 3 || f[0] != "J" || f[2] != settingsKey_) {
+                    std::cout << "The batch journal was written with other settings, starting over." << std::endl;
+                    return;
+                }
+                header = true;
+            } else if (f.size() == 5 && f[0] == "F") {
+                FileEntry& entry = files_[FileUtils::UnescapePath(f[2])];
+                entry.ok = f[1] == "1";
+                entry.fingerprint = f[3];
+                entry.outputPath = FileUtils::UnescapePath(f[4]);
+            } else if (f.size() == 5 && f[0] == "B") {
+                RowCheckpoint& checkpoint = bands_[f[1]];
+                checkpoint.rows = std::stoi(f[2]);
+                checkpoint.bytes = std::stoull(f[3]);
+                checkpoint.adler = static_cast<uint32_t>(std::stoul(f[4]));
+            }
+        }
+        if (torn > 0) std::cout << "Ignored " << torn << " incomplete batch journal record(s)." << std::endl;
+    }
+
+    bool BatchJournal::Finished(const std::wstring& inputPath, const std::wstring& outputPath) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(inputPath);
+        if (it == files_.end() || !it->second.ok || it->second.outputPath != outputPath) return false;
+        std::error_code ec;
+        return it->second.fingerprint == Fingerprint(inputPath) && fs::file_size(outputPath, ec) > 0 && !ec;
+    }
+
+    void BatchJournal::RecordFile(const std::wstring& inputPath, const std::wstring& outputPath, bool ok) {
+        std::string fingerprint = Fingerprint(inputPath);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Append(std::string("F\t") + (ok ? "1" : "0") + "\t" + FileUtils::EscapePath(inputPath) + "\t" + fingerprint + "\t" + FileUtils::EscapePath(outputPath), false);
+        FileEntry& entry = files_[inputPath];
+        entry.ok = ok;
+        entry.fingerprint = fingerprint;
+        entry.outputPath = outputPath;
+    }
+
+    void BatchJournal::RecordBand(const std::string& key, const RowCheckpoint& checkpoint) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Append("B\t" + key + "\t" + std::to_string(checkpoint.rows) + "\t" + std::to_string(checkpoint.bytes) + "\t" +
+                   std::to_string(checkpoint.adler),
+               true);
+        bands_[key] = checkpoint;
+    }
+
+    bool BatchJournal::FindBand(const std::string& key, RowCheckpoint& checkpoint) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = bands_.find(key);
+        if (it == bands_.end()) return false;
+        checkpoint = it->second;
+        return true;
+    }
+
+    void BatchJournal::Sync() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SyncLocked();
+    }
+
+    void BatchJournal::Append(const std::string& fields, bool sync) {
+        if (!file_) return;
+        std::string line = fields + "\t" + Hash::ToHex(Hash::String(fields)) + "\n";
+        std::fwrite(line.data(), 1, line.size(), file_);
+        unsynced_++;
+        if (sync || unsynced_ >= kSyncEvery || std::chrono::steady_clock::now() - lastSync_ >= kSyncInterval) {
+            SyncLocked();
+        }
+    }
+
+    void BatchJournal::SyncLocked() {
+        if (!file_ || unsynced_ == 0) return;
+        std::fflush(file_);
+        FileUtils::SyncFile(path_);
+        unsynced_ = 0;
+        lastSync_ = std::chrono::steady_clock::now();
+    }
+
+    std::string BatchJournal::Fingerprint(const std::wstring& path) {
+        std::error_code ec;
+        uintmax_t size = fs::file_size(path, ec);
+        if (ec) return std::string();
+        fs::file_time_type modified = fs::last_write_time(path, ec);
+        if (ec) return std::string();
+        return std::to_string(size) + ":" + std::to_string(modified.time_since_epoch().count());
+    }
+
+}
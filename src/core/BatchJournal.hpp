@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "RowWriter.hpp"
+
+namespace Core {
+
+    // Append-only record of a batch's progress, so an interrupted batch can resume.
+    //
+    // One line per event: a finished file (with its input's size and modification
+    // time, and its output path) or a durable band of a streamed output. Every line
+    // carries its own hash; a line torn by a crash is ignored when reading. File
+    // records are synced to disk in groups, band records at once.
+    //
+    // The first line holds the settings key. A journal written with other settings
+    // (model, scale, strength, encoder, ...) is discarded instead of resumed.
+    class BatchJournal {
+    public:
+        BatchJournal(const std::wstring& path, const std::string& settingsKey);
+        ~BatchJournal(); // Syncs what is still buffered
+
+        BatchJournal(const BatchJournal&) = delete;
+        BatchJournal& operator=(const BatchJournal&) = delete;
+
+        // Start a new journal, or with `resume` read the existing one and append to it
+        bool Open(bool resume);
+
+        // True if an earlier run enhanced inputPath into outputPath, the input is unchanged
+        // since and the output still exists
+        bool Finished(const std::wstring& inputPath, const std::wstring& outputPath) const;
+
+        void RecordFile(const std::wstring& inputPath, const std::wstring& outputPath, bool ok);
+
+        // Streamed outputs, identified by `key`. The partial output must already be synced.
+        void RecordBand(const std::string& key, const RowCheckpoint& checkpoint);
+        bool FindBand(const std::string& key, RowCheckpoint& checkpoint) const;
+
+        // Write and sync buffered records
+        void Sync();
+
+        // Size and modification time of a file; empty if it does not exist
+        static std::string Fingerprint(const std::wstring& path);
+
+        static const int kSyncEvery = 32; // File records per sync...
+        static constexpr std::chrono::seconds kSyncInterval{2}; // ...or at least this often
+
+    private:
+        struct FileEntry {
+            bool ok = false;
+            std::string fingerprint;
+            std::wstring outputPath;
+        };
+
+        std::wstring path_;
+        std::string settingsKey_;
+        std::FILE* file_ = nullptr;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::wstring, FileEntry> files_;       // Latest record per input
+        std::unordered_map<std::string, RowCheckpoint> bands_;    // Latest checkpoint per streamed output
+        int unsynced_ = 0;
+        std::chrono::steady_clock::time_point lastSync_;
+
+        void Read();
+        void Append(const std::string& fields, bool sync); // Caller holds mutex_
+        void SyncLocked();
+    };
+
+}
@@ -0,0 +1,118 @@
+#include "BufferPool.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+
+namespace Core {
+
+    namespace {
+
+        constexpr std::align_val_t kAlignment{64};
+
+        // Requests are rounded up so slightly different image sizes share buffers
+        constexpr size_t kGranularity = 64 * 1024;
+
+        void* Allocate(size_t bytes) {
+            return ::operator new(bytes, kAlignment);
+        }
+
+        void Free(void* p) {
+            ::operator delete(p, kAlignment);
+        }
+
+    }
+
+    struct BufferPool::State {
+        size_t maxIdleBytes;
+        bool open = true; // False once the pool is destroyed; buffers are then freed on release
+
+        mutable std::mutex mutex;
+        std::multimap<size_t, void*> idle; // By size
+        Stats stats;
+
+        void Release(void* p, size_t size) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.bytesInUse -= size;
+                size_t cap = maxIdleBytes ? maxIdleBytes : stats.peakBytesInUse;
+                if (open && stats.idleBytes + size <= cap) {
+                    idle.emplace(size, p);
+                    stats.idleBytes += size;
+                    return;
+                }
+            }
+            Free(p);
+        }
+    };
+
+    BufferPool::BufferPool(size_t maxIdleBytes) : state_(std::make_shared<State>()) {
+        state_->maxIdleBytes = maxIdleBytes;
+    }
+
+    BufferPool::~BufferPool() {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->open = false;
+        for (auto& entry : state_->idle) Free(entry.second);
+        state_->idle.clear();
+        state_->stats.idleBytes = 0;
+    }
+
+    std::shared_ptr<void> BufferPool::Acquire(size_t bytes) {
+        size_t size = std::max<size_t>(1, (bytes + kGranularity - 1) / kGranularity) * kGranularity;
+        void* p = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            Stats& stats = state_->stats;
+            stats.acquired++;
+            // Smallest idle buffer that fits, unless it would waste more than half of itself
+            auto it = state_->idle.lower_bound(size);
+            if (it != state_->idle.end() && it->first <= 2 * size) {
+                size = it->first;
+                p = it->second;
+                state_->idle.erase(it);
+                stats.idleBytes -= size;
+                stats.reused++;
+            } else {
+                stats.allocated++;
+            }
+            stats.bytesInUse += size;
+            stats.peakBytesInUse = std::max(stats.peakBytesInUse, stats.bytesInUse);
+        }
+
+        if (p) {
+            Telemetry::Count(Telemetry::Counter::BufferReuses);
+        } else {
+            try {
+                p = Allocate(size);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                state_->stats.bytesInUse -= size;
+                throw;
+            }
+            Telemetry::CountAllocation(size);
+        }
+
+        std::shared_ptr<State> state = state_;
+        return std::shared_ptr<void>(p, [state, size](void* block) { state->Release(block, size); });
+    }
+
+    std::shared_ptr<void> BufferPool::AcquireFrom(BufferPool* pool, size_t bytes) {
+        if (pool) return pool->Acquire(bytes);
+        Telemetry::CountAllocation(bytes);
+        return std::shared_ptr<void>(Allocate(std::max<size_t>(1, bytes)), Free);
+    }
+
+    cv::Mat BufferPool::AcquireMat(BufferPool* pool, int rows, int cols, int type, std::shared_ptr<void>& storage) {
+        size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+        storage = AcquireFrom(pool, bytes);
+        return cv::Mat(rows, cols, type, storage.get());
+    }
+
+    BufferPool::Stats BufferPool::GetStats() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->stats;
+    }
+
+}
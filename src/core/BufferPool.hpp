@@ -0,0 +1,52 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Core {
+
+    // Recycles the large per-image scratch buffers (output canvases, streamed bands,
+    // blend accumulators, sharpening rows) so that a long batch of similar images
+    // stops allocating once the first few images have been processed.
+    //
+    // Buffers are handed out as shared_ptr<void>; dropping the last reference returns
+    // the memory to the pool (or frees it if the pool is gone or full). Thread-safe.
+    class BufferPool {
+    public:
+        struct Stats {
+            uint64_t acquired = 0;     // Acquire calls
+            uint64_t reused = 0;       // ...served from an idle buffer
+            uint64_t allocated = 0;    // ...that allocated new memory
+            size_t bytesInUse = 0;
+            size_t peakBytesInUse = 0;
+            size_t idleBytes = 0;      // Released buffers kept for reuse
+        };
+
+        // At most maxIdleBytes of released buffers are kept; 0 keeps up to the
+        // peak amount ever in use at once, which adapts to the tile size, scale and
+        // number of images in flight.
+        explicit BufferPool(size_t maxIdleBytes = 0);
+        ~BufferPool();
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        // Uninitialized, 64-byte aligned memory of at least `bytes` bytes
+        std::shared_ptr<void> Acquire(size_t bytes);
+
+        // Acquire from `pool`, or allocate unpooled memory when it is null
+        static std::shared_ptr<void> AcquireFrom(BufferPool* pool, size_t bytes);
+
+        // Continuous Mat backed by a buffer from `pool` (may be null); `storage` keeps it alive
+        static cv::Mat AcquireMat(BufferPool* pool, int rows, int cols, int type, std::shared_ptr<void>& storage);
+
+        Stats GetStats() const;
+
+    private:
+        struct State;
+        std::shared_ptr<State> state_;
+    };
+
+}
@@ -0,0 +1,153 @@
+#include "DirectoryScan.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace Core {
+
+    namespace {
+
+        const wchar_t* const kImageExtensions[] = {L".png", L".jpg", L".jpeg", L".webp", L".bmp", L".tif", L".tiff"};
+        const wchar_t* const kOutputSuffix = L"_upscaled";
+
+        // List one directory: images into `files`, subdirectories (if wanted) into `subdirs`.
+        // False if the directory could not be read to the end.
+        bool ListDirectory(const fs::path& dir, const fs::path& root, const ScanOptions& options,
+                           const std::vector<fs::path>& excluded, std::vector<ScannedFile>& files, std::vector<fs::path>& subdirs) {
+            std::error_code ec;
+            fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+            if (ec) {
+                std::wcerr << L"Cannot read directory: " << dir.wstring() << std::endl;
+                return false;
+            }
+            for (; it != fs::directory_iterator(); it.increment(ec)) {
+                if (ec) {
+                    std::wcerr << L"Error while reading directory: " << dir.wstring() << std::endl;
+                    return false;
+                }
+                const fs::directory_entry& entry = *it;
+                std::error_code entryEc;
+                // The type usually comes with the listing; only candidate images are stat'ed
+                if (entry.is_directory(entryEc)) {
+                    if (options.recursive && !entry.is_symlink(entryEc) &&
+                        std::find(excluded.begin(), excluded.end(), entry.path()) == excluded.end()) {
+                        subdirs.push_back(entry.path());
+                    }
+                    continue;
+                }
+                if (!DirectoryScan::IsImageName(entry.path().wstring()) || !entry.is_regular_file(entryEc)) continue;
+
+                ScannedFile file;
+                file.size = entry.file_size(entryEc);
+                if (entryEc) continue;
+                file.modified = static_cast<int64_t>(entry.last_write_time(entryEc).time_since_epoch().count());
+                if (entryEc) continue;
+                file.path = entry.path().wstring();
+                file.relative = entry.path().lexically_relative(root).wstring();
+                files.push_back(std::move(file));
+            }
+            return true;
+        }
+
+    }
+
+    namespace DirectoryScan {
+
+        std::vector<ScannedFile> Scan(const ScanOptions& options, std::vector<std::wstring>* unreadable) {
+            std::error_code ec;
+            fs::path root = fs::weakly_canonical(options.root, ec);
+            if (ec) root = fs::path(options.root).lexically_normal();
+            std::vector<fs::path> excluded;
+            for (const auto& dir : options.excludeDirs) {
+                fs::path path = fs::weakly_canonical(dir, ec);
+                excluded.push_back(ec ? fs::path(dir).lexically_normal() : path);
+            }
+
+            // Workers share a stack of directories still to list; the scan is over when
+            // it is empty and nobody is listing (and so could add more)
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::vector<fs::path> pending{root};
+            int listing = 0;
+            std::vector<ScannedFile> files;
+            std::vector<std::wstring> failed;
+
+            auto worker = [&]() {
+                std::vector<ScannedFile> found;
+                std::vector<fs::path> subdirs;
+                std::unique_lock<std::mutex> lock(mutex);
+                for (;;) {
+                    cv.wait(lock, [&]() { return !pending.empty() || listing == 0; });
+                    if (pending.empty()) break;
+                    fs::path dir = std::move(pending.back());
+                    pending.pop_back();
+                    listing++;
+                    lock.unlock();
+
+                    bool listed = ListDirectory(dir, root, options, excluded, found, subdirs);
+
+                    lock.lock();
+                    if (!listed) failed.push_back(dir == root ? std::wstring() : dir.lexically_relative(root).wstring());
+                    pending.insert(pending.end(), std::make_move_iterator(subdirs.begin()), std::make_move_iterator(subdirs.end()));
+                    subdirs.clear();
+                    listing--;
+                    cv.notify_all();
+                }
+                files.insert(files.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+            };
+
+            int threads = std::max(1, options.recursive ? options.threads : 1);
+            std::vector<std::thread> workers;
+            for (int t = 1; t < threads; ++t) workers.emplace_back(worker);
+            worker();
+            for (auto& t : workers) t.join();
+
+            std::sort(files.begin(), files.end(), [](const ScannedFile& a, const ScannedFile& b) { return a.relative < b.relative; });
+            if (unreadable) {
+                std::sort(failed.begin(), failed.end());
+                *unreadable = std::move(failed);
+            }
+            return files;
+        }
+
+        bool IsImageName(const std::wstring& path) {
+            fs::path p(path);
+            std::wstring ext = p.extension().wstring();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+            if (std::none_of(std::begin(kImageExtensions), std::end(kImageExtensions),
+                             [&](const wchar_t* known) { return ext == known; })) {
+                return false;
+            }
+            // Temporary (.tmp-*) and partial outputs never have an image extension
+            std::wstring stem = p.stem().wstring();
+            size_t suffix = std::wcslen(kOutputSuffix);
+            return !(stem.size() >= suffix && stem.compare(stem.size() - suffix, suffix, kOutputSuffix) == 0);
+        }
+
+        bool HasImageSignature(const std::wstring& path) {
+            unsigned char head[12] = {};
+            std::ifstream file(fs::path(path), std::ios::binary);
+            if (!file.read(reinterpret_cast<char*>(head), sizeof(head))) return false;
+
+            auto starts = [&](const char* magic, size_t size, size_t offset = 0) {
+                return std::memcmp(head + offset, magic, size) == 0;
+            };
+            return starts("\x89PNG\r\n\x1a\n", 8) ||
+                   starts("\xff\xd8\xff", 3) ||
+                   (starts("RIFF", 4) && starts("WEBP", 4, 8)) ||
+                   starts("BM", 2) ||
+                   starts("II*\0", 4) || starts("MM\0*", 4);
+        }
+
+    }
+
+}
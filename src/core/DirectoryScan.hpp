@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    struct ScannedFile {
+        std::wstring path;     // Full path
+        std::wstring relative; // Relative to the scanned root, with the platform's separators
+        uint64_t size = 0;
+        int64_t modified = 0;  // Last write time, in file clock ticks
+    };
+
+    struct ScanOptions {
+        std::wstring root;
+        bool recursive = true;
+        int threads = 4; // Directories listed in parallel; pays off on network shares
+        std::vector<std::wstring> excludeDirs; // Not descended into (e.g. an output tree inside the input)
+    };
+
+    // Finds the images of a directory tree without opening them: names are filtered
+    // by extension, and size and modification time come from the directory listing.
+    // Skips our own outputs (*_upscaled.*) and temporary and partial files.
+    namespace DirectoryScan {
+
+        // Sorted by relative path. Directories that cannot be listed (completely) are
+        // skipped with a warning and, if `unreadable` is given, added to it by relative
+        // path (empty for the root), so callers can tell them from deleted ones.
+        std::vector<ScannedFile> Scan(const ScanOptions& options, std::vector<std::wstring>* unreadable = nullptr);
+
+        // Extension is one we decode, and the name is not one of our outputs or temporaries
+        bool IsImageName(const std::wstring& path);
+
+        // The file starts with a PNG, JPEG, WebP, BMP or TIFF signature
+        bool HasImageSignature(const std::wstring& path);
+
+    }
+
+}
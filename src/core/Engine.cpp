@@ -1,16 +1,73 @@
 #include "Engine.hpp"
+#include "FilePrefetcher.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
 #include "ImageUtils.hpp"
+#include "Pipeline.hpp"
+#include "RowWriter.hpp"
+#include "UnsharpMask.hpp"
 #include <iostream>
 #include <filesystem>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <sstream>
+#include <cstring>
 
 namespace Core {
 
     Engine::Engine(const EngineOptions& options) : options_(options) {
-        session_ = std::make_unique<InferenceSession>();
+        if (options_.collectStats || options_.collectTrace) {
+            telemetry_ = std::make_unique<Telemetry::Collector>(options_.collectTrace);
+        }
+        bufferPool_ = std::make_unique<BufferPool>(options_.bufferPoolBytes);
+    }
+
+    Engine::~Engine() {
+        // Workers sharpen resampled tiles with pooled buffers, so they stop before the pool goes
+        scheduler_.reset();
     }
 
-    Engine::~Engine() {}
+    struct Engine::OutputBand {
+        cv::Mat buffer;              // Holds output rows [top, top + buffer.rows)
+        std::shared_ptr<void> storage; // Pooled memory behind buffer
+        int top = 0;
+        RowWriter* writer = nullptr; // Receives finished rows; null when buffer is the whole canvas
+        int tileRows = 0;            // Tile rows blended into the buffer between two flushes
+        int skipRows = 0;            // Leading rows the writer already has (resumed output)
+        BatchJournal* journal = nullptr; // Records a checkpoint after every written band
+        std::string journalKey;
+        std::unique_ptr<UnsharpMask> sharpen; // Null when sharpening is off
+
+        // Sharpen the rows whose neighbourhood is complete; returns the rows ready for output
+        int Sharpen(int finishedRows) {
+            if (!sharpen) return finishedRows;
+            Telemetry::ScopedTimer timer(Telemetry::Stage::Sharpen);
+            return sharpen->Advance(buffer, top, finishedRows);
+        }
+
+        // Hand the ready rows to the writer. Rows still waiting for the sharpening
+        // halo move to the top of the buffer, where the next band continues.
+        bool Flush(int finishedRows) {
+            int ready = Sharpen(finishedRows);
+            int rows = ready - top;
+            if (rows == 0) return true;
+            int first = std::clamp(skipRows - top, 0, rows);
+            if (first < rows) {
+                Telemetry::ScopedTimer timer(Telemetry::Stage::Encode);
+                if (!writer->WriteRows(buffer.rowRange(first, rows))) return false;
+                RowCheckpoint checkpoint;
+                if (journal && writer->Checkpoint(checkpoint)) journal->RecordBand(journalKey, checkpoint);
+            }
+            int pending = finishedRows - ready;
+            if (pending > 0) {
+                std::memmove(buffer.ptr(0), buffer.ptr(rows), static_cast<size_t>(pending) * buffer.step[0]);
+            }
+            top = ready;
+            return true;
+        }
+    };
 
     bool Engine::Initialize() {
         // Load main super-res model
@@ -19,9 +76,64 @@ namespace Core {
             return false;
         }
 
-        if (!session_->LoadModel(options_.modelPath, options_.device)) {
-            std::cerr << "Failed to load model." << std::endl;
-            return false;
+        loadedModelPath_ = SelectModelVariant();
+        ApplyTuneProfile();
+
+        // One session per inference worker. GPU providers get a single worker: they
+        // already run a tile in parallel and do not benefit from concurrent sessions.
+        int workers = std::max(1, options_.inferenceWorkers);
+        if (workers > 1 && options_.device != Device::CPU) {
+            std::cout << "GPU inference uses a single worker." << std::endl;
+            workers = 1;
+        }
+        SessionThreading threading;
+        threading.intraOpThreads = options_.intraOpThreads;
+        threading.interOpThreads = options_.interOpThreads;
+        if (threading.intraOpThreads <= 0 && workers > 1) {
+            // Split the cores between workers instead of letting every session claim all of them
+            threading.intraOpThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / workers);
+        }
+
+        std::vector<std::unique_ptr<InferenceSession>> sessions;
+        for (int w = 0; w < workers; ++w) {
+            auto session = std::make_unique<InferenceSession>();
+            session->SetModelCacheDir(options_.modelCacheDir);
+            if (!session->LoadModel(loadedModelPath_, options_.device, threading)) {
+                std::cerr << "Failed to load model." << std::endl;
+                return false;
+            }
+            sessions.push_back(std::move(session));
+        }
+
+        // Later workers always hit the cache the first one just filled
+        usedModelCache_ = sessions[0]->LoadedFromCache();
+
+        // Batched tiles need a dynamic batch dimension
+        tileBatchSize_ = std::max(1, options_.tileBatchSize);
+        std::vector<int64_t> inputShape = sessions[0]->GetInputShape();
+        if (tileBatchSize_ > 1 && !inputShape.empty() && inputShape[0] > 0) {
+            std::cout << "Model has a static batch dimension (" << inputShape[0]
+                      << "), running one tile per inference call." << std::endl;
+            tileBatchSize_ = 1;
+        }
+
+        // Reused outputs count against the memory budget, so they get at most a quarter of it
+        tileReuseBytes_ = options_.tileReuseBytes;
+        if (options_.maxMemoryBytes > 0) tileReuseBytes_ = std::min(tileReuseBytes_, options_.maxMemoryBytes / 4);
+        TileSkipOptions skip;
+        skip.reuseBytes = tileReuseBytes_;
+        skip.flatTolerance = options_.flatTileTolerance;
+        skip.detailThreshold = options_.detailThreshold;
+        skip.resampleSharpen = options_.lowDetailSharpen;
+        scheduler_ = std::make_unique<TileScheduler>(std::move(sessions), static_cast<size_t>(tileBatchSize_), skip,
+                                                     bufferPool_.get());
+
+        // Every settings key (result cache, journal, --sync manifest) names the model
+        uint64_t modelHash = 0;
+        Hash::File(loadedModelPath_, modelHash);
+        modelKey_ = Hash::ToHex(modelHash);
+        if (!options_.resultCacheDir.empty()) {
+            resultCache_ = std::make_unique<ResultCache>(options_.resultCacheDir, options_.resultCacheMaxBytes);
         }
 
         // TODO: Load face model if enabled
@@ -29,118 +141,891 @@ namespace Core {
         return true;
     }
 
+    std::wstring Engine::SelectModelVariant() {
+        loadedPrecision_ = ModelPrecision::FP32;
+        if (options_.precision == ModelPrecision::FP32) return options_.modelPath;
+
+        const char* name = ModelVariants::Name(options_.precision);
+        std::wstring variantPath = ModelVariants::VariantPath(options_.modelPath, options_.precision);
+        if (!std::filesystem::exists(variantPath)) {
+            std::wcerr << L"No " << name << L" model at " << variantPath
+                       << L" (see scripts/quantize_model.py), using FP32." << std::endl;
+            return options_.modelPath;
+        }
+
+        // Compare against the FP32 model on sample tiles before trusting the variant. This
+        // loads both models, so the result is kept (in the model cache, or next to the tuning
+        // profiles) until either model, the threshold or the sample settings change.
+        if (options_.minPrecisionPsnr > 0) {
+            std::wstring verdictDir = !options_.modelCacheDir.empty() ? options_.modelCacheDir : options_.tuneProfileDir;
+            std::wstring verdictPath;
+            if (!verdictDir.empty()) {
+                std::ostringstream settings;
+                settings << "min_psnr=" << options_.minPrecisionPsnr << ";device=" << static_cast<int>(options_.device)
+                         << ";scale=" << options_.scale << ";tile=" << options_.tileSize
+                         << ";calibration=" << std::filesystem::path(options_.calibrationDir).u8string();
+                verdictPath = ModelVariants::VerdictPath(verdictDir, options_.modelPath, variantPath, settings.str());
+            }
+
+            double psnr = 0;
+            if (verdictPath.empty() || !ModelVariants::LoadVerdict(verdictPath, psnr)) {
+                InferenceSession reference, variant;
+                reference.SetModelCacheDir(options_.modelCacheDir);
+                variant.SetModelCacheDir(options_.modelCacheDir);
+                if (!reference.LoadModel(options_.modelPath, options_.device) || !variant.LoadModel(variantPath, options_.device)) {
+                    std::cerr << "Could not load the " << name << " model for verification, using FP32." << std::endl;
+                    return options_.modelPath;
+                }
+                int tileSize = options_.tileSize;
+                std::vector<int64_t> shape = reference.GetInputShape();
+                if (shape.size() == 4 && shape[2] > 0) tileSize = static_cast<int>(shape[2]);
+                std::vector<cv::Mat> tiles = ModelVariants::SampleTiles(options_.calibrationDir, tileSize, 4);
+                psnr = ModelVariants::ComparePsnr(reference, variant, tiles, options_.scale);
+                // Failed runs are not cached, they may be transient
+                if (psnr >= 0 && !verdictPath.empty() && !ModelVariants::SaveVerdict(verdictPath, psnr)) {
+                    std::wcerr << L"Could not save the precision check result: " << verdictPath << std::endl;
+                }
+            }
+            if (psnr < options_.minPrecisionPsnr) {
+                std::cerr << name << " model PSNR vs FP32 is " << psnr << " dB (minimum " << options_.minPrecisionPsnr
+                          << " dB), using FP32." << std::endl;
+                return options_.modelPath;
+            }
+            std::cout << "Using the " << name << " model (PSNR vs FP32: " << psnr << " dB)." << std::endl;
+        }
+        loadedPrecision_ = options_.precision;
+        return variantPath;
+    }
+
+    void Engine::ApplyTuneProfile() {
+        if (options_.tuneProfileDir.empty()) return;
+        AutotuneOptions tune;
+        tune.modelPath = loadedModelPath_;
+        tune.modelCacheDir = options_.modelCacheDir;
+        tune.device = options_.device;
+        tune.scale = options_.scale;
+        tune.tileOverlap = options_.tileOverlap;
+        tune.memoryBudgetBytes = options_.autotuneMemoryBytes;
+
+        std::wstring path = Autotuner::ProfilePath(options_.tuneProfileDir, tune);
+        TuneProfile profile;
+        if (!Autotuner::LoadProfile(path, profile)) {
+            if (!options_.autotune) return;
+            std::cout << "Autotuning tile settings for this model, this can take a few minutes..." << std::endl;
+            if (!Autotuner::Tune(tune, profile)) {
+                std::cerr << "Autotuning failed, keeping the configured tile settings." << std::endl;
+                return;
+            }
+            if (!Autotuner::SaveProfile(path, profile)) {
+                std::wcerr << L"Could not save tuning profile: " << path << std::endl;
+            }
+        }
+
+        const EngineOptions::ExplicitTuning& keep = options_.explicitTuning;
+        if (!keep.tileSize) options_.tileSize = profile.tileSize;
+        if (!keep.tileBatchSize) options_.tileBatchSize = profile.tileBatchSize;
+        if (!keep.inferenceWorkers) options_.inferenceWorkers = profile.inferenceWorkers;
+        if (!keep.intraOpThreads) options_.intraOpThreads = profile.intraOpThreads;
+        usedTuneProfile_ = true;
+        std::cout << "Tuned settings: tile " << options_.tileSize << ", batch " << options_.tileBatchSize << ", "
+                  << options_.inferenceWorkers << " worker(s)" << std::endl;
+    }
+
     bool Engine::ProcessFile(const std::wstring& inputPath, const std::wstring& outputPath) {
+        return EnhanceFile(inputPath, outputPath, options_) != FileOutcome::Failed;
+    }
+
+    bool Engine::ProcessFile(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options) {
+        return EnhanceFile(inputPath, outputPath, ImageOptions(options)) != FileOutcome::Failed;
+    }
+
+    namespace {
+
+        // Header over the caller's pixels; no copy
+        cv::Mat WrapView(const ImageView& view) {
+            return cv::Mat(view.height, view.width, CV_8UC(ChannelCount(view.format)), view.data, view.RowBytes());
+        }
+
+        bool IsValidView(const ImageView& view) {
+            return view.data && view.width > 0 && view.height > 0 &&
+                   view.RowBytes() >= static_cast<size_t>(view.width) * ChannelCount(view.format);
+        }
+
+    }
+
+    bool Engine::ProcessPixels(const ImageView& input, const ImageView& output) {
+        return ProcessPixels(input, output, options_);
+    }
+
+    bool Engine::ProcessPixels(const ImageView& input, const ImageView& output, const EngineOptions& requested) {
+        EngineOptions options = ImageOptions(requested);
+        if (!IsValidView(input) || !IsValidView(output)) {
+            std::cerr << "Invalid image buffer." << std::endl;
+            return false;
+        }
+        if (output.width != input.width * options.scale || output.height != input.height * options.scale) {
+            std::cerr << "Output buffer must be " << input.width * options.scale << "x" << input.height * options.scale
+                      << " pixels." << std::endl;
+            return false;
+        }
+
+        Telemetry::FileStats* stats = BeginStats(L"<memory>");
+        Telemetry::FileScope scope(stats);
+
+        // Tiles are read straight from BGR input; other layouts are converted once
+        cv::Mat src = WrapView(input);
+        cv::Mat bgr = src;
+        std::shared_ptr<void> converted;
+        if (input.format != PixelFormat::BGR) {
+            static const int kToBgr[] = {-1, cv::COLOR_RGB2BGR, cv::COLOR_BGRA2BGR, cv::COLOR_RGBA2BGR, cv::COLOR_GRAY2BGR};
+            bgr = BufferPool::AcquireMat(bufferPool_.get(), input.height, input.width, CV_8UC3, converted);
+            cv::cvtColor(src, bgr, kToBgr[static_cast<int>(input.format)]);
+        }
+
+        // BGR output is blended and sharpened in place in the caller's buffer
+        cv::Mat dst = WrapView(output);
+        OutputBand canvas;
+        if (output.format == PixelFormat::BGR) canvas.buffer = dst;
+        bool ok = ProcessImage(bgr, canvas, options);
+
+        if (ok && output.format != PixelFormat::BGR) {
+            static const int kFromBgr[] = {-1, cv::COLOR_BGR2RGB, cv::COLOR_BGR2BGRA, cv::COLOR_BGR2RGBA, cv::COLOR_BGR2GRAY};
+            cv::cvtColor(canvas.buffer, dst, kFromBgr[static_cast<int>(output.format)]);
+            if (ChannelCount(output.format) == 4 && ChannelCount(input.format) == 4) {
+                // Upscaled input alpha; other inputs stay opaque
+                cv::Mat alpha, scaledAlpha;
+                cv::extractChannel(src, alpha, 3);
+                cv::resize(alpha, scaledAlpha, dst.size(), 0, 0, cv::INTER_CUBIC);
+                cv::insertChannel(scaledAlpha, dst, 3);
+            }
+        }
+        FinishStats(stats, ok);
+        return ok;
+    }
+
+    bool Engine::ProcessEncoded(const uint8_t* data, size_t size, const std::wstring& outputPath, const EngineOptions& options) {
+        Telemetry::FileStats* stats = BeginStats(outputPath);
+        Telemetry::FileScope scope(stats);
+
+        cv::Mat img = ImageUtils::DecodeImage(data, size);
+        bool ok = false;
+        if (img.empty()) {
+            std::wcerr << L"Failed to decode image data for: " << outputPath << std::endl;
+        } else {
+            ok = EnhanceImage(img, outputPath, ImageOptions(options));
+        }
+        FinishStats(stats, ok);
+        return ok;
+    }
+
+    bool Engine::ProcessEncoded(const uint8_t* data, size_t size, const std::string& format, std::vector<uint8_t>& encoded,
+                                const EngineOptions& options) {
+        Telemetry::FileStats* stats = BeginStats(L"<memory>");
+        Telemetry::FileScope scope(stats);
+
+        cv::Mat img = ImageUtils::DecodeImage(data, size);
+        bool ok = false;
+        if (img.empty()) {
+            std::cerr << "Failed to decode image data." << std::endl;
+        } else {
+            OutputBand canvas;
+            ok = ProcessImage(img, canvas, ImageOptions(options)) && ImageUtils::EncodeImage(format, canvas.buffer, encoded, options.encode);
+        }
+        FinishStats(stats, ok);
+        return ok;
+    }
+
+    Telemetry::FileStats* Engine::BeginStats(const std::wstring& name) {
+        // Without a collector of its own, the work counts towards the caller's file (if any)
+        return telemetry_ ? telemetry_->AddFile(name) : Telemetry::Current();
+    }
+
+    void Engine::FinishStats(Telemetry::FileStats* stats, bool ok) {
+        if (telemetry_ && stats) stats->Finish(ok);
+    }
+
+    EngineOptions Engine::ImageOptions(const EngineOptions& requested) const {
+        EngineOptions options = options_;
+        options.strength = requested.strength;
+        options.mergeMode = requested.mergeMode;
+        options.featherWindow = requested.featherWindow;
+        options.maxMemoryBytes = requested.maxMemoryBytes;
+        options.encode = requested.encode;
+        return options;
+    }
+
+    std::string Engine::SettingsKey(const EngineOptions& options, const std::wstring& extension) const {
+        // Every option that changes output pixels must be part of the key
+        std::ostringstream settings;
+        settings << "model=" << modelKey_ << ";scale=" << options.scale << ";strength=" << options.strength
+                 << ";tile=" << options.tileSize << ";overlap=" << options.tileOverlap
+                 << ";merge=" << static_cast<int>(options.mergeMode) << ";window=" << static_cast<int>(options.featherWindow)
+                 << ";maxmem=" << options.maxMemoryBytes << ";sharpen=band";
+        // Reused tile outputs are bit-identical, filled tiles are not
+        if (options_.flatTileTolerance >= 0) settings << ";flat=" << options_.flatTileTolerance;
+        if (options_.detailThreshold > 0) settings << ";detail=" << options_.detailThreshold << "," << options_.lowDetailSharpen;
+        // ...and, for the output's format, every encoder setting that changes its bytes
+        std::wstring ext = extension;
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+        const EncodeOptions& encode = options.encode;
+        if (ext.empty() || ext == L".png") {
+            settings << ";png=" << encode.pngCompression << "," << static_cast<int>(encode.pngStrategy);
+        }
+        if (ext.empty() || ext == L".jpg" || ext == L".jpeg") {
+            settings << ";jpeg=" << encode.jpegQuality << "," << encode.jpegProgressive;
+        }
+        if (ext.empty() || ext == L".webp") {
+            settings << ";webp=" << encode.webpQuality;
+        }
+        return settings.str();
+    }
+
+    std::string Engine::ResultCacheKey(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options) const {
+        if (!resultCache_) return std::string();
+        std::wstring extension = std::filesystem::path(outputPath).extension().wstring();
+        return resultCache_->Key(inputPath, SettingsKey(options, extension), extension);
+    }
+
+    Engine::FileOutcome Engine::EnhanceFile(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options) {
+        Telemetry::FileStats* stats = BeginStats(inputPath);
+        Telemetry::FileScope scope(stats);
+        auto finish = [this, stats](FileOutcome outcome) {
+            FinishStats(stats, outcome != FileOutcome::Failed);
+            return outcome;
+        };
+
+        std::string cacheKey;
+        {
+            Telemetry::ScopedTimer timer(Telemetry::Stage::ResultCache);
+            cacheKey = ResultCacheKey(inputPath, outputPath, options);
+            if (!cacheKey.empty() && resultCache_->Fetch(cacheKey, outputPath)) {
+                return finish(FileOutcome::CacheHit);
+            }
+        }
+
         cv::Mat img = ImageUtils::LoadImage(inputPath);
         if (img.empty()) {
             std::wcerr << L"Failed to load image: " << inputPath << std::endl;
-            return false;
+            return finish(FileOutcome::Failed);
         }
+        if (!EnhanceImage(img, outputPath, options)) return finish(FileOutcome::Failed);
 
-        cv::Mat result = ProcessImage(img);
-        if (result.empty()) {
-            return false;
+        if (!cacheKey.empty()) {
+            Telemetry::ScopedTimer timer(Telemetry::Stage::ResultCache);
+            resultCache_->Store(cacheKey, outputPath);
         }
+        return finish(FileOutcome::Enhanced);
+    }
 
+    bool Engine::EnhanceImage(const cv::Mat& img, const std::wstring& outputPath, const EngineOptions& options) {
+        if (ShouldStream(img, outputPath, options)) {
+            return ProcessImageStreamed(img, outputPath, options);
+        }
+        OutputBand canvas;
         // TODO: Handle EXIF copy if keepExif is true (requires external lib or specific OpenCV flags/manual copy)
-
-        return ImageUtils::SaveImage(outputPath, result);
+        return ProcessImage(img, canvas, options) && ImageUtils::SaveImage(outputPath, canvas.buffer, options.encode);
     }
 
-    void Engine::ProcessBatch(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, ProgressCallback callback) {
-        int total = static_cast<int>(inputPaths.size());
-        for (int i = 0; i < total; ++i) {
-            std::filesystem::path p(inputPaths[i]);
-            std::filesystem::path outDir(outputDir);
-            
-            // Construct output filename: name_upscaled.ext
-            std::wstring stem = p.stem().wstring();
-            std::wstring ext = p.extension().wstring();
-            std::wstring outName = stem + L"_upscaled" + ext;
-            std::filesystem::path outPath = outDir / outName;
-
-            if (callback) {
-                ProgressEvent evt;
-                evt.currentFile = p.string();
-                evt.totalFiles = total;
-                evt.currentFileIndex = i + 1;
-                evt.percentComplete = (float)i / total;
-                evt.statusMessage = "Processing...";
-                callback(evt);
-            }
-
-            ProcessFile(inputPaths[i], outPath.wstring());
+    namespace {
+
+        // Band-wise sharpening of the output of `input`, or null when sharpening is off
+        std::unique_ptr<UnsharpMask> MakeSharpener(const cv::Mat& input, const EngineOptions& options, BufferPool* pool) {
+            if (options.strength <= 0) return nullptr;
+            return std::make_unique<UnsharpMask>(input.cols * options.scale, input.rows * options.scale,
+                                                 UnsharpMask::kDefaultSigma, options.strength, pool);
         }
-        
-        if (callback) {
+
+        void ReportFileStarted(const ProgressCallback& callback, const std::wstring& inputPath, int index, int total) {
+            if (!callback) return;
+            ProgressEvent evt;
+            evt.currentFile = std::filesystem::path(inputPath).string();
+            evt.totalFiles = total;
+            evt.currentFileIndex = index + 1;
+            evt.percentComplete = (float)index / total;
+            evt.statusMessage = "Processing...";
+            callback(evt);
+        }
+
+        void ReportBatchDone(const ProgressCallback& callback) {
+            if (!callback) return;
             ProgressEvent evt;
             evt.percentComplete = 1.0f;
             evt.statusMessage = "Done";
             callback(evt);
         }
+
+        struct DecodedImage {
+            cv::Mat image;
+            std::string cacheKey;  // Result cache key, empty when caching is off
+            bool cacheHit = false; // Output already copied from the result cache; nothing decoded
+        };
+
+        struct EncodeJob {
+            size_t index = 0; // Position in the batch
+            std::wstring outputPath;
+            cv::Mat image;
+            std::shared_ptr<void> storage; // Keeps a pooled image alive until it is written
+            std::string cacheKey;
+            Telemetry::FileStats* stats = nullptr;
+        };
+
+    }
+
+    std::wstring Engine::OutputPathFor(const std::wstring& inputPath, const std::wstring& outputDir) {
+        // name_upscaled.ext
+        std::filesystem::path p(inputPath);
+        std::wstring outName = p.stem().wstring() + L"_upscaled" + p.extension().wstring();
+        return (std::filesystem::path(outputDir) / outName).wstring();
+    }
+
+    std::string Engine::OutputSettingsKey() const {
+        return Hash::ToHex(Hash::String(SettingsKey(options_, L"")));
+    }
+
+    void Engine::StartJournal(std::vector<std::wstring>& inputPaths, std::vector<std::wstring>& outputPaths, BatchSummary& summary) {
+        journal_.reset();
+        if (options_.journalPath.empty()) return;
+
+        auto journal = std::make_unique<BatchJournal>(options_.journalPath, OutputSettingsKey());
+        if (!journal->Open(options_.resume)) {
+            std::cerr << "Continuing without a batch journal." << std::endl;
+            return;
+        }
+        journal_ = std::move(journal);
+        if (!options_.resume) return;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < inputPaths.size(); ++i) {
+            if (journal_->Finished(inputPaths[i], outputPaths[i])) {
+                summary.resumed++;
+                continue;
+            }
+            if (kept != i) {
+                inputPaths[kept] = std::move(inputPaths[i]);
+                outputPaths[kept] = std::move(outputPaths[i]);
+            }
+            kept++;
+        }
+        if (summary.resumed > 0) {
+            std::cout << "Resuming: " << summary.resumed << " of " << inputPaths.size() << " files already done." << std::endl;
+        }
+        inputPaths.resize(kept);
+        outputPaths.resize(kept);
     }
 
-    cv::Mat Engine::ProcessImage(const cv::Mat& input) {
-        // 1. Split into tiles
-        // Note: We need to handle overlap and padding.
-        // For simplicity in this skeleton, we assume the model output size = input size * scale.
-        
-        int scale = options_.scale;
-        int tileSize = options_.tileSize;
-        int overlap = options_.tileOverlap;
+    BatchSummary Engine::ProcessBatch(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, ProgressCallback callback) {
+        std::vector<std::wstring> outputPaths;
+        outputPaths.reserve(inputPaths.size());
+        for (const auto& inputPath : inputPaths) outputPaths.push_back(OutputPathFor(inputPath, outputDir));
+        return ProcessBatch(inputPaths, outputPaths, callback);
+    }
+
+    BatchSummary Engine::ProcessBatch(const std::vector<std::wstring>& allInputPaths, const std::vector<std::wstring>& allOutputPaths,
+                                      ProgressCallback callback) {
+        if (allInputPaths.size() != allOutputPaths.size()) {
+            std::cerr << "Batch has " << allInputPaths.size() << " inputs but " << allOutputPaths.size() << " outputs." << std::endl;
+            return BatchSummary();
+        }
+        if (telemetry_) telemetry_->BeginBatch();
+        BatchSummary resumed;
+        std::vector<std::wstring> inputPaths = allInputPaths;
+        std::vector<std::wstring> outputPaths = allOutputPaths;
+        StartJournal(inputPaths, outputPaths, resumed);
+        auto finishBatch = [&](BatchSummary summary) {
+            journal_.reset(); // Syncs the last records
+            summary.totalFiles += resumed.resumed;
+            summary.resumed = resumed.resumed;
+            if (telemetry_) telemetry_->EndBatch();
+            return summary;
+        };
+        if (options_.pipelineBatch && inputPaths.size() > 1) {
+            return finishBatch(ProcessBatchPipelined(inputPaths, outputPaths, callback));
+        }
+
+        BatchSummary summary;
+        int total = static_cast<int>(inputPaths.size());
+        summary.totalFiles = total;
+        FilePrefetcher prefetcher(inputPaths, total > 1 ? static_cast<size_t>(std::max(0, options_.prefetchFiles)) : 0);
+        for (int i = 0; i < total; ++i) {
+            prefetcher.Advance(i);
+            ReportFileStarted(callback, inputPaths[i], i, total);
+            const std::wstring& outputPath = outputPaths[i];
+            FileOutcome outcome = EnhanceFile(inputPaths[i], outputPath, options_);
+            if (journal_) journal_->RecordFile(inputPaths[i], outputPath, outcome != FileOutcome::Failed);
+            if (outcome == FileOutcome::Failed) {
+                summary.failed++;
+                summary.failedFiles.push_back(inputPaths[i]);
+            } else {
+                summary.succeeded++;
+            }
+            if (outcome == FileOutcome::CacheHit) summary.cacheHits++;
+            else if (resultCache_) summary.cacheMisses++;
+        }
+
+        ReportBatchDone(callback);
+        return finishBatch(std::move(summary));
+    }
+
+    BatchSummary Engine::ProcessQueued(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, WorkQueue& queue,
+                                       ProgressCallback callback) {
+        // File by file: the outcome of each claim must be known before it is completed,
+        // and which files come next depends on the other workers.
+        if (telemetry_) telemetry_->BeginBatch();
+        BatchSummary summary;
+        int total = static_cast<int>(inputPaths.size());
+        size_t i = 0;
+        while (queue.Claim(i)) {
+            ReportFileStarted(callback, inputPaths[i], static_cast<int>(queue.FinishedCount()), total);
+            FileOutcome outcome = EnhanceFile(inputPaths[i], OutputPathFor(inputPaths[i], outputDir), options_);
+            if (!queue.Complete(i, outcome != FileOutcome::Failed)) {
+                // Taken over after a stall: the new owner processes and counts it
+                std::wcerr << L"Lease lost, leaving " << inputPaths[i] << L" to another worker" << std::endl;
+                continue;
+            }
+            summary.totalFiles++;
+            if (outcome == FileOutcome::Failed) {
+                summary.failed++;
+                summary.failedFiles.push_back(inputPaths[i]);
+            } else {
+                summary.succeeded++;
+            }
+            if (outcome == FileOutcome::CacheHit) summary.cacheHits++;
+            else if (resultCache_) summary.cacheMisses++;
+        }
+
+        if (telemetry_) telemetry_->EndBatch();
+        ReportBatchDone(callback);
+        return summary;
+    }
+
+    BatchSummary Engine::ProcessBatchPipelined(const std::vector<std::wstring>& inputPaths, const std::vector<std::wstring>& outputPaths,
+                                               ProgressCallback callback) {
+        // Stage 1: a decoder pool reads and decodes files ahead of inference
+        //          (result cache hits are copied here and never decoded).
+        // Stage 2: this thread feeds images to the tile scheduler in input order.
+        // Stage 3: an encoder pool encodes results to temporary files in parallel;
+        //          they are renamed into place in input order.
+        int total = static_cast<int>(inputPaths.size());
+        size_t depth = static_cast<size_t>(std::max(1, options_.pipelineDepth));
+        int decodeThreads = std::max(1, std::min(options_.decodeThreads, total));
+        int encodeThreads = std::max(1, std::min(options_.encodeThreads, total));
+
+        ReorderWindow<DecodedImage> decoded(depth);
+        BoundedQueue<EncodeJob> encodeQueue(depth);
+        std::atomic<size_t> nextToDecode{0};
+        std::atomic<int> succeeded{0};
+        std::vector<char> outputDone(inputPaths.size(), 0); // Per index, set once its output is in place
+        std::atomic<int> cacheHits{0};
+        std::atomic<int> cacheMisses{0};
+
+        // Stats are created up front so their order matches the input
+        std::vector<Telemetry::FileStats*> fileStats(inputPaths.size(), nullptr);
+        if (telemetry_) {
+            for (size_t i = 0; i < inputPaths.size(); ++i) fileStats[i] = telemetry_->AddFile(inputPaths[i]);
+        }
+
+        FilePrefetcher prefetcher(inputPaths, static_cast<size_t>(std::max(0, options_.prefetchFiles)));
+        std::vector<std::thread> decoders;
+        for (int t = 0; t < decodeThreads; ++t) {
+            decoders.emplace_back([&]() {
+                for (;;) {
+                    size_t i = nextToDecode.fetch_add(1);
+                    if (i >= inputPaths.size() || !decoded.WaitForSlot(i)) break;
+                    prefetcher.Advance(i);
+
+                    // Every claimed index must be Put, even on failure, so the
+                    // inference stage never waits on a missing slot.
+                    DecodedImage item;
+                    Telemetry::FileScope scope(fileStats[i]);
+                    try {
+                        const std::wstring& outputPath = outputPaths[i];
+                        {
+                            Telemetry::ScopedTimer timer(Telemetry::Stage::ResultCache);
+                            item.cacheKey = ResultCacheKey(inputPaths[i], outputPath, options_);
+                            item.cacheHit = !item.cacheKey.empty() && resultCache_->Fetch(item.cacheKey, outputPath);
+                        }
+                        if (item.cacheHit) {
+                            if (fileStats[i]) fileStats[i]->Finish(true);
+                            if (journal_) journal_->RecordFile(inputPaths[i], outputPath, true);
+                            outputDone[i] = 1;
+                            cacheHits++;
+                            succeeded++;
+                        } else {
+                            if (resultCache_) cacheMisses++;
+                            item.image = ImageUtils::LoadImage(inputPaths[i]);
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Decode failed: " << e.what() << std::endl;
+                    }
+                    decoded.Put(i, std::move(item));
+                }
+            });
+        }
+
+        // Successful outputs are counted and added to the result cache once written
+        auto outputWritten = [&](size_t index, const std::wstring& outputPath, const std::string& cacheKey) {
+            if (journal_) journal_->RecordFile(inputPaths[index], outputPath, true);
+            outputDone[index] = 1;
+            succeeded++;
+            if (!cacheKey.empty()) {
+                Telemetry::ScopedTimer timer(Telemetry::Stage::ResultCache);
+                resultCache_->Store(cacheKey, outputPath);
+            }
+            if (Telemetry::FileStats* stats = Telemetry::Current()) stats->Finish(true);
+        };
+
+        // Every index is marked done exactly once: encoded outputs when their temporary
+        // file is ready, everything else (cache hits, failures, streamed outputs) by the
+        // inference stage. Only encoded outputs wait for their turn to appear.
+        InOrderCompletion published;
+
+        std::vector<std::thread> encoders;
+        for (int t = 0; t < encodeThreads; ++t) {
+            encoders.emplace_back([&]() {
+                EncodeJob job;
+                while (encodeQueue.Pop(job)) {
+                    Telemetry::FileScope scope(job.stats);
+                    std::filesystem::path temp = FileUtils::TempPathFor(job.outputPath);
+                    bool written = false;
+                    try {
+                        written = ImageUtils::WriteImage(temp.wstring(), ImageUtils::FormatFor(job.outputPath), job.image, options_.encode);
+                        if (!written) {
+                            std::wcerr << L"Failed to save image: " << job.outputPath << std::endl;
+                        } else if (!job.cacheKey.empty()) {
+                            Telemetry::ScopedTimer timer(Telemetry::Stage::ResultCache);
+                            resultCache_->Store(job.cacheKey, temp.wstring());
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Encode failed: " << e.what() << std::endl;
+                    }
+
+                    if (!written) {
+                        std::error_code ec;
+                        std::filesystem::remove(temp, ec);
+                        published.Done(job.index, nullptr);
+                    } else {
+                        published.Done(job.index, [&, temp, index = job.index, outputPath = job.outputPath, stats = job.stats]() {
+                            if (!FileUtils::Publish(temp, outputPath)) {
+                                std::wcerr << L"Failed to save image: " << outputPath << std::endl;
+                                return;
+                            }
+                            if (journal_) journal_->RecordFile(inputPaths[index], outputPath, true);
+                            outputDone[index] = 1;
+                            succeeded++;
+                            if (stats) stats->Finish(true);
+                        });
+                    }
+                    job = EncodeJob();
+                }
+            });
+        }
+
+        // The next image's tiles are queued before the current image is finished, so
+        // inference workers that run out of tiles move straight on to the next image.
+        struct InFlightImage {
+            size_t index = 0;
+            std::wstring outputPath;
+            std::string cacheKey;
+            Telemetry::FileStats* stats = nullptr;
+            std::unique_ptr<OutputBand> canvas;
+            std::shared_ptr<TileJob> job;
+            InOrderCompletion* published = nullptr;
+            bool encoding = false; // Handed to an encoder, which marks it done
+
+            // Never free the canvas under workers still merging into it, and mark the
+            // image done however it ends, exceptions included, unless an encoder has it
+            ~InFlightImage() {
+                if (job) job->Wait();
+                if (encoding || !published) return;
+                try {
+                    published->Done(index, nullptr);
+                } catch (const std::exception& e) {
+                    std::cerr << "Publishing failed: " << e.what() << std::endl;
+                }
+            }
+        };
+        std::unique_ptr<InFlightImage> inFlight;
+
+        auto finishImage = [&](std::unique_ptr<InFlightImage> image) {
+            if (!image || !image->job->Wait()) return;
+            // Already sharpened band by band during the merge
+            image->encoding = encodeQueue.Push({image->index, image->outputPath, image->canvas->buffer, image->canvas->storage,
+                                                image->cacheKey, image->stats});
+            if (image->encoding && telemetry_) telemetry_->Peak(Telemetry::Gauge::EncodeQueueDepth, encodeQueue.Size());
+        };
+
+        for (int i = 0; i < total; ++i) {
+            if (telemetry_) telemetry_->Peak(Telemetry::Gauge::DecodeQueueDepth, decoded.Size());
+            DecodedImage item;
+            if (!decoded.Take(item)) break;
+            Telemetry::FileScope scope(fileStats[i]);
 
-        // Pre-allocate canvas
+            ReportFileStarted(callback, inputPaths[i], i, total);
+
+            if (item.cacheHit) {
+                published.Done(i, nullptr);
+                continue;
+            }
+            if (item.image.empty()) {
+                std::wcerr << L"Failed to load image: " << inputPaths[i] << std::endl;
+                published.Done(i, nullptr);
+                continue;
+            }
+
+            const std::wstring& outputPath = outputPaths[i];
+            bool handedOff = false; // Once its InFlightImage exists, that marks image i done
+            try {
+                // Oversized images are streamed to disk from this thread; there is
+                // no finished image to hand to the encoders. They appear when finished.
+                if (ShouldStream(item.image, outputPath, options_)) {
+                    finishImage(std::move(inFlight));
+                    if (ProcessImageStreamed(item.image, outputPath, options_)) {
+                        outputWritten(i, outputPath, item.cacheKey);
+                    }
+                    published.Done(i, nullptr);
+                    continue;
+                }
+
+                // Pre-allocate canvas. Every pixel is covered by a tile, so no clearing is needed.
+                auto next = std::make_unique<InFlightImage>();
+                next->index = i;
+                next->published = &published;
+                handedOff = true;
+                next->outputPath = outputPath;
+                next->cacheKey = item.cacheKey;
+                next->stats = fileStats[i];
+                next->canvas = std::make_unique<OutputBand>();
+                next->canvas->buffer = BufferPool::AcquireMat(bufferPool_.get(), item.image.rows * options_.scale,
+                                                              item.image.cols * options_.scale, CV_8UC3, next->canvas->storage);
+                next->canvas->sharpen = MakeSharpener(item.image, options_, bufferPool_.get());
+                next->job = StartTiles(item.image, *next->canvas, options_);
+
+                // Workers are merging into the new canvas from here on, so it is parked in
+                // inFlight (which outlives an exception below) before the previous image is finished
+                std::unique_ptr<InFlightImage> previous = std::move(inFlight);
+                inFlight = std::move(next);
+                finishImage(std::move(previous));
+            } catch (const std::exception& e) {
+                std::cerr << "Processing failed: " << e.what() << std::endl;
+                if (!handedOff) published.Done(i, nullptr);
+            }
+        }
+        try {
+            finishImage(std::move(inFlight));
+        } catch (const std::exception& e) {
+            std::cerr << "Processing failed: " << e.what() << std::endl;
+        }
+
+        decoded.Close();
+        encodeQueue.Close();
+        for (auto& t : decoders) t.join();
+        for (auto& t : encoders) t.join();
+
+        ReportBatchDone(callback);
+
+        BatchSummary summary;
+        summary.totalFiles = total;
+        summary.succeeded = succeeded;
+        summary.failed = total - succeeded;
+        for (int i = 0; i < total; ++i) {
+            if (outputDone[i]) continue;
+            summary.failedFiles.push_back(inputPaths[i]);
+            if (journal_) journal_->RecordFile(inputPaths[i], outputPaths[i], false);
+        }
+        summary.cacheHits = cacheHits;
+        summary.cacheMisses = cacheMisses;
+        return summary;
+    }
+
+    namespace {
+
+        // Bytes that do not depend on the band height: the decoded input, the feather
+        // accumulators, the tile tensors, the sharpening rows and the reused tile outputs.
+        size_t FixedWorkingSetBytes(const cv::Mat& input, const EngineOptions& options, int tileBatchSize, size_t tileReuseBytes) {
+            int scale = options.scale;
+            size_t tileH = std::min(options.tileSize, input.rows);
+            size_t tileW = std::min(options.tileSize, input.cols);
+            size_t outW = static_cast<size_t>(input.cols) * scale;
+            size_t bytes = input.total() * input.elemSize();
+            if (options.mergeMode == TileMergeMode::Feather) {
+                bytes += 4 * sizeof(float) * tileH * scale * outW;
+            }
+            bytes += sizeof(float) * 3 * tileH * tileW * (1 + scale * scale) * tileBatchSize;
+            if (options.strength > 0) {
+                bytes += UnsharpMask::WorkingSetBytes(static_cast<int>(outW), UnsharpMask::kDefaultSigma);
+            }
+            return bytes + tileReuseBytes;
+        }
+
+        // Output rows a sharpened band keeps beyond the finished ones
+        int SharpenHalo(const EngineOptions& options) {
+            return options.strength > 0 ? UnsharpMask::RadiusFor(UnsharpMask::kDefaultSigma) : 0;
+        }
+
+        // Input row to restart a streamed image from when its first `rowsDone` output rows
+        // are already written: the latest tile row whose output, past the rows it shares
+        // with the tile row above and the sharpening halo, is identical when processed
+        // without the rows above it. 0 if there is none.
+        int ResumeOrigin(int inputRows, const EngineOptions& options, int rowsDone) {
+            std::vector<int> origins = ImageUtils::TileOrigins(inputRows, options.tileSize, options.tileOverlap);
+            int origin = 0;
+            for (size_t k = 1; k < origins.size(); ++k) {
+                int identicalFrom = (origins[k - 1] + options.tileSize) * options.scale + SharpenHalo(options);
+                if (identicalFrom <= rowsDone) origin = origins[k];
+            }
+            return origin;
+        }
+
+    }
+
+    bool Engine::ShouldStream(const cv::Mat& input, const std::wstring& outputPath, const EngineOptions& options) const {
+        if (options.maxMemoryBytes == 0) return false;
+
+        size_t canvasBytes = static_cast<size_t>(input.rows) * input.cols * options.scale * options.scale * 3;
+        size_t estimate = FixedWorkingSetBytes(input, options, tileBatchSize_, tileReuseBytes_) + canvasBytes;
+        if (estimate <= options.maxMemoryBytes) return false;
+
+        if (!RowWriter::ForPath(outputPath)) {
+            std::wcerr << L"Output exceeds the memory budget but cannot be streamed (PNG only), processing in memory: "
+                       << outputPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool Engine::ProcessImageStreamed(const cv::Mat& input, const std::wstring& outputPath, const EngineOptions& options) {
+        int scale = options.scale;
         int outH = input.rows * scale;
         int outW = input.cols * scale;
-        cv::Mat canvas = cv::Mat::zeros(outH, outW, CV_8UC3);
+        int tileOutH = std::min(options.tileSize, input.rows) * scale;
+        int stepOut = std::max(1, options.tileSize - options.tileOverlap) * scale;
+        int tileRowCount = static_cast<int>(ImageUtils::TileOrigins(input.rows, options.tileSize, options.tileOverlap).size());
 
-        std::vector<ImageTile> tiles = ImageUtils::SplitTiles(input, tileSize, overlap);
-        
-        // Get expected input shape from model to verify
-        // std::vector<int64_t> inputShape = session_->GetInputShape(); 
-        // Typically [1, 3, H, W] or dynamic.
-
-        for (const auto& tile : tiles) {
-            // Pre-process tile
-            std::vector<float> inputData = ImageUtils::PreProcess(tile.data);
-            std::vector<int64_t> inputDims = {1, 3, tile.height, tile.width};
-
-            // Run Inference
-            std::vector<float> outputData = session_->Run(inputData, inputDims);
-            if (outputData.empty()) {
-                std::cerr << "Inference returned empty data for tile." << std::endl;
-                continue; 
-            }
-
-            // Post-process tile
-            // Output dims should be [1, 3, H*scale, W*scale]
-            int outTileH = tile.height * scale;
-            int outTileW = tile.width * scale;
-            
-            cv::Mat resultTile = ImageUtils::PostProcess(outputData.data(), 3, outTileH, outTileW);
-
-            // Place into canvas
-            // We need to map original tile coordinates to scaled coordinates
-            int targetX = tile.x * scale;
-            int targetY = tile.y * scale;
-            
-            // Simple copy for now (no blending yet)
-            // Be careful with boundaries
-            if (targetX + outTileW <= outW && targetY + outTileH <= outH) {
-                resultTile.copyTo(canvas(cv::Rect(targetX, targetY, outTileW, outTileH)));
-            } else {
-                // Crop if necessary (shouldn't happen if logic is correct)
-                int w = std::min(outTileW, outW - targetX);
-                int h = std::min(outTileH, outH - targetY);
-                resultTile(cv::Rect(0,0,w,h)).copyTo(canvas(cv::Rect(targetX, targetY, w, h)));
+        // A band of k tile rows spans at most (k - 1) * stepOut + tileOutH output rows,
+        // plus the rows held back for the sharpening halo.
+        // Each band row costs its BGR pixels, the PNG scanlines and the compressed chunk.
+        int halo = SharpenHalo(options);
+        size_t rowBytes = static_cast<size_t>(outW) * 3 * 3;
+        size_t fixedBytes = FixedWorkingSetBytes(input, options, tileBatchSize_, tileReuseBytes_);
+        size_t availableRows = options.maxMemoryBytes > fixedBytes ? (options.maxMemoryBytes - fixedBytes) / rowBytes : 0;
+        int tileRows = 1;
+        if (availableRows > static_cast<size_t>(tileOutH + halo)) {
+            size_t extra = (availableRows - tileOutH - halo) / stepOut;
+            tileRows = static_cast<int>(std::min<size_t>(tileRowCount, 1 + extra));
+        } else {
+            std::cout << "Memory budget is below the minimum working set, using one tile row per band." << std::endl;
+        }
+
+        // In a journaled batch the output is written to a partial file that outlives a crash,
+        // with a checkpoint after every band. On resume, processing restarts a few tile rows
+        // above the last checkpoint and the rows the file already has are dropped.
+        std::unique_ptr<RowWriter> writer = RowWriter::ForPath(outputPath, options.encode);
+        cv::Mat source = input;
+        int skipRows = 0;
+        bool resumed = false;
+        std::string journalKey;
+        if (writer && journal_) {
+            std::string identity = SettingsKey(options, std::filesystem::path(outputPath).extension().wstring()) +
+                                   ";out=" + std::filesystem::path(outputPath).u8string() + ";size=" +
+                                   std::to_string(input.cols) + "x" + std::to_string(input.rows);
+            uint64_t pixels = input.isContinuous() ? Hash::Bytes(input.data, input.total() * input.elemSize()) : 0;
+            journalKey = Hash::ToHex(Hash::String(identity, pixels));
+            std::filesystem::path partial = outputPath;
+            partial += L".partial";
+            writer->SetPartialPath(partial);
+
+            RowCheckpoint checkpoint;
+            if (options_.resume && journal_->FindBand(journalKey, checkpoint)) {
+                int origin = ResumeOrigin(input.rows, options, checkpoint.rows);
+                if (origin > 0 && writer->Resume(outputPath, outW, outH, checkpoint)) {
+                    source = input.rowRange(origin, input.rows);
+                    skipRows = checkpoint.rows - origin * scale;
+                    resumed = true;
+                    std::wcout << L"Resuming " << outputPath << L" after row " << checkpoint.rows << L" of " << outH << std::endl;
+                }
             }
         }
+        if (!resumed && (!writer || !writer->Open(outputPath, outW, outH))) {
+            std::wcerr << L"Failed to open output for streaming: " << outputPath << std::endl;
+            return false;
+        }
+
+        OutputBand band;
+        band.buffer = BufferPool::AcquireMat(bufferPool_.get(), std::min(outH, (tileRows - 1) * stepOut + tileOutH + halo),
+                                             outW, CV_8UC3, band.storage);
+        band.writer = writer.get();
+        band.tileRows = tileRows;
+        band.skipRows = skipRows;
+        band.journal = journal_.get();
+        band.journalKey = journalKey;
+        band.sharpen = MakeSharpener(source, options, bufferPool_.get());
 
-        // Optional: Sharpen
-        if (options_.strength > 0) {
-            canvas = ImageUtils::Sharpen(canvas, options_.strength);
+        bool ok = RunTiles(source, band, options);
+        {
+            Telemetry::ScopedTimer timer(Telemetry::Stage::Encode);
+            // An unfinished output is never published; the writer removes it
+            ok = ok && writer->Close();
         }
+        if (ok) {
+            std::error_code ec;
+            uintmax_t written = std::filesystem::file_size(outputPath, ec);
+            if (!ec) Telemetry::Count(Telemetry::Counter::BytesWritten, written);
+        } else {
+            std::wcerr << L"Failed to write image: " << outputPath << std::endl;
+        }
+        return ok;
+    }
+
+    bool Engine::ProcessImage(const cv::Mat& input, OutputBand& canvas, const EngineOptions& options) {
+        // Pre-allocate canvas, unless the caller supplied one. Every pixel is covered by a tile, so no clearing is needed.
+        if (canvas.buffer.empty()) {
+            canvas.buffer = BufferPool::AcquireMat(bufferPool_.get(), input.rows * options.scale, input.cols * options.scale,
+                                                   CV_8UC3, canvas.storage);
+        }
+        canvas.sharpen = MakeSharpener(input, options, bufferPool_.get());
+        return RunTiles(input, canvas, options);
+    }
+
+    std::shared_ptr<TileJob> Engine::StartTiles(const cv::Mat& input, OutputBand& out, const EngineOptions& options) {
+        // Note: model output size is assumed to be input size * scale.
+        int scale = options.scale;
+        int tileSize = options.tileSize;
+        int overlap = options.tileOverlap;
+
+        // All tiles share one size, so consecutive tiles can be packed into a
+        // single [N, 3, H, W] tensor.
+        // Tiles are read straight from the input ROI, without copies.
+        std::vector<cv::Rect> tiles = ImageUtils::TileRects(input.size(), tileSize, overlap);
+        TileLayout layout = TileLayout::FromInput(input.size(), tileSize, overlap, scale);
+        auto blender = std::make_shared<TileBlender>(layout, options.mergeMode, options.featherWindow, bufferPool_.get());
+        size_t cols = layout.xs.size();
+
+        // The scheduler hands over batches in tile order, so tiles arrive row-major
+        // and a tile row is complete after its last column.
+        // Finished rows are sharpened right after each batch, while they are still in cache.
+        auto consume = [blender, &out, cols](size_t first, size_t count, const float* output, size_t outTileSize) {
+            for (size_t k = 0; k < count; ++k) {
+                int col = static_cast<int>((first + k) % cols);
+                int row = static_cast<int>((first + k) / cols);
+                if (out.writer && col == 0 && row > 0 && row % out.tileRows == 0 && !out.Flush(blender->FinishedRows())) {
+                    return false;
+                }
+                Telemetry::ScopedTimer timer(Telemetry::Stage::Blend);
+                blender->AddTile(col, row, output + k * outTileSize, out.buffer, out.top);
+                if (col + 1 == static_cast<int>(cols)) {
+                    blender->FinishTileRow(row, out.buffer, out.top);
+                }
+            }
+            out.Sharpen(blender->FinishedRows());
+            return true;
+        };
+
+        return scheduler_->Submit(input, std::move(tiles), scale, consume);
+    }
 
-        return canvas;
+    bool Engine::RunTiles(const cv::Mat& input, OutputBand& out, const EngineOptions& options) {
+        if (!StartTiles(input, out, options)->Wait()) return false;
+        return !out.writer || out.Flush(input.rows * options.scale);
     }
 
 }
@@ -4,12 +4,25 @@
 #include <vector>
 #include <functional>
 #include <memory>
+#include <opencv2/opencv.hpp>
+#include "Autotuner.hpp"
+#include "BatchJournal.hpp"
+#include "BufferPool.hpp"
+#include "ImageUtils.hpp"
+#include "ImageView.hpp"
 #include "InferenceSession.hpp"
+#include "ModelVariants.hpp"
+#include "ResultCache.hpp"
+#include "Telemetry.hpp"
+#include "TileBlender.hpp"
+#include "TileScheduler.hpp"
+#include "WorkQueue.hpp"
 
 namespace Core {
 
     struct EngineOptions {
         std::wstring modelPath;
+        std::wstring modelCacheDir; // Optimized models are cached here for fast startup; empty disables
         std::wstring faceModelPath; // Optional
         Device device = Device::CPU;
         int scale = 4;
@@ -17,7 +30,98 @@ namespace Core {
         bool enableFaceEnhance = false;
         int tileSize = 256; // Input tile size
         int tileOverlap = 16;
+        int tileBatchSize = 1; // Tiles per inference call; forced to 1 for models with a static batch dim
+        TileMergeMode mergeMode = TileMergeMode::Feather; // How overlapping tiles are combined
+        FeatherWindow featherWindow = FeatherWindow::Linear;
+
+        // Tile skipping. A tile with the same pixels as one already inferred (in the same
+        // image, or a recent one) gets a copy of its output, bit for bit; up to tileReuseBytes
+        // of outputs are kept for this (0 disables reuse), at most a quarter of maxMemoryBytes
+        // when that is set, and counted in its working set. Tiles whose channels each vary
+        // by at most flatTileTolerance (0-255) are filled with their mean colour instead of
+        // being inferred: -1 disables this, 0 fills only single-colour tiles.
+        size_t tileReuseBytes = 256ull << 20;
+        int flatTileTolerance = -1;
+
+        // Adaptive compute: tiles whose detail (see TileDetail) is below detailThreshold
+        // are upscaled with bicubic interpolation instead of being inferred (0 disables it).
+        // Feathered merging blends them into their inferred neighbours over the tile
+        // overlap; with CropToCenter seams can show. Like every tile they are then sharpened
+        // by `strength`; lowDetailSharpen adds an unsharp mask on those tiles alone (0: none).
+        double detailThreshold = 0;
+        double lowDetailSharpen = 0;
         bool keepExif = true;
+
+        // Output encoder settings (PNG level and strategy, JPEG quality, ...). Outputs are
+        // always written under a temporary name and renamed into place when complete.
+        EncodeOptions encode;
+
+        // Tile inference workers, each with its own model session. Tiles are spread
+        // across them, and in a pipelined batch idle workers start on the next image.
+        // GPU devices always use one worker.
+        int inferenceWorkers = 1;
+        int intraOpThreads = 0; // Per worker; 0 = ORT default (cores / workers with several workers)
+        int interOpThreads = 0; // Per worker; 0 = ORT default
+
+        // Reduced precision: load the FP16 or INT8 variant of modelPath made by
+        // scripts/quantize_model.py. Initialize first checks its output against the FP32
+        // model on tiles from calibrationDir (or a synthetic tile) and keeps FP32 if the
+        // PSNR is below minPrecisionPsnr (0 skips the check), or if there is no variant.
+        // The outcome is cached in modelCacheDir (else tuneProfileDir) per pair of model files.
+        ModelPrecision precision = ModelPrecision::FP32;
+        std::wstring calibrationDir;
+        double minPrecisionPsnr = 38.0;
+
+        // Tuning profiles: the fastest tile size, tile batch and worker/thread split measured
+        // for a model on this machine. Initialize applies a stored profile over tileSize,
+        // tileBatchSize, inferenceWorkers and intraOpThreads, except those marked in
+        // explicitTuning. With autotune set and no profile yet, it benchmarks the candidates
+        // first (this can take a few minutes). A tuned tile size changes OutputSettingsKey.
+        std::wstring tuneProfileDir; // Empty disables profiles
+        bool autotune = false;
+        struct ExplicitTuning {
+            bool tileSize = false;
+            bool tileBatchSize = false;
+            bool inferenceWorkers = false;
+            bool intraOpThreads = false;
+        } explicitTuning; // Set by the caller; a profile leaves these fields alone
+        size_t autotuneMemoryBytes = 2ull << 30; // Estimated inference memory limit for candidates (0 = unlimited)
+
+        // Peak memory budget for one image in bytes (0 = unlimited). Images whose output
+        // would not fit are streamed: tiles are processed in horizontal bands and finished
+        // rows are written to the output file as they complete (PNG output only).
+        size_t maxMemoryBytes = 0;
+
+        // Result cache: outputs are stored under a hash of the input file bytes and the
+        // settings above; later requests for the same input and settings copy the stored file.
+        std::wstring resultCacheDir; // Empty disables the cache
+        uint64_t resultCacheMaxBytes = 2ull << 30; // Least recently used entries are removed beyond this
+
+        // Batch pipeline: decode, inference and encode run as separate stages
+        // connected by bounded queues, so decoding/encoding overlaps inference.
+        bool pipelineBatch = false;
+        int decodeThreads = 2;
+        int encodeThreads = 2;
+        int pipelineDepth = 4; // Max images buffered between two stages
+
+        // Batches read this many upcoming input files into the OS cache in the
+        // background while the current ones are processed (0 = off)
+        int prefetchFiles = 4;
+
+        // Batches record finished files in this journal (empty disables it). With `resume`,
+        // files an earlier run of the same batch and settings finished are skipped, and
+        // streamed outputs continue after their last durable band.
+        std::wstring journalPath;
+        bool resume = false;
+
+        // Output canvases, streamed bands and merge/sharpen scratch buffers are recycled
+        // across images. At most this many bytes of idle buffers are kept; 0 keeps as
+        // much as the batch ever had in use at once.
+        size_t bufferPoolBytes = 0;
+
+        // Per-stage timers and counters for each file and batch, read back through Stats()
+        bool collectStats = false;
+        bool collectTrace = false; // Also keep every timed span for a Chrome trace; implies collectStats
     };
 
     struct ProgressEvent {
@@ -30,6 +134,16 @@ namespace Core {
 
     using ProgressCallback = std::function<void(const ProgressEvent&)>;
 
+    struct BatchSummary {
+        int totalFiles = 0;
+        int succeeded = 0;   // Outputs written, cache hits included
+        int failed = 0;
+        int cacheHits = 0;   // Outputs copied from the result cache
+        int cacheMisses = 0; // Cache lookups that found nothing
+        int resumed = 0;     // Skipped: finished by an earlier run (EngineOptions::resume)
+        std::vector<std::wstring> failedFiles; // Inputs of the failed files, in processing order
+    };
+
     class Engine {
     public:
         Engine(const EngineOptions& options);
@@ -38,19 +152,150 @@ namespace Core {
         // Initialize models (warmup)
         bool Initialize();
 
+        // Precision of the model Initialize() loaded; FP32 if the requested variant was rejected
+        ModelPrecision LoadedPrecision() const { return loadedPrecision_; }
+
+        // True if Initialize() applied a tuning profile
+        bool UsedTuneProfile() const { return usedTuneProfile_; }
+
+        // True if Initialize() loaded the model from the optimized model cache
+        bool UsedModelCache() const { return usedModelCache_; }
+
         // Process a single file
         bool ProcessFile(const std::wstring& inputPath, const std::wstring& outputPath);
 
-        // Process a batch of files
-        void ProcessBatch(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, ProgressCallback callback);
+        // Per-call variants: strength, mergeMode, featherWindow, maxMemoryBytes and encode
+        // are taken from `options`, everything tied to the loaded model (scale, tile size,
+        // device, ...) from the engine's own options. Safe to call from several threads.
+        bool ProcessFile(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options);
+
+        // In-memory processing, for embedding the engine without files on disk.
+        // Enhance `input` into the caller's `output` buffer, which must be scale times
+        // the input size. BGR input is tiled in place and BGR output is written in place,
+        // with no copies; other layouts take one conversion pass. Four-channel output gets
+        // the upscaled input alpha, or is opaque.
+        bool ProcessPixels(const ImageView& input, const ImageView& output);
+        bool ProcessPixels(const ImageView& input, const ImageView& output, const EngineOptions& options);
+
+        // Enhance an encoded image (PNG, JPEG, ...) held in memory and write it to outputPath
+        bool ProcessEncoded(const uint8_t* data, size_t size, const std::wstring& outputPath, const EngineOptions& options);
+
+        // ...or encode the result as `format` (".png", ".jpg", ...) into `encoded`,
+        // reusing its capacity. Never streamed: the whole output is held in memory.
+        bool ProcessEncoded(const uint8_t* data, size_t size, const std::string& format, std::vector<uint8_t>& encoded,
+                            const EngineOptions& options);
+
+        const EngineOptions& Options() const { return options_; }
+
+        // Process a batch of files.
+        // The callback is always invoked on the calling thread, once per file in
+        // input order (before that file is enhanced), then once with "Done". Files
+        // skipped by resume are not reported.
+        BatchSummary ProcessBatch(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, ProgressCallback callback);
+
+        // ...writing each input to the matching entry of outputPaths, whose directories must exist
+        BatchSummary ProcessBatch(const std::vector<std::wstring>& inputPaths, const std::vector<std::wstring>& outputPaths,
+                                  ProgressCallback callback);
+
+        // Output path of a batch input: <outputDir>/<name>_upscaled.<ext>
+        static std::wstring OutputPathFor(const std::wstring& inputPath, const std::wstring& outputDir);
+
+        // Hash of every setting that changes outputs (model, scale, strength, encoder, ...).
+        // Valid after Initialize().
+        std::string OutputSettingsKey() const;
+
+        // Process the files of a batch shared with other workers (processes, possibly on
+        // other machines) through `queue`, built over the same inputPaths. Only files this
+        // worker claims are processed and counted; the callback reports them as above,
+        // with the queue's overall progress as the index.
+        BatchSummary ProcessQueued(const std::vector<std::wstring>& inputPaths, const std::wstring& outputDir, WorkQueue& queue,
+                                   ProgressCallback callback);
+
+        // Timings and counters of the last batch (or of every ProcessFile call before the
+        // first batch). Null unless collectStats or collectTrace is set.
+        const Telemetry::Collector* Stats() const { return telemetry_.get(); }
+
+        // Allocation and reuse counts of the scratch buffer pool since construction
+        BufferPool::Stats BufferPoolStats() const { return bufferPool_->GetStats(); }
 
     private:
         EngineOptions options_;
-        std::unique_ptr<InferenceSession> session_;
+        std::unique_ptr<TileScheduler> scheduler_; // Created in Initialize()
+        int tileBatchSize_ = 1; // Effective batch size, resolved in Initialize()
+        size_t tileReuseBytes_ = 0; // Effective tile reuse budget, resolved in Initialize()
+        bool usedModelCache_ = false;
+        bool usedTuneProfile_ = false;
+        std::wstring loadedModelPath_; // modelPath or its reduced-precision variant
+        ModelPrecision loadedPrecision_ = ModelPrecision::FP32;
+
+        std::unique_ptr<ResultCache> resultCache_; // Null when disabled
+        std::string modelKey_;                     // Model file hash, part of every settings key
+
+        std::unique_ptr<BatchJournal> journal_; // Open during a journaled batch
+
+        std::unique_ptr<Telemetry::Collector> telemetry_; // Null when disabled
+        std::unique_ptr<BufferPool> bufferPool_;
+
+        enum class FileOutcome {
+            Failed,
+            Enhanced,
+            CacheHit
+        };
         // std::unique_ptr<FaceEnhancer> faceEnhancer_; // TODO
 
-        // Helper to process a single image in memory
-        cv::Mat ProcessImage(const cv::Mat& input);
+        // Destination of blended output rows (whole canvas or a streamed band)
+        struct OutputBand;
+
+        // Path of the model to load for the requested precision (verified against FP32)
+        std::wstring SelectModelVariant();
+
+        // Load (or, with autotune, create) the tuning profile and apply it to options_
+        void ApplyTuneProfile();
+
+        // Stats for one image: a new file of the engine's collector, or the caller's current one
+        Telemetry::FileStats* BeginStats(const std::wstring& name);
+        void FinishStats(Telemetry::FileStats* stats, bool ok);
+
+        // The engine's options with the per-image settings of `requested`
+        EngineOptions ImageOptions(const EngineOptions& requested) const;
+
+        // ProcessFile, reporting whether the result came from the cache.
+        // The per-image functions below take the options to apply to that image.
+        FileOutcome EnhanceFile(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options);
+
+        // Enhance a decoded image and write it to outputPath (streamed if too large)
+        bool EnhanceImage(const cv::Mat& img, const std::wstring& outputPath, const EngineOptions& options);
+
+        // Every option that changes the output pixels, plus the encoder settings for the
+        // output extension (all of them if `extension` is empty)
+        std::string SettingsKey(const EngineOptions& options, const std::wstring& extension) const;
+
+        // Result cache key for one input/output pair; empty when the cache is disabled
+        std::string ResultCacheKey(const std::wstring& inputPath, const std::wstring& outputPath, const EngineOptions& options) const;
+
+        // Helper to process a single image in memory; the result is canvas.buffer, which
+        // is taken from the buffer pool unless already set to an image of the output size
+        bool ProcessImage(const cv::Mat& input, OutputBand& canvas, const EngineOptions& options);
+
+        // Queue every tile of `input` on the scheduler; results are blended into `out`,
+        // which must stay alive until the returned job completes.
+        std::shared_ptr<TileJob> StartTiles(const cv::Mat& input, OutputBand& out, const EngineOptions& options);
+
+        // StartTiles and wait for the job, then flush the last band (if streaming)
+        bool RunTiles(const cv::Mat& input, OutputBand& out, const EngineOptions& options);
+
+        // True if the image exceeds maxMemoryBytes and the output can be written row-wise
+        bool ShouldStream(const cv::Mat& input, const std::wstring& outputPath, const EngineOptions& options) const;
+
+        // Process band by band, writing finished rows straight to outputPath
+        bool ProcessImageStreamed(const cv::Mat& input, const std::wstring& outputPath, const EngineOptions& options);
+
+        // Open journal_ (if configured) and, when resuming, drop finished files from the lists
+        void StartJournal(std::vector<std::wstring>& inputPaths, std::vector<std::wstring>& outputPaths, BatchSummary& summary);
+
+        // Staged decode -> inference -> encode variant of ProcessBatch
+        BatchSummary ProcessBatchPipelined(const std::vector<std::wstring>& inputPaths, const std::vector<std::wstring>& outputPaths,
+                                           ProgressCallback callback);
     };
 
 }
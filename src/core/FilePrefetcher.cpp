@@ -0,0 +1,57 @@
+#include "FilePrefetcher.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace Core {
+
+    namespace {
+        constexpr size_t kChunkBytes = 1 << 20;
+    }
+
+    FilePrefetcher::FilePrefetcher(std::vector<std::wstring> paths, size_t lookahead)
+        : paths_(std::move(paths)), lookahead_(lookahead) {
+        if (lookahead_ > 0 && !paths_.empty()) thread_ = std::thread([this]() { Run(); });
+    }
+
+    FilePrefetcher::~FilePrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stop_ = true;
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    void FilePrefetcher::Advance(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            next_ = std::max(next_, index + 1);
+            target_ = std::max(target_, std::min(paths_.size(), index + 1 + lookahead_));
+        }
+        cv_.notify_all();
+    }
+
+    void FilePrefetcher::Run() {
+        std::vector<char> buffer(kChunkBytes);
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this]() { return stopping_ || next_ < target_; });
+            if (stopping_) return;
+            size_t index = next_++;
+            lock.unlock();
+            ReadThrough(paths_[index], buffer);
+            prefetched_++;
+            lock.lock();
+        }
+    }
+
+    void FilePrefetcher::ReadThrough(const std::wstring& path, std::vector<char>& buffer) {
+        std::ifstream file(std::filesystem::path(path), std::ios::binary);
+        while (file && !stop_) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+    }
+
+}
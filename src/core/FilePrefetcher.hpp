@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+    // Warms the OS file cache for the files a batch is about to decode, so decoders
+    // find them in memory instead of stalling on a cold disk or a network mount.
+    //
+    // A background thread reads the next `lookahead` files through one reusable
+    // buffer; the data itself is dropped, only the cached pages matter.
+    class FilePrefetcher {
+    public:
+        FilePrefetcher(std::vector<std::wstring> paths, size_t lookahead);
+        ~FilePrefetcher();
+
+        FilePrefetcher(const FilePrefetcher&) = delete;
+        FilePrefetcher& operator=(const FilePrefetcher&) = delete;
+
+        // File `index` is being decoded: read ahead up to index + lookahead.
+        // Files the decoders have already reached are skipped. Calls may come out of order.
+        void Advance(size_t index);
+
+        // Files read so far
+        size_t PrefetchedFiles() const { return prefetched_.load(); }
+
+    private:
+        std::vector<std::wstring> paths_;
+        size_t lookahead_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        size_t next_ = 0;   // Next file to read
+        size_t target_ = 0; // Read files below this index
+        bool stopping_ = false;
+
+        std::atomic<bool> stop_{false};
+        std::atomic<size_t> prefetched_{0};
+        std::thread thread_;
+
+        void Run();
+        void ReadThrough(const std::wstring& path, std::vector<char>& buffer);
+    };
+
+}
@@ -0,0 +1,124 @@
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Core {
+
+    namespace FileUtils {
+
+        namespace {
+            const std::wstring kTempMarker = L".tmp-";
+        }
+
+        std::filesystem::path TempPathFor(const std::filesystem::path& path) {
+            static std::atomic<uint64_t> counter{0};
+            uint64_t seed[3] = {
+                static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id())),
+                static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()),
+                counter.fetch_add(1)};
+            std::string hex = Hash::ToHex(Hash::Bytes(seed, sizeof(seed)));
+            std::filesystem::path temp = path;
+            temp += kTempMarker + std::wstring(hex.begin(), hex.end());
+            return temp;
+        }
+
+        bool Publish(const std::filesystem::path& temp, const std::filesystem::path& path) {
+            std::error_code ec;
+            std::filesystem::rename(temp, path, ec);
+            if (ec) {
+                std::filesystem::remove(temp, ec);
+                return false;
+            }
+            return true;
+        }
+
+        bool CopyAtomic(const std::filesystem::path& from, const std::filesystem::path& to) {
+            std::filesystem::path temp = TempPathFor(to);
+            std::error_code ec;
+            if (!std::filesystem::copy_file(from, temp, std::filesystem::copy_options::overwrite_existing, ec)) {
+                std::filesystem::remove(temp, ec);
+                return false;
+            }
+            return Publish(temp, to);
+        }
+
+        bool IsTempPath(const std::filesystem::path& path) {
+            return path.filename().wstring().find(kTempMarker) != std::wstring::npos;
+        }
+
+        bool CreateExclusive(const std::filesystem::path& path, const std::string& contents) {
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            DWORD written = 0;
+            bool ok = WriteFile(file, contents.data(), static_cast<DWORD>(contents.size()), &written, nullptr) &&
+                      written == contents.size();
+            CloseHandle(file);
+#else
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+            if (fd < 0) return false;
+            bool ok = ::write(fd, contents.data(), contents.size()) == static_cast<ssize_t>(contents.size());
+            ::close(fd);
+#endif
+            // The file exists either way; a short write only loses its informational contents
+            (void)ok;
+            return true;
+        }
+
+        std::string EscapePath(const std::wstring& path) {
+            std::string out;
+            for (char c : std::filesystem::path(path).u8string()) {
+                if (c == '\\') out += "\\\\";
+                else if (c == '\t') out += "\\t";
+                else if (c == '\n') out += "\\n";
+                else out += c;
+            }
+            return out;
+        }
+
+        std::wstring UnescapePath(const std::string& text) {
+            std::string out;
+            for (size_t i = 0; i < text.size(); ++i) {
+                if (text[i] == '\\' && i + 1 < text.size()) {
+                    char c = text[++i];
+                    out += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+                } else {
+                    out += text[i];
+                }
+            }
+            return std::filesystem::u8path(out).wstring();
+        }
+
+        bool SyncFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return false;
+            bool ok = FlushFileBuffers(file) != 0;
+            CloseHandle(file);
+#else
+            // Any descriptor of the file will do: fsync flushes the file, not the descriptor
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            bool ok = ::fsync(fd) == 0;
+            ::close(fd);
+#endif
+            return ok;
+        }
+
+    }
+
+}
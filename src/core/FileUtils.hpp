@@ -0,0 +1,36 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace Core {
+
+    // Helpers for files that other processes may read or write at the same time.
+    namespace FileUtils {
+
+        // Unique sibling of `path` (path + ".tmp-<random>") to write before publishing.
+        std::filesystem::path TempPathFor(const std::filesystem::path& path);
+
+        // Rename `temp` over `path`. On failure `temp` is removed and false is returned.
+        bool Publish(const std::filesystem::path& temp, const std::filesystem::path& path);
+
+        // Copy `from` to `to` through a temporary file, so `to` is never seen half-written.
+        bool CopyAtomic(const std::filesystem::path& from, const std::filesystem::path& to);
+
+        // True for names produced by TempPathFor.
+        bool IsTempPath(const std::filesystem::path& path);
+
+        // Create `path` with `contents` only if it does not exist yet. Atomic across
+        // processes, also on NFS (O_EXCL / CREATE_NEW), so it can serve as a lock.
+        bool CreateExclusive(const std::filesystem::path& path, const std::string& contents);
+
+        // A path as UTF-8 for one field of a tab-separated line (\\, \t and \n escaped), and back
+        std::string EscapePath(const std::wstring& path);
+        std::wstring UnescapePath(const std::string& text);
+
+        // Flush the file's written data to the storage device (fsync / FlushFileBuffers)
+        bool SyncFile(const std::filesystem::path& path);
+
+    }
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Core {
+
+    // Fast non-cryptographic hashing (XXH64) for cache keys and content identity.
+    namespace Hash {
+
+        // XXH64 of `size` bytes.
+        uint64_t Bytes(const void* data, size_t size, uint64_t seed = 0);
+
+        // XXH64 of a string's bytes.
+        uint64_t String(const std::string& text, uint64_t seed = 0);
+
+        // XXH64 of a file's contents (memory-mapped). Returns false if the file cannot be read.
+        bool File(const std::wstring& path, uint64_t& hash);
+
+        // 16 lowercase hex digits.
+        std::string ToHex(uint64_t hash);
+
+    }
+
+}
@@ -1,152 +1,196 @@
 #include "ImageUtils.hpp"
+#include "FileUtils.hpp"
+#include "MappedFile.hpp"
+#include "SimdKernels.hpp"
+#include "Telemetry.hpp"
+#include "TileBlender.hpp"
+#include "UnsharpMask.hpp"
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <climits>
 
 namespace Core {
 
+    namespace {
+
+        cv::Mat DecodeBytes(const uint8_t* data, size_t size) {
+            if (size == 0 || size > static_cast<size_t>(INT_MAX)) return cv::Mat();
+            Telemetry::Count(Telemetry::Counter::BytesRead, size);
+            return cv::imdecode(cv::Mat(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data)), cv::IMREAD_COLOR);
+        }
+
+        std::vector<int> EncodeParams(const std::string& format, const EncodeOptions& options) {
+            std::string ext = format;
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+            if (ext == ".png") {
+                return {cv::IMWRITE_PNG_COMPRESSION, std::clamp(options.pngCompression, 0, 9),
+                        cv::IMWRITE_PNG_STRATEGY, static_cast<int>(options.pngStrategy)};
+            }
+            if (ext == ".jpg" || ext == ".jpeg") {
+                return {cv::IMWRITE_JPEG_QUALITY, std::clamp(options.jpegQuality, 0, 100),
+                        cv::IMWRITE_JPEG_PROGRESSIVE, options.jpegProgressive ? 1 : 0};
+            }
+            if (ext == ".webp") {
+                return {cv::IMWRITE_WEBP_QUALITY, std::max(1, options.webpQuality)};
+            }
+            return {};
+        }
+
+    }
+
     cv::Mat ImageUtils::LoadImage(const std::wstring& path) {
         // OpenCV imread doesn't support unicode paths on Windows directly in all versions.
-        // Use a buffer approach.
-        std::ifstream file(path, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) return cv::Mat();
+        // Decode straight from a read-only mapping of the file instead: no stream
+        // buffers and no heap copy of the encoded bytes.
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Decode);
+        MappedFile file;
+        if (!file.Open(path)) return cv::Mat();
+        return DecodeBytes(file.Data(), file.Size());
+    }
 
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
+    cv::Mat ImageUtils::DecodeImage(const uint8_t* data, size_t size) {
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Decode);
+        return DecodeBytes(data, size);
+    }
 
-        std::vector<char> buffer(size);
-        if (file.read(buffer.data(), size)) {
-            return cv::imdecode(buffer, cv::IMREAD_COLOR);
-        }
-        return cv::Mat();
+    bool ImageUtils::EncodeImage(const std::string& format, const cv::Mat& image, std::vector<uint8_t>& encoded,
+                                 const EncodeOptions& options) {
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Encode);
+        if (!cv::imencode(format, image, encoded, EncodeParams(format, options))) return false;
+        Telemetry::Count(Telemetry::Counter::BytesWritten, encoded.size());
+        return true;
+    }
+
+    std::string ImageUtils::FormatFor(const std::wstring& path) {
+        std::wstring ext = std::filesystem::path(path).extension().wstring();
+        if (ext.empty()) return ".png";
+        // Extensions of supported formats are ASCII
+        return std::string(ext.begin(), ext.end());
     }
 
-    bool ImageUtils::SaveImage(const std::wstring& path, const cv::Mat& image) {
+    bool ImageUtils::WriteImage(const std::wstring& path, const std::string& format, const cv::Mat& image,
+                                const EncodeOptions& options) {
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Encode);
         std::vector<uchar> buf;
-        std::string ext = "png"; // Default
-        size_t dotPos = path.find_last_of(L'.');
-        if (dotPos != std::string::npos) {
-            std::wstring wExt = path.substr(dotPos + 1);
-            // Simple conversion for extension check
-            std::string sExt(wExt.begin(), wExt.end()); 
-            ext = sExt;
-        }
+        if (!cv::imencode(format, image, buf, EncodeParams(format, options))) return false;
+        std::ofstream file(std::filesystem::path(path), std::ios::binary);
+        if (!file.is_open()) return false;
+        file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+        file.close();
+        if (file.fail()) return false;
+        Telemetry::Count(Telemetry::Counter::BytesWritten, buf.size());
+        return true;
+    }
 
-        if (cv::imencode("." + ext, image, buf)) {
-            std::ofstream file(path, std::ios::binary);
-            if (file.is_open()) {
-                file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
-                return true;
-            }
+    bool ImageUtils::SaveImage(const std::wstring& path, const cv::Mat& image, const EncodeOptions& options) {
+        std::filesystem::path temp = FileUtils::TempPathFor(path);
+        if (!WriteImage(temp.wstring(), FormatFor(path), image, options)) {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
         }
-        return false;
+        return FileUtils::Publish(temp, path);
     }
 
     std::vector<float> ImageUtils::PreProcess(const cv::Mat& img) {
-        cv::Mat rgb;
-        cv::cvtColor(img, rgb, cv::COLOR_BGR2RGB);
-        
-        // Convert to float and normalize [0, 1]
-        cv::Mat float_img;
-        rgb.convertTo(float_img, CV_32F, 1.0 / 255.0);
-
-        // HWC to CHW
-        std::vector<float> output;
-        output.reserve(img.channels() * img.rows * img.cols);
-
-        std::vector<cv::Mat> channels;
-        cv::split(float_img, channels);
-
-        for (const auto& c : channels) {
-            output.insert(output.end(), (float*)c.datastart, (float*)c.dataend);
-        }
-
+        std::vector<float> output(static_cast<size_t>(3) * img.rows * img.cols);
+        PreProcessInto(img, output.data());
         return output;
     }
 
+    void ImageUtils::PreProcessInto(const cv::Mat& img, float* output) {
+        CV_Assert(img.type() == CV_8UC3);
+        // BGR -> RGB, [0, 255] -> [0, 1] and HWC -> CHW in one pass
+        Simd::BgrToPlanarRgb(img.ptr<uint8_t>(0), img.step[0], img.cols, img.rows, output);
+    }
+
     cv::Mat ImageUtils::PostProcess(const float* outputData, int channels, int height, int width) {
-        std::vector<cv::Mat> cv_channels;
-        int channel_size = height * width;
+        CV_Assert(channels == 3);
+        cv::Mat final_img(height, width, CV_8UC3);
+        PostProcessInto(outputData, height, width, cv::Rect(0, 0, width, height), final_img);
+        return final_img;
+    }
 
-        for (int i = 0; i < channels; ++i) {
-            cv::Mat c(height, width, CV_32F, const_cast<float*>(outputData + i * channel_size));
-            cv_channels.push_back(c);
-        }
+    void ImageUtils::PostProcessInto(const float* outputData, int height, int width, const cv::Rect& region, cv::Mat dst) {
+        CV_Assert(dst.type() == CV_8UC3 && dst.size() == region.size());
+        CV_Assert(region.x >= 0 && region.y >= 0 && region.x + region.width <= width && region.y + region.height <= height);
 
-        cv::Mat rgb;
-        cv::merge(cv_channels, rgb);
+        // Clamp to [0, 1], scale, round, RGB -> BGR and CHW -> HWC in one pass
+        size_t plane = static_cast<size_t>(height) * width;
+        const float* src = outputData + static_cast<size_t>(region.y) * width + region.x;
+        Simd::PlanarRgbToBgr(src, plane, width, region.width, region.height, dst.ptr<uint8_t>(0), dst.step[0]);
+    }
+
+    std::vector<int> ImageUtils::TileOrigins(int length, int tile_size, int overlap) {
+        std::vector<int> origins;
+        if (length <= tile_size) {
+            origins.push_back(0);
+            return origins;
+        }
 
-        // Clip to [0, 1]
-        cv::threshold(rgb, rgb, 1.0, 1.0, cv::THRESH_TRUNC);
-        cv::threshold(rgb, rgb, 0.0, 0.0, cv::THRESH_TOZERO);
+        int step = std::max(1, tile_size - overlap);
+        for (int pos = 0; ; pos += step) {
+            if (pos + tile_size >= length) {
+                // Keep tile size constant at the boundary (good for batching)
+                origins.push_back(length - tile_size);
+                break;
+            }
+            origins.push_back(pos);
+        }
+        return origins;
+    }
 
-        cv::Mat bgr;
-        cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+    std::vector<cv::Rect> ImageUtils::TileRects(const cv::Size& size, int tile_size, int overlap) {
+        std::vector<cv::Rect> rects;
+        int tw = std::min(tile_size, size.width);
+        int th = std::min(tile_size, size.height);
+        std::vector<int> xs = TileOrigins(size.width, tile_size, overlap);
 
-        cv::Mat final_img;
-        bgr.convertTo(final_img, CV_8U, 255.0);
-        return final_img;
+        for (int y : TileOrigins(size.height, tile_size, overlap)) {
+            for (int x : xs) {
+                rects.emplace_back(x, y, tw, th);
+            }
+        }
+        return rects;
     }
 
     std::vector<ImageTile> ImageUtils::SplitTiles(const cv::Mat& img, int tile_size, int overlap) {
         std::vector<ImageTile> tiles;
-        int h = img.rows;
-        int w = img.cols;
-
-        for (int y = 0; y < h; y += tile_size - overlap) {
-            for (int x = 0; x < w; x += tile_size - overlap) {
-                int tw = std::min(tile_size, w - x);
-                int th = std::min(tile_size, h - y);
-                
-                // Adjust for boundary to keep tile size constant if possible (optional, but good for batching)
-                // For now, simple cropping
-                cv::Rect roi(x, y, tw, th);
-                tiles.push_back({img(roi).clone(), x, y, tw, th});
-            }
+        for (const cv::Rect& roi : TileRects(img.size(), tile_size, overlap)) {
+            tiles.push_back({img(roi).clone(), roi.x, roi.y, roi.width, roi.height});
         }
         return tiles;
     }
 
     cv::Mat ImageUtils::MergeTiles(const std::vector<ImageTile>& tiles, int full_width, int full_height, int tile_size, int overlap) {
-        // This is a simplified merge. For better results, we should blend the overlap areas.
-        // Current implementation: Just overwrite. 
-        // NOTE: A proper implementation would use a weight mask for blending.
-        
-        cv::Mat canvas = cv::Mat::zeros(full_height, full_width, CV_8UC3);
-        
-        // Naive merge: just paste. 
-        // TODO: Implement feathering/blending if artifacts are visible.
+        cv::Mat canvas(full_height, full_width, CV_8UC3);
+        if (tiles.empty()) return cv::Mat::zeros(full_height, full_width, CV_8UC3);
+
+        TileLayout layout;
+        layout.tileWidth = std::min(tile_size, tiles[0].width);
+        layout.tileHeight = std::min(tile_size, tiles[0].height);
+        layout.width = full_width;
+        layout.height = full_height;
+        layout.overlap = overlap;
         for (const auto& tile : tiles) {
-            // We need to handle the fact that tiles might be scaled up (e.g. x2, x4)
-            // But this function signature assumes we know the target full size.
-            // The tile.x and tile.y are in ORIGINAL coordinates.
-            // We need to know the scale factor to place them correctly.
-            
-            // Infer scale from tile vs original tile size? 
-            // Or just assume the caller handles coordinate mapping?
-            // Let's assume tile.x/y are TARGET coordinates for this function to be generic for the canvas.
-            // Wait, SplitTiles returns original coords. 
-            // So we need to scale coords.
-            
-            // Let's change the logic: The caller should probably manage the canvas or we pass scale.
-            // For now, let's assume the passed tiles have their x/y updated to target coordinates 
-            // OR we calculate scale here.
-            
-            // Actually, let's make it simple: 
-            // If we have a 100x100 tile at 0,0 and it becomes 400x400, the new pos is 0,0.
-            // If we have a tile at 50,0 (overlap), it becomes 200,0.
-            
-            // Let's assume the caller will assemble. 
-            // But for now, let's just implement a direct paste based on tile.x/y * scale.
-            
-            // We can deduce scale.
-            // But wait, tile.width/height are the CURRENT tile size.
-            // We don't have the original tile size here easily unless we pass it.
-            
-            // Let's skip complex merge for this step and refine in ImageProcessor.
-            // Just paste:
-            if (tile.x + tile.width <= full_width && tile.y + tile.height <= full_height) {
-                 tile.data.copyTo(canvas(cv::Rect(tile.x, tile.y, tile.width, tile.height)));
+            if (tile.y == tiles[0].y) layout.xs.push_back(tile.x);
+            if (layout.ys.empty() || layout.ys.back() != tile.y) layout.ys.push_back(tile.y);
+        }
+
+        TileBlender blender(layout, TileMergeMode::Feather);
+        std::vector<float> buffer(static_cast<size_t>(3) * layout.tileWidth * layout.tileHeight);
+        size_t cols = layout.xs.size();
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            CV_Assert(tiles[i].width == layout.tileWidth && tiles[i].height == layout.tileHeight);
+            int col = static_cast<int>(i % cols);
+            int row = static_cast<int>(i / cols);
+            PreProcessInto(tiles[i].data, buffer.data());
+            blender.AddTile(col, row, buffer.data(), canvas, 0);
+            if (col + 1 == static_cast<int>(cols)) {
+                blender.FinishTileRow(row, canvas, 0);
             }
         }
         return canvas;
@@ -154,11 +198,19 @@ namespace Core {
 
     cv::Mat ImageUtils::Sharpen(const cv::Mat& img, double strength) {
         if (strength <= 0) return img.clone();
-        
-        cv::Mat blurred, weighted;
-        cv::GaussianBlur(img, blurred, cv::Size(0, 0), 3);
-        cv::addWeighted(img, 1.0 + strength, blurred, -strength, 0, weighted);
-        return weighted;
+
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Sharpen);
+        Telemetry::CountAllocation(img.total() * img.elemSize());
+        if (img.type() != CV_8UC3) {
+            cv::Mat blurred, weighted;
+            cv::GaussianBlur(img, blurred, cv::Size(0, 0), UnsharpMask::kDefaultSigma);
+            cv::addWeighted(img, 1.0 + strength, blurred, -strength, 0, weighted);
+            return weighted;
+        }
+
+        cv::Mat sharpened = img.clone();
+        UnsharpMask(sharpened.cols, sharpened.rows, UnsharpMask::kDefaultSigma, strength).Advance(sharpened, 0, sharpened.rows);
+        return sharpened;
     }
 
 }
@@ -12,25 +12,78 @@ namespace Core {
         int width, height;
     };
 
+    // zlib strategy used for PNG output (same values as cv::IMWRITE_PNG_STRATEGY_*)
+    enum class PngStrategy {
+        Default = 0,
+        Filtered = 1,
+        HuffmanOnly = 2, // Much faster, somewhat larger files
+        Rle = 3,
+        Fixed = 4
+    };
+
+    // Encoder speed/size settings. Each output format uses its own.
+    struct EncodeOptions {
+        int pngCompression = 1; // zlib level: 0 (fastest, largest) .. 9 (slowest, smallest)
+        PngStrategy pngStrategy = PngStrategy::Default;
+        int jpegQuality = 95;   // 0 .. 100
+        bool jpegProgressive = false;
+        int webpQuality = 101;  // 1 .. 100 is lossy; above 100 is lossless
+    };
+
     class ImageUtils {
     public:
         // Load image from path. Supports unicode paths on Windows.
         static cv::Mat LoadImage(const std::wstring& path);
 
-        // Save image to path.
-        static bool SaveImage(const std::wstring& path, const cv::Mat& image);
+        // Decode an encoded image (PNG, JPEG, ...) from memory. Empty on failure.
+        static cv::Mat DecodeImage(const uint8_t* data, size_t size);
+
+        // Encode as `format` (".png", ".jpg", ...) into `encoded`, reusing its capacity
+        static bool EncodeImage(const std::string& format, const cv::Mat& image, std::vector<uint8_t>& encoded,
+                                const EncodeOptions& options = {});
+
+        // Save image to path, in the format of its extension. The file is written under a
+        // temporary name and renamed into place, so it is never seen half-written.
+        static bool SaveImage(const std::wstring& path, const cv::Mat& image, const EncodeOptions& options = {});
+
+        // Encode as `format` and write straight to path (no rename); for callers that
+        // publish the file themselves
+        static bool WriteImage(const std::wstring& path, const std::string& format, const cv::Mat& image,
+                               const EncodeOptions& options = {});
+
+        // Encoder format for a path: its extension (".png" if it has none)
+        static std::string FormatFor(const std::wstring& path);
 
         // Pre-process: Convert BGR (OpenCV default) to RGB, normalize to [0, 1], and convert to CHW float format.
         // Returns a flat vector of floats.
         static std::vector<float> PreProcess(const cv::Mat& img);
 
+        // Same as PreProcess, but in a single fused pass straight from an 8-bit BGR image
+        // (or ROI) into a caller-supplied buffer of 3 * rows * cols floats.
+        static void PreProcessInto(const cv::Mat& img, float* output);
+
         // Post-process: Convert CHW float format back to BGR [0, 255] uint8.
         static cv::Mat PostProcess(const float* outputData, int channels, int height, int width);
 
-        // Split image into tiles with overlap.
+        // Same as PostProcess, but writes the `region` of a 3-channel height x width CHW
+        // output straight into `dst`, an 8-bit BGR image or ROI of the region's size
+        // (e.g. a canvas ROI). No intermediate images are allocated.
+        static void PostProcessInto(const float* outputData, int height, int width, const cv::Rect& region, cv::Mat dst);
+
+        // Tile origins along one axis. Consecutive tiles overlap by at least `overlap`;
+        // the last tile is shifted back to end at `length`, so every tile has the same
+        // extent min(tile_size, length).
+        static std::vector<int> TileOrigins(int length, int tile_size, int overlap);
+
+        // Tile rectangles covering an image of the given size, row by row.
+        static std::vector<cv::Rect> TileRects(const cv::Size& size, int tile_size, int overlap);
+
+        // Split image into tiles with overlap. All tiles have the same size.
         static std::vector<ImageTile> SplitTiles(const cv::Mat& img, int tile_size, int overlap);
 
-        // Merge tiles back into a single image.
+        // Merge tiles back into a single image, feathering the overlaps.
+        // Tiles must be in row-major order, share one size (as produced by SplitTiles)
+        // and have x/y in the coordinates of the merged image.
         static cv::Mat MergeTiles(const std::vector<ImageTile>& tiles, int full_width, int full_height, int tile_size, int overlap);
         
         // Simple sharpening using unsharp mask
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core {
+
+    // 8 bits per channel, interleaved
+    enum class PixelFormat {
+        BGR,
+        RGB,
+        BGRA,
+        RGBA,
+        Gray
+    };
+
+    inline int ChannelCount(PixelFormat format) {
+        switch (format) {
+        case PixelFormat::BGRA:
+        case PixelFormat::RGBA: return 4;
+        case PixelFormat::Gray: return 1;
+        default: return 3;
+        }
+    }
+
+    // Caller-owned pixels. Rows are `stride` bytes apart (0 = tightly packed), so a
+    // view can describe a sub-rectangle of a larger buffer or a padded frame.
+    struct ImageView {
+        uint8_t* data = nullptr;
+        int width = 0;
+        int height = 0;
+        size_t stride = 0;
+        PixelFormat format = PixelFormat::BGR;
+
+        ImageView() = default;
+        ImageView(uint8_t* data, int width, int height, PixelFormat format, size_t stride = 0)
+            : data(data), width(width), height(height), stride(stride), format(format) {}
+
+        size_t RowBytes() const { return stride ? stride : static_cast<size_t>(width) * ChannelCount(format); }
+    };
+
+}
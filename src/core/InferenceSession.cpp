@@ -1,11 +1,18 @@
 #include "InferenceSession.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include "Telemetry.hpp"
 #include <iostream>
+#include <filesystem>
 #include <codecvt>
 #include <locale>
 #include <algorithm> // For std::search
 
-// DirectML provider header - usually available if onnxruntime is built with it
-// #include <dml_provider_factory.h> 
+// DirectML provider header - only shipped with DirectML builds of onnxruntime (Windows)
+#if defined(_WIN32) && __has_include(<dml_provider_factory.h>)
+#include <dml_provider_factory.h>
+#define PE_HAVE_DML 1
+#endif
 
 namespace Core {
 
@@ -16,7 +23,26 @@ namespace Core {
     InferenceSession::~InferenceSession() {
     }
 
-    bool InferenceSession::LoadModel(const std::wstring& modelPath, Device device) {
+    namespace {
+
+        // Cache file for an optimized model: <model name>-<key hash>.ort, where the key covers
+        // everything that changes the optimized graph.
+        std::filesystem::path OptimizedModelPath(const std::wstring& cacheDir, const std::wstring& modelPath,
+                                                 const MappedFile& model, Device device) {
+            std::string key = "model=" + Hash::ToHex(Hash::Bytes(model.Data(), model.Size())) +
+                              ";size=" + std::to_string(model.Size()) +
+                              ";ort=" + OrtGetApiBase()->GetVersionString() +
+                              ";device=" + std::to_string(static_cast<int>(device)) +
+                              ";opt=" + std::to_string(static_cast<int>(GraphOptimizationLevel::ORT_ENABLE_ALL));
+            std::wstring name = std::filesystem::path(modelPath).stem().wstring() + L"-";
+            std::string hex = Hash::ToHex(Hash::String(key));
+            name += std::wstring(hex.begin(), hex.end()) + L".ort";
+            return std::filesystem::path(cacheDir) / name;
+        }
+
+    }
+
+    bool InferenceSession::LoadModel(const std::wstring& modelPath, Device device, const SessionThreading& threading) {
         // MOCK/STUB MODE for testing without real models
         if (modelPath.find(L"stub") != std::wstring::npos) {
             std::cout << "[Mock] Loading stub model..." << std::endl;
@@ -31,13 +57,25 @@ namespace Core {
 
         sessionOptions_ = Ort::SessionOptions();
         sessionOptions_.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        if (threading.intraOpThreads > 0) {
+            sessionOptions_.SetIntraOpNumThreads(threading.intraOpThreads);
+        }
+        if (threading.interOpThreads > 0) {
+            // The inter-op pool is only used in parallel execution mode
+            sessionOptions_.SetExecutionMode(ExecutionMode::ORT_PARALLEL);
+            sessionOptions_.SetInterOpNumThreads(threading.interOpThreads);
+        }
 
         if (device == Device::DirectML) {
+#if defined(PE_HAVE_DML)
             try {
-                OrtSessionOptionsAppendExecutionProvider_DML(sessionOptions_, 0);
+                Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_DML(sessionOptions_, 0));
             } catch (const std::exception& e) {
                 std::cerr << "Failed to enable DirectML: " << e.what() << ". Falling back to CPU." << std::endl;
             }
+#else
+            std::cerr << "DirectML is not available in this build. Falling back to CPU." << std::endl;
+#endif
         } else if (device == Device::CUDA) {
             try {
                 OrtCUDAProviderOptions cuda_options;
@@ -47,13 +85,68 @@ namespace Core {
             }
         }
 
-        try {
-            session_ = std::make_unique<Ort::Session>(env_, modelPath.c_str(), sessionOptions_);
-        } catch (const Ort::Exception& e) {
-            std::cerr << "Failed to load model: " << e.what() << std::endl;
+        binding_.reset();
+        session_.reset();
+        cachedModel_.Close();
+        loadedFromCache_ = false;
+
+        // Mapped rather than read: ORT parses straight from the page cache
+        MappedFile model;
+        if (!model.Open(modelPath)) {
+            std::wcerr << L"Failed to read model: " << modelPath << std::endl;
             return false;
         }
 
+        // Only the CPU graph is cached; GPU providers compile their own kernels at load time
+        std::filesystem::path cachePath;
+        if (!cacheDir_.empty() && device == Device::CPU) {
+            std::error_code ec;
+            std::filesystem::create_directories(cacheDir_, ec);
+            cachePath = OptimizedModelPath(cacheDir_, modelPath, model, device);
+        }
+
+        if (!cachePath.empty() && cachedModel_.Open(cachePath.wstring())) {
+            try {
+                // Run straight from the mapped ORT-format bytes, initializers included
+                Ort::SessionOptions cachedOptions = sessionOptions_.Clone();
+                cachedOptions.AddConfigEntry("session.use_ort_model_bytes_directly", "1");
+                cachedOptions.AddConfigEntry("session.use_ort_model_bytes_for_initializers", "1");
+                session_ = std::make_unique<Ort::Session>(env_, cachedModel_.Data(), cachedModel_.Size(), cachedOptions);
+                loadedFromCache_ = true;
+            } catch (const Ort::Exception& e) {
+                std::cerr << "Ignoring unusable cached model: " << e.what() << std::endl;
+                cachedModel_.Close();
+            }
+        }
+
+        if (!session_) {
+            // Optimize from the original model and save the result for the next start.
+            // The file is written under a temporary name and renamed into place, so other
+            // processes only ever see complete cache files.
+            Ort::SessionOptions options = sessionOptions_.Clone();
+            std::filesystem::path tempPath;
+            if (!cachePath.empty()) {
+                tempPath = FileUtils::TempPathFor(cachePath);
+                options.SetOptimizedModelFilePath(tempPath.c_str());
+                options.AddConfigEntry("session.save_model_format", "ORT");
+            }
+
+            try {
+                session_ = std::make_unique<Ort::Session>(env_, model.Data(), model.Size(), options);
+            } catch (const Ort::Exception& e) {
+                std::cerr << "Failed to load model: " << e.what() << std::endl;
+                if (!tempPath.empty()) {
+                    std::error_code ec;
+                    std::filesystem::remove(tempPath, ec);
+                }
+                return false;
+            }
+
+            if (!tempPath.empty()) {
+                FileUtils::Publish(tempPath, cachePath); // Racing processes publish identical files
+            }
+        }
+
         // Resolve Input/Output names
         Ort::AllocatorWithDefaultOptions allocator;
         
@@ -79,6 +172,9 @@ namespace Core {
     }
 
     std::vector<float> InferenceSession::Run(const std::vector<float>& inputData, const std::vector<int64_t>& inputDims) {
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Inference);
+        Telemetry::Count(Telemetry::Counter::InferenceCalls);
+
         // MOCK MODE
         if (!session_) {
             // Assume stub mode if session_ is null but we are inside Run (LoadModel returned true for stub)
@@ -90,6 +186,7 @@ namespace Core {
             // Actually, the Engine logic expects specific output size.
             // Let's just return a vector of size input_size * 16 (for 4x scale).
             // This is just noise, but it proves the pipeline flows.
+            // Batched input works the same way: every tile grows 16x.
             size_t inputSize = inputData.size();
             std::vector<float> dummyOutput(inputSize * 16, 0.5f); // Grey image
             return dummyOutput;
@@ -128,8 +225,94 @@ namespace Core {
         }
     }
 
+    namespace {
+
+        size_t ElementCount(const std::vector<int64_t>& dims) {
+            size_t count = 1;
+            for (int64_t d : dims) count *= static_cast<size_t>(d);
+            return count;
+        }
+
+        // Stub model: nearest-neighbour upscale of an NCHW tensor to the requested output size.
+        void StubUpscale(const float* input, const std::vector<int64_t>& inputDims,
+                         float* output, const std::vector<int64_t>& outputDims) {
+            int64_t planes = inputDims[0] * inputDims[1];
+            int64_t inH = inputDims[2], inW = inputDims[3];
+            int64_t outH = outputDims[2], outW = outputDims[3];
+            for (int64_t p = 0; p < planes; ++p) {
+                const float* src = input + p * inH * inW;
+                float* dst = output + p * outH * outW;
+                for (int64_t y = 0; y < outH; ++y) {
+                    const float* srcRow = src + (y * inH / outH) * inW;
+                    for (int64_t x = 0; x < outW; ++x) {
+                        *dst++ = srcRow[x * inW / outW];
+                    }
+                }
+            }
+        }
+
+    }
+
+    bool InferenceSession::BindBuffers(const float* inputData, const std::vector<int64_t>& inputDims,
+                                       float* outputData, const std::vector<int64_t>& outputDims) {
+        if (binding_ && inputData == boundInputData_ && outputData == boundOutputData_ &&
+            inputDims == boundInputDims_ && outputDims == boundOutputDims_) {
+            return true;
+        }
+
+        Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        try {
+            if (!binding_) binding_ = std::make_unique<Ort::IoBinding>(*session_);
+
+            boundInput_ = Ort::Value::CreateTensor<float>(
+                memoryInfo, const_cast<float*>(inputData), ElementCount(inputDims),
+                inputDims.data(), inputDims.size());
+            boundOutput_ = Ort::Value::CreateTensor<float>(
+                memoryInfo, outputData, ElementCount(outputDims),
+                outputDims.data(), outputDims.size());
+
+            binding_->ClearBoundInputs();
+            binding_->ClearBoundOutputs();
+            binding_->BindInput(inputNodeNames_[0], boundInput_);
+            binding_->BindOutput(outputNodeNames_[0], boundOutput_);
+        } catch (const Ort::Exception& e) {
+            std::cerr << "Failed to bind tensors: " << e.what() << std::endl;
+            binding_.reset();
+            return false;
+        }
+
+        boundInputData_ = inputData;
+        boundOutputData_ = outputData;
+        boundInputDims_ = inputDims;
+        boundOutputDims_ = outputDims;
+        return true;
+    }
+
+    bool InferenceSession::RunInto(const float* inputData, const std::vector<int64_t>& inputDims,
+                                   float* outputData, const std::vector<int64_t>& outputDims) {
+        if (inputDims.size() != 4 || outputDims.size() != 4) return false;
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Inference);
+        Telemetry::Count(Telemetry::Counter::InferenceCalls);
+
+        // MOCK MODE
+        if (!session_) {
+            StubUpscale(inputData, inputDims, outputData, outputDims);
+            return true;
+        }
+
+        if (!BindBuffers(inputData, inputDims, outputData, outputDims)) return false;
+
+        try {
+            session_->Run(Ort::RunOptions{nullptr}, *binding_);
+            return true;
+        } catch (const Ort::Exception& e) {
+            std::cerr << "Inference failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
     std::vector<int64_t> InferenceSession::GetInputShape() const {
-        if (!session_) return {1, 3, 256, 256}; // Stub shape
+        if (!session_) return {-1, 3, -1, -1}; // Stub accepts any batch and tile size
         if (session_->GetInputCount() == 0) return {};
         return session_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
     }
@@ -5,6 +5,7 @@
 #include <string>
 #include <memory>
 #include <optional>
+#include "MappedFile.hpp"
 
 namespace Core {
 
@@ -14,13 +15,25 @@ namespace Core {
         DirectML
     };
 
+    // ORT thread pool sizes for one session. 0 keeps ORT's default.
+    struct SessionThreading {
+        int intraOpThreads = 0; // Threads used inside one operator
+        int interOpThreads = 0; // Threads running independent graph nodes concurrently
+    };
+
     class InferenceSession {
     public:
         InferenceSession();
         ~InferenceSession();
 
+        // Directory for ORT-format copies of optimized models. When set, LoadModel reuses
+        // a cached copy made for the same model bytes, ORT version, device and graph
+        // optimization level, and skips graph optimization entirely. Empty disables the cache.
+        // Cached models are specific to the machine that produced them.
+        void SetModelCacheDir(const std::wstring& dir) { cacheDir_ = dir; }
+
         // Load model from path.
-        bool LoadModel(const std::wstring& modelPath, Device device = Device::CPU);
+        bool LoadModel(const std::wstring& modelPath, Device device = Device::CPU, const SessionThreading& threading = {});
 
         // Run inference.
         // inputData: CHW float vector.
@@ -28,13 +41,27 @@ namespace Core {
         // Returns output data as flat vector.
         std::vector<float> Run(const std::vector<float>& inputData, const std::vector<int64_t>& inputDims);
 
-        // Get expected input shape (if static)
+        // Run inference on caller-owned buffers.
+        // inputData: tensor of shape inputDims. outputData: preallocated tensor of shape outputDims.
+        // Tensors are bound once (IoBinding) and reused while the buffers and shapes stay
+        // the same, so steady-state calls do not allocate.
+        bool RunInto(const float* inputData, const std::vector<int64_t>& inputDims,
+                     float* outputData, const std::vector<int64_t>& outputDims);
+
+        // Get expected input shape. Dynamic dimensions are reported as -1.
         std::vector<int64_t> GetInputShape() const;
 
+        // True if the last LoadModel used the optimized model cache.
+        bool LoadedFromCache() const { return loadedFromCache_; }
+
     private:
         Ort::Env env_;
+        MappedFile cachedModel_; // Backs session_ when it runs from a cached ORT-format model; must outlive it
         std::unique_ptr<Ort::Session> session_;
         Ort::SessionOptions sessionOptions_;
+
+        std::wstring cacheDir_;
+        bool loadedFromCache_ = false;
         
         std::vector<const char*> inputNodeNames_;
         std::vector<const char*> outputNodeNames_;
@@ -42,6 +69,18 @@ namespace Core {
         // We need to keep the strings alive for the char* pointers
         std::vector<std::string> inputNodeNameAllocations_;
         std::vector<std::string> outputNodeNameAllocations_;
+
+        // Buffers currently bound for RunInto
+        std::unique_ptr<Ort::IoBinding> binding_;
+        Ort::Value boundInput_{nullptr};
+        Ort::Value boundOutput_{nullptr};
+        const float* boundInputData_ = nullptr;
+        float* boundOutputData_ = nullptr;
+        std::vector<int64_t> boundInputDims_;
+        std::vector<int64_t> boundOutputDims_;
+
+        bool BindBuffers(const float* inputData, const std::vector<int64_t>& inputDims,
+                         float* outputData, const std::vector<int64_t>& outputDims);
     };
 
 }
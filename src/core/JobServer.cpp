@@ -0,0 +1,320 @@
+#include "JobServer.hpp"
+#include "Telemetry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace Core {
+
+    namespace {
+
+        constexpr uint64_t kMaxHeaderBytes = 64 * 1024;
+        constexpr uint64_t kMaxPayloadBytes = 1ull << 30;
+
+        bool WriteFrame(LocalSocket& socket, const void* data, uint64_t size) {
+            uint8_t length[8];
+            for (int i = 0; i < 8; ++i) length[i] = static_cast<uint8_t>(size >> (8 * i));
+            return socket.WriteAll(length, sizeof(length)) && socket.WriteAll(data, static_cast<size_t>(size));
+        }
+
+        bool ReadFrameLength(LocalSocket& socket, uint64_t limit, uint64_t& size) {
+            uint8_t length[8];
+            if (!socket.ReadAll(length, sizeof(length))) return false;
+            size = 0;
+            for (int i = 0; i < 8; ++i) size |= static_cast<uint64_t>(length[i]) << (8 * i);
+            return size <= limit;
+        }
+
+        std::wstring FromUtf8(const std::string& text) {
+            return std::filesystem::u8path(text).wstring();
+        }
+
+        std::string FormatMs(double ms) {
+            std::ostringstream out;
+            out.setf(std::ios::fixed);
+            out.precision(1);
+            out << ms;
+            return out.str();
+        }
+
+        double MsSince(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Apply a request's per-image overrides. False (with `error` set) on a bad value.
+        bool ApplyOverrides(const JobMessage& request, EngineOptions& options, std::string& error) {
+            try {
+                std::string value = request.Get("strength");
+                if (!value.empty()) options.strength = std::stod(value);
+                value = request.Get("max-memory");
+                if (!value.empty()) options.maxMemoryBytes = static_cast<size_t>(std::stoull(value)) * 1024 * 1024;
+            } catch (const std::exception&) {
+                error = "invalid strength or max-memory";
+                return false;
+            }
+            std::string merge = request.Get("merge");
+            if (merge == "crop") {
+                options.mergeMode = TileMergeMode::CropToCenter;
+            } else if (merge == "feather" || merge == "feather-cos") {
+                options.mergeMode = TileMergeMode::Feather;
+                options.featherWindow = merge == "feather-cos" ? FeatherWindow::Cosine : FeatherWindow::Linear;
+            } else if (!merge.empty()) {
+                error = "unknown merge mode: " + merge;
+                return false;
+            }
+            return true;
+        }
+
+    }
+
+    std::string JobMessage::Get(const std::string& key) const {
+        auto it = fields.find(key);
+        return it == fields.end() ? std::string() : it->second;
+    }
+
+    bool JobMessage::Read(LocalSocket& socket) {
+        fields.clear();
+        payload.clear();
+
+        uint64_t size = 0;
+        if (!ReadFrameLength(socket, kMaxHeaderBytes, size)) return false;
+        std::string header(static_cast<size_t>(size), '\0');
+        if (!socket.ReadAll(&header[0], header.size())) return false;
+
+        std::istringstream lines(header);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t eq = line.find('=');
+            if (eq != std::string::npos) fields[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+
+        if (!ReadFrameLength(socket, kMaxPayloadBytes, size)) return false;
+        payload.resize(static_cast<size_t>(size));
+        return socket.ReadAll(payload.data(), payload.size());
+    }
+
+    bool JobMessage::Write(LocalSocket& socket) const {
+        std::string header;
+        for (const auto& field : fields) {
+            // Values are single lines
+            if (field.second.find('\n') != std::string::npos) return false;
+            header += field.first + "=" + field.second + "\n";
+        }
+        return WriteFrame(socket, header.data(), header.size()) && WriteFrame(socket, payload.data(), payload.size());
+    }
+
+    JobServer::JobServer(Engine& engine, const JobServerOptions& options)
+        : engine_(engine), options_(options), queue_(static_cast<size_t>(std::max(1, options.queueDepth))) {}
+
+    JobServer::~JobServer() {
+        Stop();
+    }
+
+    bool JobServer::Start() {
+        listener_ = LocalSocket::Listen(options_.socketPath, std::max(1, options_.maxConnections));
+        if (!listener_.IsValid()) return false;
+
+        int runners = std::max(1, options_.concurrentJobs);
+        for (int i = 0; i < runners; ++i) runners_.emplace_back([this]() { RunnerLoop(); });
+        acceptThread_ = std::thread([this]() { AcceptLoop(); });
+        return true;
+    }
+
+    void JobServer::Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stopRequested_; });
+    }
+
+    void JobServer::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+            stopRequested_ = true;
+        }
+        cv_.notify_all();
+
+        // Wake the accept loop; it sees stopping_ and exits
+        if (acceptThread_.joinable()) {
+            LocalSocket::Connect(options_.socketPath);
+            listener_.Shutdown();
+            acceptThread_.join();
+        }
+        if (listener_.IsValid()) {
+            listener_.Close();
+            std::error_code ec;
+            std::filesystem::remove(options_.socketPath, ec);
+        }
+
+        // Jobs already accepted still run and get their responses
+        queue_.Close();
+        for (auto& runner : runners_) runner.join();
+        runners_.clear();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (auto& connection : connections_) connection->socket.Shutdown();
+        for (auto& connection : connections_) connection->done = true;
+        ReapConnections(lock);
+    }
+
+    bool JobServer::Submit(const std::wstring& socketPath, const JobMessage& request, JobMessage& response) {
+        LocalSocket socket = LocalSocket::Connect(socketPath);
+        if (!socket.IsValid()) {
+            std::wcerr << L"Cannot connect to " << socketPath << std::endl;
+            return false;
+        }
+        return request.Write(socket) && response.Read(socket);
+    }
+
+    void JobServer::ReapConnections(std::unique_lock<std::mutex>& lock) {
+        std::list<std::unique_ptr<Connection>> finished;
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            auto next = std::next(it);
+            if ((*it)->done) finished.splice(finished.end(), connections_, it);
+            it = next;
+        }
+        lock.unlock();
+        for (auto& connection : finished) connection->thread.join();
+        lock.lock();
+    }
+
+    void JobServer::AcceptLoop() {
+        size_t maxConnections = static_cast<size_t>(std::max(1, options_.maxConnections));
+        // Accept errors that persist (e.g. out of file descriptors) are retried with a back-off
+        const std::chrono::milliseconds kMaxBackoff(1000);
+        std::chrono::milliseconds backoff(0);
+        for (;;) {
+            // Past the limit, new clients wait in the listen backlog
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() {
+                    size_t active = std::count_if(connections_.begin(), connections_.end(), [](const auto& c) { return !c->done; });
+                    return stopping_ || active < maxConnections;
+                });
+                if (stopping_) return;
+                ReapConnections(lock);
+            }
+
+            LocalSocket client = listener_.Accept();
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            if (!client.IsValid()) {
+                if (backoff.count() == 0) std::cerr << "Failed to accept a connection; retrying." << std::endl;
+                backoff = std::min(kMaxBackoff, std::max(std::chrono::milliseconds(10), backoff * 2));
+                if (cv_.wait_for(lock, backoff, [&]() { return stopping_; })) return;
+                continue;
+            }
+            backoff = std::chrono::milliseconds(0);
+
+            auto connection = std::make_unique<Connection>();
+            connection->socket = std::move(client);
+            Connection* c = connection.get();
+            connections_.push_back(std::move(connection));
+            c->thread = std::thread([this, c]() { Serve(*c); });
+        }
+    }
+
+    void JobServer::Serve(Connection& connection) {
+        JobMessage request;
+        while (request.Read(connection.socket)) {
+            if (request.Get("command") == "shutdown") {
+                JobMessage response;
+                response.Set("status", "ok");
+                response.Write(connection.socket);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stopRequested_ = true;
+                }
+                cv_.notify_all();
+                break;
+            }
+
+            auto job = std::make_shared<Job>();
+            job->request = std::move(request);
+            job->queued = std::chrono::steady_clock::now();
+            std::future<JobMessage> result = job->response.get_future();
+
+            JobMessage response;
+            if (queue_.Push(job)) {
+                response = result.get();
+            } else {
+                response.Set("id", job->request.Get("id"));
+                response.Set("status", "error");
+                response.Set("error", "server is shutting down");
+            }
+            if (!response.Write(connection.socket)) break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connection.done = true;
+        }
+        cv_.notify_all();
+    }
+
+    void JobServer::RunnerLoop() {
+        std::shared_ptr<Job> job;
+        while (queue_.Pop(job)) {
+            JobMessage response;
+            try {
+                response = RunJob(job->request, job->queued);
+            } catch (const std::exception& e) {
+                response.Set("id", job->request.Get("id"));
+                response.Set("status", "error");
+                response.Set("error", e.what());
+            }
+            job->response.set_value(std::move(response));
+            job.reset();
+        }
+    }
+
+    JobMessage JobServer::RunJob(const JobMessage& request, std::chrono::steady_clock::time_point queued) {
+        JobMessage response;
+        response.Set("id", request.Get("id"));
+        response.Set("queue_ms", FormatMs(MsSince(queued)));
+        auto fail = [&response](const std::string& error) {
+            response.Set("status", "error");
+            response.Set("error", error);
+            return response;
+        };
+
+        std::string output = request.Get("output");
+        std::string input = request.Get("input");
+        if (output.empty()) return fail("missing output");
+        if (input.empty() && request.payload.empty()) return fail("missing input");
+
+        EngineOptions options = engine_.Options();
+        std::string error;
+        if (!ApplyOverrides(request, options, error)) return fail(error);
+
+        // A collector per job, so the engine's timers report to this job alone
+        Telemetry::Collector collector(false);
+        Telemetry::FileStats* stats = collector.AddFile(FromUtf8(input.empty() ? output : input));
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        {
+            Telemetry::FileScope scope(stats);
+            ok = request.payload.empty() ? engine_.ProcessFile(FromUtf8(input), FromUtf8(output), options)
+                                         : engine_.ProcessEncoded(request.payload.data(), request.payload.size(), FromUtf8(output), options);
+        }
+        stats->Finish(ok);
+        response.Set("total_ms", FormatMs(MsSince(start)));
+
+        Telemetry::FileReport report = stats->Report();
+        for (size_t i = 0; i < Telemetry::kStageCount; ++i) {
+            auto stage = static_cast<Telemetry::Stage>(i);
+            response.Set(std::string(Telemetry::StageName(stage)) + "_ms", FormatMs(report.stats.StageMs(stage)));
+        }
+        uint64_t skipped = report.stats.Value(Telemetry::Counter::TilesFilled) + report.stats.Value(Telemetry::Counter::TilesReused) +
+                           report.stats.Value(Telemetry::Counter::TilesResampled);
+        response.Set("tiles", std::to_string(report.stats.Value(Telemetry::Counter::Tiles) + skipped));
+        response.Set("tiles_skipped", std::to_string(skipped));
+
+        if (!ok) return fail("processing failed");
+        response.Set("status", "ok");
+        return response;
+    }
+
+}
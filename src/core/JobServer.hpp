@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Engine.hpp"
+#include "LocalSocket.hpp"
+#include "Pipeline.hpp"
+
+namespace Core {
+
+    // One request or response of the job protocol.
+    //
+    // On the wire a message is two frames, a header and a payload; each frame is an
+    // 8-byte little-endian length followed by that many bytes. The header holds
+    // UTF-8 "key=value" lines.
+    //
+    // Requests:
+    //   output=<path>        Where to write the result (required)
+    //   input=<path>         Image to enhance, unless the payload holds the encoded image
+    //   strength=<0..1>      Overrides of the server's per-image options
+    //   merge=<feather|feather-cos|crop>
+    //   max-memory=<MB>
+    //   id=<text>            Echoed in the response
+    //   command=shutdown     Instead of a job: stop the server once running jobs finish
+    // Responses: id, status=<ok|error>, error=<message>, queue_ms (waiting for a
+    // runner), total_ms (running), <stage>_ms for each pipeline stage, tiles and
+    // tiles_skipped (of those, filled, reused or resampled instead of inferred).
+    // The payload of a response is empty.
+    struct JobMessage {
+        std::map<std::string, std::string> fields;
+        std::vector<uint8_t> payload;
+
+        std::string Get(const std::string& key) const;
+        void Set(const std::string& key, const std::string& value) { fields[key] = value; }
+
+        // False on a closed connection, an I/O error or a malformed message
+        bool Read(LocalSocket& socket);
+        bool Write(LocalSocket& socket) const;
+    };
+
+    struct JobServerOptions {
+        std::wstring socketPath;
+        int concurrentJobs = 2; // Jobs run at once; with 2+ one job decodes/encodes while another infers
+        int queueDepth = 8;     // Accepted jobs waiting for a runner; clients block once it is full
+        int maxConnections = 64;
+    };
+
+    // Serves enhancement jobs from a local socket, so clients get a loaded and warmed
+    // up engine instead of paying for ORT setup and model load per image.
+    //
+    // Each connection sends requests one at a time and gets one response per request;
+    // concurrency comes from several connections. Jobs run on a fixed set of runner
+    // threads sharing the engine, so their tiles interleave on its inference workers.
+    class JobServer {
+    public:
+        // `engine` must be initialized and outlive the server
+        JobServer(Engine& engine, const JobServerOptions& options);
+        ~JobServer();
+
+        JobServer(const JobServer&) = delete;
+        JobServer& operator=(const JobServer&) = delete;
+
+        // Bind the socket and start serving. False if the socket cannot be created.
+        bool Start();
+
+        // Block until a client requests shutdown or Stop() is called
+        void Wait();
+
+        // Stop accepting connections, finish the queued jobs and close every connection
+        void Stop();
+
+        // Client side: send one request and wait for its response
+        static bool Submit(const std::wstring& socketPath, const JobMessage& request, JobMessage& response);
+
+    private:
+        struct Job {
+            JobMessage request;
+            std::promise<JobMessage> response;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        struct Connection {
+            LocalSocket socket;
+            std::thread thread;
+            bool done = false; // Guarded by mutex_
+        };
+
+        Engine& engine_;
+        JobServerOptions options_;
+        LocalSocket listener_;
+        BoundedQueue<std::shared_ptr<Job>> queue_;
+        std::thread acceptThread_;
+        std::vector<std::thread> runners_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::list<std::unique_ptr<Connection>> connections_;
+        bool stopRequested_ = false; // Wait() returns
+        bool stopping_ = false;      // Stop() has begun
+
+        void AcceptLoop();
+        void Serve(Connection& connection);
+        void RunnerLoop();
+        JobMessage RunJob(const JobMessage& request, std::chrono::steady_clock::time_point queued);
+
+        // Join and remove finished connections; the caller holds `lock`
+        void ReapConnections(std::unique_lock<std::mutex>& lock);
+    };
+
+}
@@ -0,0 +1,167 @@
+#include "LocalSocket.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Core {
+
+    namespace {
+
+#ifdef _WIN32
+        using NativeSocket = SOCKET;
+
+        bool StartNetworking() {
+            static const bool started = []() {
+                WSADATA data;
+                return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+            }();
+            return started;
+        }
+
+        void CloseNative(NativeSocket s) { closesocket(s); }
+        bool Interrupted() { return WSAGetLastError() == WSAEINTR; }
+        constexpr int kShutdownBoth = SD_BOTH;
+        constexpr int kSendFlags = 0;
+#else
+        using NativeSocket = int;
+
+        bool StartNetworking() { return true; }
+        void CloseNative(NativeSocket s) { ::close(s); }
+        bool Interrupted() { return errno == EINTR; } // A signal, not an error: try again
+        constexpr int kShutdownBoth = SHUT_RDWR;
+#ifdef MSG_NOSIGNAL
+        constexpr int kSendFlags = MSG_NOSIGNAL; // A vanished client must not raise SIGPIPE
+#else
+        constexpr int kSendFlags = 0;
+#endif
+#endif
+
+        NativeSocket Native(intptr_t handle) { return static_cast<NativeSocket>(handle); }
+
+        bool MakeAddress(const std::wstring& path, sockaddr_un& address) {
+            std::string narrow = std::filesystem::path(path).u8string();
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (narrow.empty() || narrow.size() >= sizeof(address.sun_path)) {
+                std::wcerr << L"Socket path is empty or too long: " << path << std::endl;
+                return false;
+            }
+            std::memcpy(address.sun_path, narrow.data(), narrow.size());
+            return true;
+        }
+
+    }
+
+    LocalSocket::~LocalSocket() {
+        Close();
+    }
+
+    LocalSocket::LocalSocket(LocalSocket&& other) noexcept : handle_(std::exchange(other.handle_, kInvalid)) {}
+
+    LocalSocket& LocalSocket::operator=(LocalSocket&& other) noexcept {
+        if (this != &other) {
+            Close();
+            handle_ = std::exchange(other.handle_, kInvalid);
+        }
+        return *this;
+    }
+
+    LocalSocket LocalSocket::Listen(const std::wstring& path, int backlog) {
+        sockaddr_un address;
+        if (!StartNetworking() || !MakeAddress(path, address)) return LocalSocket();
+
+        std::error_code ec;
+        std::filesystem::file_status status = std::filesystem::symlink_status(path, ec);
+        if (std::filesystem::exists(status)) {
+            // Only a socket file is ever removed: a mistyped path must not cost the user a file
+            if (status.type() != std::filesystem::file_type::socket) {
+                std::wcerr << L"Cannot listen on " << path << L": path exists and is not a socket" << std::endl;
+                return LocalSocket();
+            }
+            if (Connect(path).IsValid()) {
+                std::wcerr << L"Another server is already listening on " << path << std::endl;
+                return LocalSocket();
+            }
+            std::filesystem::remove(path, ec);
+        }
+
+        LocalSocket socket(static_cast<intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if (!socket.IsValid()) return LocalSocket();
+        if (::bind(Native(socket.handle_), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(Native(socket.handle_), backlog) != 0) {
+            std::wcerr << L"Failed to listen on " << path << std::endl;
+            return LocalSocket();
+        }
+        return socket;
+    }
+
+    LocalSocket LocalSocket::Connect(const std::wstring& path) {
+        sockaddr_un address;
+        if (!StartNetworking() || !MakeAddress(path, address)) return LocalSocket();
+
+        LocalSocket socket(static_cast<intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0)));
+        if (!socket.IsValid()) return LocalSocket();
+        if (::connect(Native(socket.handle_), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            return LocalSocket();
+        }
+        return socket;
+    }
+
+    LocalSocket LocalSocket::Accept() {
+        if (!IsValid()) return LocalSocket();
+        for (;;) {
+            LocalSocket client(static_cast<intptr_t>(::accept(Native(handle_), nullptr, nullptr)));
+            if (client.IsValid() || !Interrupted()) return client;
+        }
+    }
+
+    bool LocalSocket::ReadAll(void* data, size_t size) {
+        char* p = static_cast<char*>(data);
+        while (size > 0) {
+            int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+            auto n = ::recv(Native(handle_), p, chunk, 0);
+            if (n < 0 && Interrupted()) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool LocalSocket::WriteAll(const void* data, size_t size) {
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+            auto n = ::send(Native(handle_), p, chunk, kSendFlags);
+            if (n < 0 && Interrupted()) continue;
+            if (n <= 0) return false;
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void LocalSocket::Shutdown() {
+        if (IsValid()) ::shutdown(Native(handle_), kShutdownBoth);
+    }
+
+    void LocalSocket::Close() {
+        if (IsValid()) CloseNative(Native(std::exchange(handle_, kInvalid)));
+    }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Core {
+
+    // Stream socket bound to a filesystem path (AF_UNIX; Windows 10 1803+ supports
+    // these too). Blocking I/O; only Shutdown() may be called from another thread.
+    class LocalSocket {
+    public:
+        LocalSocket() = default;
+        ~LocalSocket();
+
+        LocalSocket(const LocalSocket&) = delete;
+        LocalSocket& operator=(const LocalSocket&) = delete;
+        LocalSocket(LocalSocket&& other) noexcept;
+        LocalSocket& operator=(LocalSocket&& other) noexcept;
+
+        // Listening socket at `path`. A stale socket file left by a dead server is replaced;
+        // any other file at `path` is left alone and the call fails.
+        static LocalSocket Listen(const std::wstring& path, int backlog);
+        static LocalSocket Connect(const std::wstring& path);
+
+        // Next connection; an invalid socket once this socket is shut down or on error.
+        // Calls interrupted by a signal are retried here and in ReadAll/WriteAll.
+        LocalSocket Accept();
+
+        // All `size` bytes or false (error or the peer closed the connection)
+        bool ReadAll(void* data, size_t size);
+        bool WriteAll(const void* data, size_t size);
+
+        // Wake up threads blocked in ReadAll/WriteAll; later calls fail
+        void Shutdown();
+        void Close();
+
+        bool IsValid() const { return handle_ != kInvalid; }
+
+    private:
+        static constexpr intptr_t kInvalid = -1;
+        intptr_t handle_ = kInvalid; // SOCKET on Windows, file descriptor elsewhere
+
+        explicit LocalSocket(intptr_t handle) : handle_(handle) {}
+    };
+
+}
@@ -0,0 +1,126 @@
+#include "MappedFile.hpp"
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Core {
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        MoveFrom(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            Close();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    void MappedFile::MoveFrom(MappedFile& other) {
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        open_ = std::exchange(other.open_, false);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+
+#ifdef _WIN32
+
+    bool MappedFile::Open(const std::wstring& path) {
+        Close();
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            return false;
+        }
+        file_ = file;
+        size_ = static_cast<size_t>(size.QuadPart);
+        open_ = true;
+        if (size_ == 0) return true; // Empty files cannot be mapped
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view) {
+            if (mapping) CloseHandle(mapping);
+            Close();
+            return false;
+        }
+        mapping_ = mapping;
+        data_ = static_cast<const uint8_t*>(view);
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(static_cast<HANDLE>(mapping_));
+        if (file_) CloseHandle(static_cast<HANDLE>(file_));
+        data_ = nullptr;
+        mapping_ = nullptr;
+        file_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+#else
+
+    bool MappedFile::Open(const std::wstring& path) {
+        Close();
+        int fd = ::open(std::filesystem::path(path).c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* view = nullptr;
+        if (size > 0) {
+            view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            // Readers go front to back: ask for aggressive readahead
+            madvise(view, size, MADV_SEQUENTIAL);
+        }
+        ::close(fd); // The mapping keeps the file referenced
+
+        data_ = static_cast<const uint8_t*>(view);
+        size_ = size;
+        open_ = true;
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+        open_ = false;
+    }
+
+#endif
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Core {
+
+    // Read-only memory mapping of a whole file. Pages are loaded on first access,
+    // so opening a large file is cheap and no heap copy is made.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        // Map `path`. Returns false (and stays closed) if the file cannot be opened or mapped.
+        bool Open(const std::wstring& path);
+        void Close();
+
+        bool IsOpen() const { return open_; }
+        const uint8_t* Data() const { return data_; }
+        size_t Size() const { return size_; }
+
+    private:
+        const uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        bool open_ = false;
+#ifdef _WIN32
+        void* file_ = nullptr;    // HANDLE
+        void* mapping_ = nullptr; // HANDLE
+#endif
+
+        void MoveFrom(MappedFile& other);
+    };
+
+}
@@ -0,0 +1,139 @@
+#include "ModelVariants.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include "ImageUtils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+namespace Core {
+
+    namespace ModelVariants {
+
+        std::wstring VariantPath(const std::wstring& modelPath, ModelPrecision precision) {
+            if (precision == ModelPrecision::FP32) return modelPath;
+            std::filesystem::path path(modelPath);
+            std::wstring suffix = precision == ModelPrecision::FP16 ? L".fp16" : L".int8";
+            return (path.parent_path() / (path.stem().wstring() + suffix + path.extension().wstring())).wstring();
+        }
+
+        const char* Name(ModelPrecision precision) {
+            switch (precision) {
+            case ModelPrecision::FP16: return "FP16";
+            case ModelPrecision::INT8: return "INT8";
+            default: return "FP32";
+            }
+        }
+
+        std::vector<cv::Mat> SampleTiles(const std::wstring& dir, int tileSize, size_t maxTiles) {
+            std::vector<cv::Mat> tiles;
+            std::error_code ec;
+            if (!dir.empty() && std::filesystem::is_directory(dir, ec)) {
+                std::vector<std::filesystem::path> files;
+                for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+                    if (entry.is_regular_file()) files.push_back(entry.path());
+                }
+                std::sort(files.begin(), files.end()); // Same samples on every run
+                for (const auto& file : files) {
+                    if (tiles.size() >= maxTiles) break;
+                    cv::Mat img = ImageUtils::LoadImage(file.wstring());
+                    if (img.empty()) continue;
+                    int w = std::min(tileSize, img.cols), h = std::min(tileSize, img.rows);
+                    cv::Rect center((img.cols - w) / 2, (img.rows - h) / 2, w, h);
+                    tiles.push_back(img(center).clone());
+                }
+            }
+            if (tiles.empty() && maxTiles > 0) {
+                cv::Mat tile(tileSize, tileSize, CV_8UC3);
+                cv::randu(tile, cv::Scalar::all(0), cv::Scalar::all(64));
+                for (int y = 0; y < tileSize; ++y) {
+                    uint8_t* row = tile.ptr<uint8_t>(y);
+                    for (int x = 0; x < tileSize; ++x) {
+                        row[x * 3 + 0] += static_cast<uint8_t>(x * 191 / tileSize);
+                        row[x * 3 + 1] += static_cast<uint8_t>(y * 191 / tileSize);
+                        row[x * 3 + 2] += static_cast<uint8_t>((x + y) * 95 / tileSize);
+                    }
+                }
+                tiles.push_back(tile);
+            }
+            return tiles;
+        }
+
+        double Psnr(const float* reference, const float* test, size_t count) {
+            if (count == 0) return std::numeric_limits<double>::infinity();
+            double sum = 0;
+            for (size_t i = 0; i < count; ++i) {
+                double d = std::clamp(reference[i], 0.0f, 1.0f) - std::clamp(test[i], 0.0f, 1.0f);
+                sum += d * d;
+            }
+            if (sum == 0) return std::numeric_limits<double>::infinity();
+            return 10.0 * std::log10(static_cast<double>(count) / sum);
+        }
+
+        double ComparePsnr(InferenceSession& reference, InferenceSession& variant, const std::vector<cv::Mat>& tiles, int scale) {
+            double lowest = std::numeric_limits<double>::infinity();
+            std::vector<float> input, expected, actual;
+            for (const cv::Mat& tile : tiles) {
+                std::vector<int64_t> inputDims = {1, 3, tile.rows, tile.cols};
+                std::vector<int64_t> outputDims = {1, 3, tile.rows * scale, tile.cols * scale};
+                input.resize(static_cast<size_t>(3) * tile.rows * tile.cols);
+                expected.resize(input.size() * scale * scale);
+                actual.resize(expected.size());
+                ImageUtils::PreProcessInto(tile, input.data());
+                try {
+                    if (!reference.RunInto(input.data(), inputDims, expected.data(), outputDims) ||
+                        !variant.RunInto(input.data(), inputDims, actual.data(), outputDims)) {
+                        return -1;
+                    }
+                } catch (const std::exception&) {
+                    return -1;
+                }
+                lowest = std::min(lowest, Psnr(expected.data(), actual.data(), expected.size()));
+            }
+            return lowest;
+        }
+
+        std::wstring VerdictPath(const std::wstring& dir, const std::wstring& modelPath, const std::wstring& variantPath,
+                                 const std::string& settings) {
+            uint64_t modelHash = 0, variantHash = 0;
+            if (!Hash::File(modelPath, modelHash) || !Hash::File(variantPath, variantHash)) return std::wstring();
+            std::string key = "model=" + Hash::ToHex(modelHash) + ";variant=" + Hash::ToHex(variantHash) + ";" + settings;
+            std::string hex = Hash::ToHex(Hash::String(key));
+            std::wstring name = std::filesystem::path(variantPath).stem().wstring() + L"-" + std::wstring(hex.begin(), hex.end()) + L".psnr";
+            return (std::filesystem::path(dir) / name).wstring();
+        }
+
+        bool LoadVerdict(const std::wstring& path, double& psnr) {
+            std::ifstream file(std::filesystem::path(path), std::ios::in);
+            std::string line;
+            if (!std::getline(file, line) || line.rfind("psnr=", 0) != 0) return false;
+            try {
+                psnr = std::stod(line.substr(5));
+            } catch (const std::exception&) {
+                return false;
+            }
+            return true;
+        }
+
+        bool SaveVerdict(const std::wstring& path, double psnr) {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+            std::filesystem::path temp = FileUtils::TempPathFor(path);
+            {
+                std::ofstream file(temp);
+                if (!file.is_open()) return false;
+                file << "psnr=" << psnr << "\n";
+                if (!file) {
+                    file.close();
+                    std::filesystem::remove(temp, ec);
+                    return false;
+                }
+            }
+            return FileUtils::Publish(temp, path);
+        }
+
+    }
+
+}
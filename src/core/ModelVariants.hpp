@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include "InferenceSession.hpp"
+
+namespace Core {
+
+    // Numeric precision of the super-resolution model. Reduced-precision variants are
+    // produced offline by scripts/quantize_model.py and stored next to the FP32 model.
+    enum class ModelPrecision {
+        FP32,
+        FP16,
+        INT8
+    };
+
+    namespace ModelVariants {
+
+        // "model.onnx" -> "model.fp16.onnx" / "model.int8.onnx"; FP32 is the model itself
+        std::wstring VariantPath(const std::wstring& modelPath, ModelPrecision precision);
+
+        const char* Name(ModelPrecision precision);
+
+        // Up to maxTiles BGR tiles of tileSize (or smaller) cut from the centers of the
+        // images in `dir`. A synthetic tile with gradients and noise when there are none.
+        std::vector<cv::Mat> SampleTiles(const std::wstring& dir, int tileSize, size_t maxTiles);
+
+        // PSNR in dB of `test` against `reference`, both in [0, 1] (values are clamped
+        // like the output conversion does). Infinity when identical.
+        double Psnr(const float* reference, const float* test, size_t count);
+
+        // Lowest PSNR of `variant`'s outputs against `reference`'s over `tiles`.
+        // Negative if either session fails.
+        double ComparePsnr(InferenceSession& reference, InferenceSession& variant, const std::vector<cv::Mat>& tiles, int scale);
+
+        // File in `dir` caching the PSNR of `variantPath` against `modelPath`, named after both
+        // models' contents and `settings` (the other inputs of the check). Empty if either
+        // model cannot be read.
+        std::wstring VerdictPath(const std::wstring& dir, const std::wstring& modelPath, const std::wstring& variantPath,
+                                 const std::string& settings);
+
+        bool LoadVerdict(const std::wstring& path, double& psnr);
+        bool SaveVerdict(const std::wstring& path, double psnr);
+
+    }
+
+}
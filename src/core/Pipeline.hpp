@@ -0,0 +1,158 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace Core {
+
+    // Blocking FIFO with a fixed capacity. Push blocks while the queue is full,
+    // Pop blocks while it is empty. After Close(), Push fails and Pop drains the
+    // remaining items before failing.
+    template <typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+        bool Push(T item) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+            if (closed_) return false;
+            items_.push_back(std::move(item));
+            notEmpty_.notify_one();
+            return true;
+        }
+
+        bool Pop(T& out) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+            if (items_.empty()) return false;
+            out = std::move(items_.front());
+            items_.pop_front();
+            notFull_.notify_one();
+            return true;
+        }
+
+        void Close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            notEmpty_.notify_all();
+            notFull_.notify_all();
+        }
+
+        size_t Size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return items_.size();
+        }
+
+    private:
+        size_t capacity_;
+        bool closed_ = false;
+        std::deque<T> items_;
+        mutable std::mutex mutex_;
+        std::condition_variable notEmpty_;
+        std::condition_variable notFull_;
+    };
+
+    // Collects items produced out of order by several workers and hands them to
+    // a single consumer in index order. At most `capacity` indices past the
+    // consumer's position may be in flight, which bounds memory when producers
+    // run ahead of the consumer.
+    template <typename T>
+    class ReorderWindow {
+    public:
+        explicit ReorderWindow(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+        // Block until `index` fits in the window. Returns false once closed.
+        bool WaitForSlot(size_t index) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            slotFree_.wait(lock, [&] { return closed_ || index < next_ + capacity_; });
+            return !closed_;
+        }
+
+        void Put(size_t index, T item) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.emplace(index, std::move(item));
+            if (index == next_) itemReady_.notify_all();
+        }
+
+        // Take the next item in index order, blocking until it has been Put.
+        bool Take(T& out) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            itemReady_.wait(lock, [this] { return closed_ || items_.count(next_) > 0; });
+            auto it = items_.find(next_);
+            if (it == items_.end()) return false;
+            out = std::move(it->second);
+            items_.erase(it);
+            ++next_;
+            slotFree_.notify_all();
+            return true;
+        }
+
+        void Close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            itemReady_.notify_all();
+            slotFree_.notify_all();
+        }
+
+        // Items Put but not yet taken
+        size_t Size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return items_.size();
+        }
+
+    private:
+        size_t capacity_;
+        size_t next_ = 0;
+        bool closed_ = false;
+        std::map<size_t, T> items_;
+        mutable std::mutex mutex_;
+        std::condition_variable itemReady_;
+        std::condition_variable slotFree_;
+    };
+
+    // Runs completion actions in index order without blocking anyone. Done is called
+    // exactly once per index, from any thread and in any order; an index's action
+    // (which may be empty) runs once every lower index is done. One thread at a time
+    // runs them, outside the lock: callers arriving meanwhile only queue their action,
+    // and the running thread picks it up once its turn comes. If actions throw, the
+    // rest still run and the first exception is rethrown to that thread's caller.
+    class InOrderCompletion {
+    public:
+        void Done(size_t index, std::function<void()> action) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            pending_.emplace(index, std::move(action));
+            if (draining_) return;
+            draining_ = true;
+            std::exception_ptr failure;
+            for (auto it = pending_.find(next_); it != pending_.end(); it = pending_.find(next_)) {
+                std::function<void()> ready = std::move(it->second);
+                pending_.erase(it);
+                ++next_;
+                if (!ready) continue;
+                lock.unlock();
+                try {
+                    ready();
+                } catch (...) {
+                    if (!failure) failure = std::current_exception();
+                }
+                lock.lock();
+            }
+            draining_ = false;
+            lock.unlock();
+            if (failure) std::rethrow_exception(failure);
+        }
+
+    private:
+        size_t next_ = 0;
+        bool draining_ = false; // A thread is running actions
+        std::map<size_t, std::function<void()>> pending_;
+        std::mutex mutex_;
+    };
+
+}
@@ -0,0 +1,91 @@
+#include "ResultCache.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace Core {
+
+    ResultCache::ResultCache(const std::wstring& dir, uint64_t maxBytes) : dir_(dir), maxBytes_(maxBytes) {
+        std::error_code ec;
+        fs::create_directories(dir_, ec);
+        Evict(); // Measures what other runs left behind
+    }
+
+    std::string ResultCache::Key(const std::wstring& inputPath, const std::string& settingsKey, const std::wstring& outputExtension) const {
+        uint64_t contentHash = 0;
+        if (!Hash::File(inputPath, contentHash)) return std::string();
+
+        std::string ext(outputExtension.begin(), outputExtension.end());
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        std::string key = Hash::ToHex(contentHash) + ";" + settingsKey + ";ext=" + ext;
+        // Content hash first, so entries of one input sort together
+        return Hash::ToHex(contentHash) + Hash::ToHex(Hash::String(key));
+    }
+
+    std::wstring ResultCache::EntryPath(const std::string& key) const {
+        return (fs::path(dir_) / (std::wstring(key.begin(), key.end()) + L".out")).wstring();
+    }
+
+    bool ResultCache::Fetch(const std::string& key, const std::wstring& outputPath) {
+        // Copied rather than linked, so editing an output can never change the cached entry
+        fs::path entry = EntryPath(key);
+        if (!FileUtils::CopyAtomic(entry, outputPath)) return false;
+
+        std::error_code ec;
+        fs::last_write_time(entry, fs::file_time_type::clock::now(), ec); // LRU: mark as recently used
+        return true;
+    }
+
+    void ResultCache::Store(const std::string& key, const std::wstring& outputPath) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(outputPath, ec);
+        if (ec || size > maxBytes_) return;
+        if (!FileUtils::CopyAtomic(outputPath, EntryPath(key))) return;
+
+        if (estimatedBytes_.fetch_add(size) + size > maxBytes_) {
+            Evict();
+        }
+    }
+
+    void ResultCache::Evict() {
+        struct Entry {
+            fs::path path;
+            uint64_t size;
+            fs::file_time_type lastUse;
+        };
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+
+        // Temporary files are skipped while another process may still be writing them
+        auto staleBefore = fs::file_time_type::clock::now() - std::chrono::hours(1);
+
+        std::error_code ec;
+        for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+            if (FileUtils::IsTempPath(it->path())) {
+                std::error_code tempEc;
+                if (it->last_write_time(tempEc) < staleBefore && !tempEc) fs::remove(it->path(), tempEc);
+                continue;
+            }
+            std::error_code sizeEc, timeEc;
+            Entry entry{it->path(), it->file_size(sizeEc), it->last_write_time(timeEc)};
+            if (sizeEc || timeEc) continue; // Removed by another process meanwhile
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+        for (const Entry& entry : entries) {
+            if (total <= maxBytes_) break;
+            std::error_code removeEc;
+            if (fs::remove(entry.path, removeEc) || !removeEc) total -= entry.size;
+        }
+        estimatedBytes_ = total;
+    }
+
+}
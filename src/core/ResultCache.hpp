@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Core {
+
+    // On-disk cache of enhanced outputs, keyed by the input file's bytes and the
+    // settings that produced the output.
+    //
+    // Entries are written under a temporary name and renamed into place, so several
+    // processes can share one directory. Hits refresh the entry's modification time;
+    // when the directory grows past maxBytes the least recently used entries are removed.
+    class ResultCache {
+    public:
+        ResultCache(const std::wstring& dir, uint64_t maxBytes);
+
+        // Cache key for `inputPath` (hashed from its raw bytes) produced with `settingsKey`
+        // and written as `outputExtension`. Empty if the input cannot be read.
+        std::string Key(const std::wstring& inputPath, const std::string& settingsKey, const std::wstring& outputExtension) const;
+
+        // Copy the entry for `key` to outputPath. False on a miss.
+        bool Fetch(const std::string& key, const std::wstring& outputPath);
+
+        // Add outputPath as the entry for `key`, then evict if over the size cap.
+        void Store(const std::string& key, const std::wstring& outputPath);
+
+    private:
+        std::wstring dir_;
+        uint64_t maxBytes_;
+        // Cached bytes as of the last scan plus what this process stored since. A full
+        // scan (and eviction) only runs when it passes maxBytes_.
+        std::atomic<uint64_t> estimatedBytes_{0};
+
+        std::wstring EntryPath(const std::string& key) const;
+        void Evict();
+    };
+
+}
@@ -0,0 +1,292 @@
+#include "RowWriter.hpp"
+#include "FileUtils.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#if defined(PE_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace Core {
+
+    namespace {
+
+        const uint32_t* CrcTable() {
+            static const std::vector<uint32_t> table = [] {
+                std::vector<uint32_t> t(256);
+                for (uint32_t n = 0; n < 256; ++n) {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    t[n] = c;
+                }
+                return t;
+            }();
+            return table.data();
+        }
+
+        uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size) {
+            const uint32_t* table = CrcTable();
+            crc = ~crc;
+            for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size) {
+            const uint32_t mod = 65521;
+            uint32_t a = adler & 0xFFFF, b = adler >> 16;
+            while (size > 0) {
+                // 5552 is the largest block that cannot overflow 32-bit sums
+                size_t n = std::min<size_t>(size, 5552);
+                size -= n;
+                while (n--) {
+                    a += *data++;
+                    b += a;
+                }
+                a %= mod;
+                b %= mod;
+            }
+            return (b << 16) | a;
+        }
+
+        void PutU32(std::vector<uint8_t>& out, uint32_t v) {
+            out.push_back(static_cast<uint8_t>(v >> 24));
+            out.push_back(static_cast<uint8_t>(v >> 16));
+            out.push_back(static_cast<uint8_t>(v >> 8));
+            out.push_back(static_cast<uint8_t>(v));
+        }
+
+        std::wstring LowerExtension(const std::wstring& path) {
+            std::wstring ext = std::filesystem::path(path).extension().wstring();
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
+            return ext;
+        }
+
+    }
+
+    std::unique_ptr<RowWriter> RowWriter::ForPath(const std::wstring& path, const EncodeOptions& options) {
+        if (LowerExtension(path) == L".png") {
+            return std::make_unique<PngRowWriter>(std::clamp(options.pngCompression, 0, 9), options.pngStrategy);
+        }
+        return nullptr;
+    }
+
+    PngRowWriter::PngRowWriter(int compressionLevel, PngStrategy strategy)
+        : compressionLevel_(compressionLevel), strategy_(strategy) {}
+
+    PngRowWriter::~PngRowWriter() {
+        if (file_.is_open()) file_.close();
+        if (!tempPath_.empty() && tempPath_ != partialPath_) {
+            std::error_code ec;
+            std::filesystem::remove(tempPath_, ec);
+        }
+#if defined(PE_HAVE_ZLIB)
+        if (zstream_) {
+            deflateEnd(static_cast<z_stream*>(zstream_));
+            delete static_cast<z_stream*>(zstream_);
+        }
+#endif
+    }
+
+    bool PngRowWriter::Open(const std::wstring& path, int width, int height) {
+        width_ = width;
+        height_ = height;
+        rowsWritten_ = 0;
+        adler_ = 1;
+
+        path_ = path;
+        tempPath_ = partialPath_.empty() ? FileUtils::TempPathFor(path_) : partialPath_;
+        file_.open(tempPath_, std::ios::binary | std::ios::trunc);
+        if (!file_.is_open()) return false;
+
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        file_.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> ihdr;
+        PutU32(ihdr, static_cast<uint32_t>(width));
+        PutU32(ihdr, static_cast<uint32_t>(height));
+        ihdr.push_back(8); // Bit depth
+        ihdr.push_back(2); // Color type: RGB
+        ihdr.push_back(0); // Compression
+        ihdr.push_back(0); // Filter
+        ihdr.push_back(0); // Interlace
+        if (!WriteChunk("IHDR", ihdr.data(), ihdr.size()) || !StartDeflate()) return false;
+        chunk_.assign({0x78, 0x01}); // zlib header, first IDAT
+        return true;
+    }
+
+    bool PngRowWriter::StartDeflate() {
+#if defined(PE_HAVE_ZLIB)
+        // Raw deflate; the zlib header and Adler-32 trailer are written here
+        z_stream* zs = new z_stream();
+        // PngStrategy values are zlib's strategy constants
+        if (deflateInit2(zs, compressionLevel_, Z_DEFLATED, -15, 8, static_cast<int>(strategy_)) != Z_OK) {
+            delete zs;
+            return false;
+        }
+        zstream_ = zs;
+#endif
+        return true;
+    }
+
+    void PngRowWriter::SetPartialPath(const std::filesystem::path& partialPath) {
+        partialPath_ = partialPath;
+    }
+
+    bool PngRowWriter::Checkpoint(RowCheckpoint& checkpoint) {
+        if (!file_.is_open() || partialPath_.empty()) return false;
+        file_.flush();
+        std::streamoff length = file_.tellp();
+        if (file_.fail() || length < 0 || !FileUtils::SyncFile(tempPath_)) return false;
+        checkpoint.rows = rowsWritten_;
+        checkpoint.bytes = static_cast<uint64_t>(length);
+        checkpoint.adler = adler_;
+        return true;
+    }
+
+    bool PngRowWriter::Resume(const std::wstring& path, int width, int height, const RowCheckpoint& checkpoint) {
+        if (partialPath_.empty() || file_.is_open() || checkpoint.rows <= 0 || checkpoint.rows > height) return false;
+        // The checkpoint ends after a complete IDAT chunk; anything beyond it is from a band
+        // that was never checkpointed
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(partialPath_, ec);
+        if (ec || size < checkpoint.bytes) return false;
+        std::filesystem::resize_file(partialPath_, checkpoint.bytes, ec);
+        if (ec) return false;
+
+        width_ = width;
+        height_ = height;
+        rowsWritten_ = checkpoint.rows;
+        adler_ = checkpoint.adler;
+        path_ = path;
+        tempPath_ = partialPath_;
+        file_.open(tempPath_, std::ios::binary | std::ios::app);
+        if (!file_.is_open() || !StartDeflate()) return false;
+        chunk_.clear(); // The zlib header is already in the file
+        return true;
+    }
+
+    void PngRowWriter::Deflate(const uint8_t* data, size_t size, bool finish) {
+#if defined(PE_HAVE_ZLIB)
+        z_stream* zs = static_cast<z_stream*>(zstream_);
+        zs->next_in = const_cast<Bytef*>(data);
+        zs->avail_in = static_cast<uInt>(size);
+        // Full flush at band boundaries keeps each IDAT chunk independently decodable
+        int flush = finish ? Z_FINISH : Z_FULL_FLUSH;
+        uint8_t out[65536];
+        do {
+            zs->next_out = out;
+            zs->avail_out = sizeof(out);
+            deflate(zs, flush);
+            chunk_.insert(chunk_.end(), out, out + (sizeof(out) - zs->avail_out));
+        } while (zs->avail_out == 0);
+#else
+        // Stored blocks of at most 65535 bytes; the final (empty) block closes the stream
+        do {
+            size_t n = std::min<size_t>(size, 65535);
+            chunk_.push_back(finish && n == size ? 1 : 0);
+            chunk_.push_back(static_cast<uint8_t>(n));
+            chunk_.push_back(static_cast<uint8_t>(n >> 8));
+            chunk_.push_back(static_cast<uint8_t>(~n));
+            chunk_.push_back(static_cast<uint8_t>(~n >> 8));
+            chunk_.insert(chunk_.end(), data, data + n);
+            data += n;
+            size -= n;
+        } while (size > 0);
+#endif
+    }
+
+    bool PngRowWriter::WriteRows(const cv::Mat& rows) {
+        CV_Assert(rows.type() == CV_8UC3 && rows.cols == width_);
+        if (!file_.is_open() || rowsWritten_ + rows.rows > height_) return false;
+
+        // Scanlines: filter byte + RGB. With real compression the Sub filter pays off;
+        // stored blocks gain nothing from filtering.
+#if defined(PE_HAVE_ZLIB)
+        const uint8_t filter = 1; // Sub
+#else
+        const uint8_t filter = 0; // None
+#endif
+        size_t lineSize = 1 + static_cast<size_t>(width_) * 3;
+        scanlines_.resize(lineSize * rows.rows);
+        for (int y = 0; y < rows.rows; ++y) {
+            const uint8_t* src = rows.ptr<uint8_t>(y);
+            uint8_t* line = scanlines_.data() + y * lineSize;
+            line[0] = filter;
+            uint8_t* rgb = line + 1;
+            for (int x = 0; x < width_; ++x) {
+                rgb[3 * x + 0] = src[3 * x + 2];
+                rgb[3 * x + 1] = src[3 * x + 1];
+                rgb[3 * x + 2] = src[3 * x + 0];
+            }
+            if (filter == 1) {
+                for (size_t i = static_cast<size_t>(width_) * 3 - 1; i >= 3; --i) rgb[i] = static_cast<uint8_t>(rgb[i] - rgb[i - 3]);
+            }
+        }
+
+        adler_ = Adler32(adler_, scanlines_.data(), scanlines_.size());
+        Deflate(scanlines_.data(), scanlines_.size(), false);
+        rowsWritten_ += rows.rows;
+
+        bool ok = WriteIdat();
+        chunk_.clear();
+        return ok;
+    }
+
+    bool PngRowWriter::Close() {
+        if (!file_.is_open()) return false;
+        bool ok = rowsWritten_ == height_;
+        if (!ok) {
+            std::cerr << "PNG stream closed after " << rowsWritten_ << " of " << height_ << " rows." << std::endl;
+        }
+
+        Deflate(nullptr, 0, true);
+        PutU32(chunk_, adler_);
+        ok = WriteIdat() && ok;
+        chunk_.clear();
+        ok = WriteChunk("IEND", nullptr, 0) && ok;
+
+        file_.close();
+        ok = ok && !file_.fail();
+        if (!ok) return false;
+        if (tempPath_ == partialPath_) {
+            // A partial file is kept for another attempt
+            std::error_code ec;
+            std::filesystem::rename(tempPath_, path_, ec);
+            if (ec) return false;
+        } else if (!FileUtils::Publish(tempPath_, path_)) { // Removes the temporary file on failure
+            tempPath_.clear();
+            return false;
+        }
+        tempPath_.clear();
+        return true;
+    }
+
+    bool PngRowWriter::WriteIdat() {
+        // Chunk lengths are limited to 2^31 - 1; split huge bands
+        const size_t maxChunk = size_t(1) << 30;
+        for (size_t offset = 0; offset < chunk_.size(); offset += maxChunk) {
+            if (!WriteChunk("IDAT", chunk_.data() + offset, std::min(maxChunk, chunk_.size() - offset))) return false;
+        }
+        return true;
+    }
+
+    bool PngRowWriter::WriteChunk(const char type[4], const uint8_t* data, size_t size) {
+        uint8_t header[8] = {
+            static_cast<uint8_t>(size >> 24), static_cast<uint8_t>(size >> 16),
+            static_cast<uint8_t>(size >> 8), static_cast<uint8_t>(size),
+            static_cast<uint8_t>(type[0]), static_cast<uint8_t>(type[1]),
+            static_cast<uint8_t>(type[2]), static_cast<uint8_t>(type[3])};
+        uint32_t crc = Crc32(0, header + 4, 4);
+        if (size > 0) crc = Crc32(crc, data, size);
+
+        std::vector<uint8_t> trailer;
+        PutU32(trailer, crc);
+
+        file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+        if (size > 0) file_.write(reinterpret_cast<const char*>(data), size);
+        file_.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+        return !file_.fail();
+    }
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ImageUtils.hpp"
+
+namespace Core {
+
+    // How far a resumable writer got: rows written, and what it needs to continue
+    // its file after them (for PNG: the file length and the running Adler-32).
+    struct RowCheckpoint {
+        int rows = 0;
+        uint64_t bytes = 0;
+        uint32_t adler = 1;
+    };
+
+    // Sink for an image produced top to bottom, one band of rows at a time.
+    // Used by the streaming path so the full output never has to be in memory.
+    class RowWriter {
+    public:
+        virtual ~RowWriter() = default;
+
+        virtual bool Open(const std::wstring& path, int width, int height) = 0;
+
+        // rows: 8-bit BGR with the width passed to Open.
+        virtual bool WriteRows(const cv::Mat& rows) = 0;
+
+        // Finish the file. Fails if fewer rows than announced were written.
+        virtual bool Close() = 0;
+
+        // Resumable writing. Rows go to `partialPath`, which a failed or abandoned writer
+        // keeps; Close still renames it to the output path. Call before Open or Resume.
+        virtual void SetPartialPath(const std::filesystem::path& partialPath) { (void)partialPath; }
+
+        // Make the rows written so far durable and describe them. False if unsupported.
+        virtual bool Checkpoint(RowCheckpoint& checkpoint) { (void)checkpoint; return false; }
+
+        // Like Open, but continue the partial file after `checkpoint` (which this writer's
+        // Checkpoint returned for the same path, size and settings). False if unsupported
+        // or the partial file does not match.
+        virtual bool Resume(const std::wstring& path, int width, int height, const RowCheckpoint& checkpoint) {
+            (void)path, (void)width, (void)height, (void)checkpoint;
+            return false;
+        }
+
+        // Writer for the path's extension, or nullptr if the format cannot be written row-wise.
+        static std::unique_ptr<RowWriter> ForPath(const std::wstring& path, const EncodeOptions& options = {});
+    };
+
+    // Streaming PNG encoder (8-bit RGB). Each WriteRows call becomes one IDAT chunk.
+    // Uses zlib when available (PE_HAVE_ZLIB); otherwise writes stored (uncompressed) deflate blocks.
+    // Rows go to a temporary file that Close renames to the requested path; a writer
+    // destroyed before a successful Close removes it (unless it is a partial file).
+    // Resumable: bands end with a full flush, so a fresh deflate stream can continue
+    // the file after any of them.
+    class PngRowWriter : public RowWriter {
+    public:
+        explicit PngRowWriter(int compressionLevel = 1, PngStrategy strategy = PngStrategy::Default);
+        ~PngRowWriter() override;
+
+        bool Open(const std::wstring& path, int width, int height) override;
+        bool WriteRows(const cv::Mat& rows) override;
+        bool Close() override;
+
+        void SetPartialPath(const std::filesystem::path& partialPath) override;
+        bool Checkpoint(RowCheckpoint& checkpoint) override;
+        bool Resume(const std::wstring& path, int width, int height, const RowCheckpoint& checkpoint) override;
+
+    private:
+        int compressionLevel_;
+        PngStrategy strategy_;
+        std::filesystem::path path_;
+        std::filesystem::path tempPath_; // Empty once published or removed
+        std::filesystem::path partialPath_; // Fixed temporary file that outlives the writer
+        int width_ = 0;
+        int height_ = 0;
+        int rowsWritten_ = 0;
+        uint32_t adler_ = 1;
+        std::ofstream file_;
+        std::vector<uint8_t> scanlines_;
+        std::vector<uint8_t> chunk_;
+        void* zstream_ = nullptr; // z_stream*, only with PE_HAVE_ZLIB
+
+        bool WriteChunk(const char type[4], const uint8_t* data, size_t size);
+        bool WriteIdat();
+        bool StartDeflate();
+        void Deflate(const uint8_t* data, size_t size, bool finish);
+    };
+
+}
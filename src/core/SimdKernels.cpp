@@ -0,0 +1,536 @@
+#include "SimdKernels.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PE_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/Clang need per-function target attributes to emit SSE4.1/AVX2 code in a
+// baseline x86-64 build. MSVC always accepts the intrinsics.
+#if defined(PE_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define PE_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define PE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PE_TARGET_SSE41
+#define PE_TARGET_AVX2
+#endif
+
+namespace Core {
+namespace Simd {
+
+    namespace {
+
+        std::atomic<int> maxLevel{static_cast<int>(Level::AVX2)};
+
+        constexpr float kInv255 = 1.0f / 255.0f;
+
+        Level Detect() {
+#if defined(PE_SIMD_X86)
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool sse41 = (info[2] & (1 << 19)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            bool avx2 = false;
+            if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+            if (avx2) return Level::AVX2;
+            if (sse41) return Level::SSE41;
+#else
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+            if (__builtin_cpu_supports("sse4.1")) return Level::SSE41;
+#endif
+#endif
+            return Level::Scalar;
+        }
+
+        // ---- BGR uint8 HWC -> RGB float CHW ----
+
+        void BgrToPlanarRgbRow_Scalar(const uint8_t* src, int x, int width, float* r, float* g, float* b) {
+            for (; x < width; ++x) {
+                b[x] = src[3 * x + 0] * kInv255;
+                g[x] = src[3 * x + 1] * kInv255;
+                r[x] = src[3 * x + 2] * kInv255;
+            }
+        }
+
+        // ---- RGB float CHW -> BGR uint8 HWC ----
+
+        inline uint8_t ToByte(float v) {
+            v = v > 0.0f ? v : 0.0f; // also maps NaN to 0
+            v = v < 1.0f ? v : 1.0f;
+            return static_cast<uint8_t>(std::lrintf(v * 255.0f));
+        }
+
+        void PlanarRgbToBgrRow_Scalar(const float* r, const float* g, const float* b, int x, int width, uint8_t* dst) {
+            for (; x < width; ++x) {
+                dst[3 * x + 0] = ToByte(b[x]);
+                dst[3 * x + 1] = ToByte(g[x]);
+                dst[3 * x + 2] = ToByte(r[x]);
+            }
+        }
+
+        // ---- Weighted accumulation (tile blending) ----
+
+        void MultiplyAccumulate_Scalar(const float* src, const float* weights, float scale, float* acc, int i, int count) {
+            for (; i < count; ++i) acc[i] += src[i] * (weights[i] * scale);
+        }
+
+        void AccumulateScaled_Scalar(const float* weights, float scale, float* acc, int i, int count) {
+            for (; i < count; ++i) acc[i] += weights[i] * scale;
+        }
+
+        void DivideInPlace_Scalar(float* data, const float* weights, int i, int count) {
+            for (; i < count; ++i) {
+                if (weights[i] != 0.0f) data[i] /= weights[i];
+            }
+        }
+
+        // ---- Separable filtering (sharpening) ----
+
+        void AddScaled_Scalar(const float* src, float scale, float* acc, int i, int count) {
+            for (; i < count; ++i) acc[i] += src[i] * scale;
+        }
+
+        void BytesToFloat_Scalar(const uint8_t* src, float* dst, int i, int count) {
+            for (; i < count; ++i) dst[i] = src[i];
+        }
+
+        void UnsharpBytes_Scalar(const uint8_t* src, const float* blurred, float amount, uint8_t* dst, int i, int count) {
+            for (; i < count; ++i) {
+                float s = src[i];
+                long v = std::lrintf(s + amount * (s - blurred[i]));
+                dst[i] = static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+            }
+        }
+
+#if defined(PE_SIMD_X86)
+        // pshufb masks gathering channel `c` of 16 interleaved pixels from the
+        // three 16-byte loads a/b/c (bytes 0-15, 16-31, 32-47).
+        struct DeinterleaveMasks {
+            int8_t m[3][3][16]; // [channel][load][lane]
+        };
+
+        constexpr DeinterleaveMasks MakeDeinterleaveMasks() {
+            DeinterleaveMasks masks{};
+            for (int c = 0; c < 3; ++c) {
+                for (int part = 0; part < 3; ++part) {
+                    for (int i = 0; i < 16; ++i) {
+                        int pos = 3 * i + c - 16 * part;
+                        masks.m[c][part][i] = (pos >= 0 && pos < 16) ? static_cast<int8_t>(pos) : static_cast<int8_t>(-128);
+                    }
+                }
+            }
+            return masks;
+        }
+
+        constexpr DeinterleaveMasks kDeinterleave = MakeDeinterleaveMasks();
+
+        // pshufb masks scattering 16 bytes of channel `c` into output block `part`
+        // of 16 interleaved BGR pixels.
+        struct InterleaveMasks {
+            int8_t m[3][3][16]; // [part][channel][lane]
+        };
+
+        constexpr InterleaveMasks MakeInterleaveMasks() {
+            InterleaveMasks masks{};
+            for (int part = 0; part < 3; ++part) {
+                for (int c = 0; c < 3; ++c) {
+                    for (int j = 0; j < 16; ++j) {
+                        int pos = 16 * part + j;
+                        masks.m[part][c][j] = (pos % 3 == c) ? static_cast<int8_t>(pos / 3) : static_cast<int8_t>(-128);
+                    }
+                }
+            }
+            return masks;
+        }
+
+        constexpr InterleaveMasks kInterleave = MakeInterleaveMasks();
+
+        PE_TARGET_SSE41 inline void StoreInterleaved(__m128i b, __m128i g, __m128i r, uint8_t* dst) {
+            for (int part = 0; part < 3; ++part) {
+                const __m128i mb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kInterleave.m[part][0]));
+                const __m128i mg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kInterleave.m[part][1]));
+                const __m128i mr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kInterleave.m[part][2]));
+                __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, mb), _mm_shuffle_epi8(g, mg)), _mm_shuffle_epi8(r, mr));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * part), out);
+            }
+        }
+
+        PE_TARGET_SSE41 inline __m128i ToInt4_SSE41(const float* src) {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            // max(v, 0) returns 0 for NaN, matching the scalar path
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), zero), one);
+            return _mm_cvtps_epi32(_mm_mul_ps(v, scale));
+        }
+
+        PE_TARGET_SSE41 inline __m128i ToBytes16_SSE41(const float* src) {
+            __m128i lo = _mm_packs_epi32(ToInt4_SSE41(src), ToInt4_SSE41(src + 4));
+            __m128i hi = _mm_packs_epi32(ToInt4_SSE41(src + 8), ToInt4_SSE41(src + 12));
+            return _mm_packus_epi16(lo, hi);
+        }
+
+        PE_TARGET_SSE41 void PlanarRgbToBgrRow_SSE41(const float* r, const float* g, const float* b, int width, uint8_t* dst) {
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                StoreInterleaved(ToBytes16_SSE41(b + x), ToBytes16_SSE41(g + x), ToBytes16_SSE41(r + x), dst + 3 * x);
+            }
+            PlanarRgbToBgrRow_Scalar(r, g, b, x, width, dst);
+        }
+
+        PE_TARGET_AVX2 inline __m128i ToInt8x16_AVX2(const float* src) {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 scale = _mm256_set1_ps(255.0f);
+            __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), zero), one);
+            __m256i i32 = _mm256_cvtps_epi32(_mm256_mul_ps(v, scale));
+            return _mm_packs_epi32(_mm256_castsi256_si128(i32), _mm256_extracti128_si256(i32, 1));
+        }
+
+        PE_TARGET_AVX2 inline __m128i ToBytes16_AVX2(const float* src) {
+            return _mm_packus_epi16(ToInt8x16_AVX2(src), ToInt8x16_AVX2(src + 8));
+        }
+
+        PE_TARGET_AVX2 void PlanarRgbToBgrRow_AVX2(const float* r, const float* g, const float* b, int width, uint8_t* dst) {
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                StoreInterleaved(ToBytes16_AVX2(b + x), ToBytes16_AVX2(g + x), ToBytes16_AVX2(r + x), dst + 3 * x);
+            }
+            PlanarRgbToBgrRow_Scalar(r, g, b, x, width, dst);
+        }
+
+        PE_TARGET_SSE41 void MultiplyAccumulate_SSE41(const float* src, const float* weights, float scale, float* acc, int count) {
+            const __m128 s = _mm_set1_ps(scale);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 w = _mm_mul_ps(_mm_loadu_ps(weights + i), s);
+                _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), w)));
+            }
+            MultiplyAccumulate_Scalar(src, weights, scale, acc, i, count);
+        }
+
+        PE_TARGET_AVX2 void MultiplyAccumulate_AVX2(const float* src, const float* weights, float scale, float* acc, int count) {
+            const __m256 s = _mm256_set1_ps(scale);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 w = _mm256_mul_ps(_mm256_loadu_ps(weights + i), s);
+                _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), w)));
+            }
+            MultiplyAccumulate_Scalar(src, weights, scale, acc, i, count);
+        }
+
+        PE_TARGET_SSE41 void AccumulateScaled_SSE41(const float* weights, float scale, float* acc, int count) {
+            const __m128 s = _mm_set1_ps(scale);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(weights + i), s)));
+            }
+            AccumulateScaled_Scalar(weights, scale, acc, i, count);
+        }
+
+        PE_TARGET_AVX2 void AccumulateScaled_AVX2(const float* weights, float scale, float* acc, int count) {
+            const __m256 s = _mm256_set1_ps(scale);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(weights + i), s)));
+            }
+            AccumulateScaled_Scalar(weights, scale, acc, i, count);
+        }
+
+        PE_TARGET_SSE41 void DivideInPlace_SSE41(float* data, const float* weights, int count) {
+            const __m128 zero = _mm_setzero_ps();
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                __m128 w = _mm_loadu_ps(weights + i);
+                __m128 d = _mm_loadu_ps(data + i);
+                __m128 valid = _mm_cmpneq_ps(w, zero);
+                _mm_storeu_ps(data + i, _mm_blendv_ps(d, _mm_div_ps(d, w), valid));
+            }
+            DivideInPlace_Scalar(data, weights, i, count);
+        }
+
+        PE_TARGET_AVX2 void DivideInPlace_AVX2(float* data, const float* weights, int count) {
+            const __m256 zero = _mm256_setzero_ps();
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256 w = _mm256_loadu_ps(weights + i);
+                __m256 d = _mm256_loadu_ps(data + i);
+                __m256 valid = _mm256_cmp_ps(w, zero, _CMP_NEQ_UQ);
+                _mm256_storeu_ps(data + i, _mm256_blendv_ps(d, _mm256_div_ps(d, w), valid));
+            }
+            DivideInPlace_Scalar(data, weights, i, count);
+        }
+
+        PE_TARGET_SSE41 void AddScaled_SSE41(const float* src, float scale, float* acc, int count) {
+            const __m128 s = _mm_set1_ps(scale);
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), s)));
+            }
+            AddScaled_Scalar(src, scale, acc, i, count);
+        }
+
+        PE_TARGET_AVX2 void AddScaled_AVX2(const float* src, float scale, float* acc, int count) {
+            const __m256 s = _mm256_set1_ps(scale);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(src + i), s)));
+            }
+            AddScaled_Scalar(src, scale, acc, i, count);
+        }
+
+        PE_TARGET_SSE41 void BytesToFloat_SSE41(const uint8_t* src, float* dst, int count) {
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                int32_t bytes;
+                std::memcpy(&bytes, src + i, sizeof(bytes));
+                _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes))));
+            }
+            BytesToFloat_Scalar(src, dst, i, count);
+        }
+
+        PE_TARGET_AVX2 void BytesToFloat_AVX2(const uint8_t* src, float* dst, int count) {
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+                _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)));
+            }
+            BytesToFloat_Scalar(src, dst, i, count);
+        }
+
+        PE_TARGET_SSE41 inline __m128i Unsharp4_SSE41(const uint8_t* src, const float* blurred, __m128 amount) {
+            int32_t bytes;
+            std::memcpy(&bytes, src, sizeof(bytes));
+            __m128 s = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes)));
+            __m128 v = _mm_add_ps(s, _mm_mul_ps(amount, _mm_sub_ps(s, _mm_loadu_ps(blurred))));
+            return _mm_cvtps_epi32(v);
+        }
+
+        PE_TARGET_SSE41 void UnsharpBytes_SSE41(const uint8_t* src, const float* blurred, float amount, uint8_t* dst, int count) {
+            const __m128 a = _mm_set1_ps(amount);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                __m128i lo = _mm_packs_epi32(Unsharp4_SSE41(src + i, blurred + i, a), Unsharp4_SSE41(src + i + 4, blurred + i + 4, a));
+                __m128i hi = _mm_packs_epi32(Unsharp4_SSE41(src + i + 8, blurred + i + 8, a), Unsharp4_SSE41(src + i + 12, blurred + i + 12, a));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+            }
+            UnsharpBytes_Scalar(src, blurred, amount, dst, i, count);
+        }
+
+        PE_TARGET_AVX2 inline __m256i Unsharp8_AVX2(const uint8_t* src, const float* blurred, __m256 amount) {
+            __m256 s = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+            __m256 v = _mm256_add_ps(s, _mm256_mul_ps(amount, _mm256_sub_ps(s, _mm256_loadu_ps(blurred))));
+            return _mm256_cvtps_epi32(v);
+        }
+
+        PE_TARGET_AVX2 void UnsharpBytes_AVX2(const uint8_t* src, const float* blurred, float amount, uint8_t* dst, int count) {
+            const __m256 a = _mm256_set1_ps(amount);
+            int i = 0;
+            for (; i + 16 <= count; i += 16) {
+                // packs works per 128-bit lane; the permute restores element order
+                __m256i words = _mm256_packs_epi32(Unsharp8_AVX2(src + i, blurred + i, a), Unsharp8_AVX2(src + i + 8, blurred + i + 8, a));
+                words = _mm256_permute4x64_epi64(words, _MM_SHUFFLE(3, 1, 2, 0));
+                __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), bytes);
+            }
+            UnsharpBytes_Scalar(src, blurred, amount, dst, i, count);
+        }
+
+        PE_TARGET_SSE41 inline __m128i GatherChannel(__m128i a, __m128i b, __m128i c, int channel) {
+            const __m128i m0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDeinterleave.m[channel][0]));
+            const __m128i m1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDeinterleave.m[channel][1]));
+            const __m128i m2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDeinterleave.m[channel][2]));
+            return _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m0), _mm_shuffle_epi8(b, m1)), _mm_shuffle_epi8(c, m2));
+        }
+
+        PE_TARGET_SSE41 inline void StoreNormalized16_SSE41(__m128i bytes, float* dst, __m128 scale) {
+            for (int i = 0; i < 4; ++i) {
+                __m128i v = _mm_cvtepu8_epi32(bytes);
+                _mm_storeu_ps(dst + 4 * i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+                bytes = _mm_srli_si128(bytes, 4);
+            }
+        }
+
+        PE_TARGET_SSE41 void BgrToPlanarRgbRow_SSE41(const uint8_t* src, int width, float* r, float* g, float* b) {
+            const __m128 scale = _mm_set1_ps(kInv255);
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                const uint8_t* p = src + 3 * x;
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+                __m128i vc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+                StoreNormalized16_SSE41(GatherChannel(va, vb, vc, 0), b + x, scale);
+                StoreNormalized16_SSE41(GatherChannel(va, vb, vc, 1), g + x, scale);
+                StoreNormalized16_SSE41(GatherChannel(va, vb, vc, 2), r + x, scale);
+            }
+            BgrToPlanarRgbRow_Scalar(src, x, width, r, g, b);
+        }
+
+        PE_TARGET_AVX2 inline void StoreNormalized16_AVX2(__m128i bytes, float* dst, __m256 scale) {
+            __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+            __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+            _mm256_storeu_ps(dst, _mm256_mul_ps(lo, scale));
+            _mm256_storeu_ps(dst + 8, _mm256_mul_ps(hi, scale));
+        }
+
+        PE_TARGET_AVX2 void BgrToPlanarRgbRow_AVX2(const uint8_t* src, int width, float* r, float* g, float* b) {
+            const __m256 scale = _mm256_set1_ps(kInv255);
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                const uint8_t* p = src + 3 * x;
+                __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+                __m128i vc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+                StoreNormalized16_AVX2(GatherChannel(va, vb, vc, 0), b + x, scale);
+                StoreNormalized16_AVX2(GatherChannel(va, vb, vc, 1), g + x, scale);
+                StoreNormalized16_AVX2(GatherChannel(va, vb, vc, 2), r + x, scale);
+            }
+            BgrToPlanarRgbRow_Scalar(src, x, width, r, g, b);
+        }
+#endif
+
+    }
+
+    Level DetectedLevel() {
+        static const Level detected = Detect();
+        return detected;
+    }
+
+    Level ActiveLevel() {
+        int detected = static_cast<int>(DetectedLevel());
+        int cap = maxLevel.load(std::memory_order_relaxed);
+        return static_cast<Level>(detected < cap ? detected : cap);
+    }
+
+    void SetMaxLevel(Level level) {
+        maxLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    const char* LevelName(Level level) {
+        switch (level) {
+            case Level::AVX2: return "avx2";
+            case Level::SSE41: return "sse4.1";
+            default: return "scalar";
+        }
+    }
+
+    void BgrToPlanarRgb(const uint8_t* src, size_t srcStride, int width, int height, float* dst) {
+        size_t plane = static_cast<size_t>(width) * height;
+        float* r = dst;
+        float* g = dst + plane;
+        float* b = dst + 2 * plane;
+        Level level = ActiveLevel();
+
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* row = src + y * srcStride;
+            size_t offset = static_cast<size_t>(y) * width;
+#if defined(PE_SIMD_X86)
+            if (level == Level::AVX2) {
+                BgrToPlanarRgbRow_AVX2(row, width, r + offset, g + offset, b + offset);
+                continue;
+            }
+            if (level == Level::SSE41) {
+                BgrToPlanarRgbRow_SSE41(row, width, r + offset, g + offset, b + offset);
+                continue;
+            }
+#endif
+            (void)level;
+            BgrToPlanarRgbRow_Scalar(row, 0, width, r + offset, g + offset, b + offset);
+        }
+    }
+
+    void PlanarRgbToBgr(const float* src, size_t planeSize, size_t srcStride, int width, int height,
+                        uint8_t* dst, size_t dstStride) {
+        const float* r = src;
+        const float* g = src + planeSize;
+        const float* b = src + 2 * planeSize;
+        Level level = ActiveLevel();
+
+        for (int y = 0; y < height; ++y) {
+            size_t offset = y * srcStride;
+            uint8_t* row = dst + y * dstStride;
+#if defined(PE_SIMD_X86)
+            if (level == Level::AVX2) {
+                PlanarRgbToBgrRow_AVX2(r + offset, g + offset, b + offset, width, row);
+                continue;
+            }
+            if (level == Level::SSE41) {
+                PlanarRgbToBgrRow_SSE41(r + offset, g + offset, b + offset, width, row);
+                continue;
+            }
+#endif
+            (void)level;
+            PlanarRgbToBgrRow_Scalar(r + offset, g + offset, b + offset, 0, width, row);
+        }
+    }
+
+    void MultiplyAccumulate(const float* src, const float* weights, float scale, float* acc, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return MultiplyAccumulate_AVX2(src, weights, scale, acc, count);
+        if (level == Level::SSE41) return MultiplyAccumulate_SSE41(src, weights, scale, acc, count);
+#endif
+        MultiplyAccumulate_Scalar(src, weights, scale, acc, 0, count);
+    }
+
+    void AccumulateScaled(const float* weights, float scale, float* acc, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return AccumulateScaled_AVX2(weights, scale, acc, count);
+        if (level == Level::SSE41) return AccumulateScaled_SSE41(weights, scale, acc, count);
+#endif
+        AccumulateScaled_Scalar(weights, scale, acc, 0, count);
+    }
+
+    void DivideInPlace(float* data, const float* weights, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return DivideInPlace_AVX2(data, weights, count);
+        if (level == Level::SSE41) return DivideInPlace_SSE41(data, weights, count);
+#endif
+        DivideInPlace_Scalar(data, weights, 0, count);
+    }
+
+    void AddScaled(const float* src, float scale, float* acc, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return AddScaled_AVX2(src, scale, acc, count);
+        if (level == Level::SSE41) return AddScaled_SSE41(src, scale, acc, count);
+#endif
+        AddScaled_Scalar(src, scale, acc, 0, count);
+    }
+
+    void BytesToFloat(const uint8_t* src, float* dst, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return BytesToFloat_AVX2(src, dst, count);
+        if (level == Level::SSE41) return BytesToFloat_SSE41(src, dst, count);
+#endif
+        BytesToFloat_Scalar(src, dst, 0, count);
+    }
+
+    void UnsharpBytes(const uint8_t* src, const float* blurred, float amount, uint8_t* dst, int count) {
+#if defined(PE_SIMD_X86)
+        Level level = ActiveLevel();
+        if (level == Level::AVX2) return UnsharpBytes_AVX2(src, blurred, amount, dst, count);
+        if (level == Level::SSE41) return UnsharpBytes_SSE41(src, blurred, amount, dst, count);
+#endif
+        UnsharpBytes_Scalar(src, blurred, amount, dst, 0, count);
+    }
+
+}
+}
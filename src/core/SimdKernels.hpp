@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core {
+
+    // Per-pixel kernels with runtime CPU dispatch (AVX2 / SSE4.1 / scalar).
+    // All kernels take raw pointers and strides so they work on OpenCV ROIs
+    // without copying.
+    namespace Simd {
+
+        enum class Level {
+            Scalar,
+            SSE41,
+            AVX2
+        };
+
+        // Best level supported by this CPU (and build).
+        Level DetectedLevel();
+
+        // Level actually used by the kernels: DetectedLevel() capped by SetMaxLevel().
+        Level ActiveLevel();
+
+        // Cap the dispatch level, e.g. to compare implementations in benchmarks.
+        void SetMaxLevel(Level level);
+
+        const char* LevelName(Level level);
+
+        // 8-bit interleaved BGR (HWC) -> normalized [0, 1] planar RGB float (CHW).
+        // src: first pixel of the ROI, srcStride: bytes between rows.
+        // dst: 3 planes of width*height floats, R first.
+        void BgrToPlanarRgb(const uint8_t* src, size_t srcStride, int width, int height, float* dst);
+
+        // Planar RGB float (CHW) -> 8-bit interleaved BGR, clamped to [0, 1], scaled by 255
+        // and rounded to nearest.
+        // src: first pixel of the region in the R plane, planeSize: floats per plane,
+        // srcStride: floats between rows. dst: first pixel of the ROI, dstStride: bytes between rows.
+        void PlanarRgbToBgr(const float* src, size_t planeSize, size_t srcStride, int width, int height,
+                            uint8_t* dst, size_t dstStride);
+
+        // acc[i] += src[i] * weights[i] * scale
+        void MultiplyAccumulate(const float* src, const float* weights, float scale, float* acc, int count);
+
+        // acc[i] += weights[i] * scale
+        void AccumulateScaled(const float* weights, float scale, float* acc, int count);
+
+        // data[i] /= weights[i] (entries with zero weight are left unchanged)
+        void DivideInPlace(float* data, const float* weights, int count);
+
+        // acc[i] += src[i] * scale (one tap of a separable filter)
+        void AddScaled(const float* src, float scale, float* acc, int count);
+
+        // dst[i] = src[i]
+        void BytesToFloat(const uint8_t* src, float* dst, int count);
+
+        // Unsharp mask: dst[i] = src[i] + amount * (src[i] - blurred[i]), rounded to nearest
+        // and saturated to [0, 255]. dst may equal src.
+        void UnsharpBytes(const uint8_t* src, const float* blurred, float amount, uint8_t* dst, int count);
+
+    }
+
+}
@@ -0,0 +1,174 @@
+#include "SyncManifest.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace Core {
+
+    namespace {
+
+        const char* const kHeader = "enhancer-manifest 1 ";
+
+        // Separators are stored as '/', so a manifest can follow a tree to another system
+        std::string StoredPath(const std::wstring& relative) {
+            return FileUtils::EscapePath(fs::path(relative).generic_wstring());
+        }
+
+        std::wstring LoadedPath(const std::string& stored) {
+            return fs::path(FileUtils::UnescapePath(stored)).make_preferred().wstring();
+        }
+
+        // The whole of `text` is a number in `base`
+        template <typename T>
+        bool ParseNumber(const std::string& text, T& value, int base = 10) {
+            const char* end = text.data() + text.size();
+            auto result = std::from_chars(text.data(), end, value, base);
+            return !text.empty() && result.ec == std::errc() && result.ptr == end;
+        }
+
+        // `relative` is inside directory `dir` (empty: the root)
+        bool IsUnder(const std::wstring& relative, const std::wstring& dir) {
+            if (dir.empty()) return true;
+            return relative.size() > dir.size() && relative.compare(0, dir.size(), dir) == 0 &&
+                   relative[dir.size()] == fs::path::preferred_separator;
+        }
+
+    }
+
+    SyncManifest::SyncManifest(const std::wstring& path, const std::string& settingsKey)
+        : path_(path), settingsKey_(settingsKey) {}
+
+    bool SyncManifest::Load() {
+        entries_.clear();
+        ignored_ = 0;
+        std::ifstream in{fs::path(path_), std::ios::binary};
+        std::string line;
+        if (!std::getline(in, line)) return false;
+        if (line != kHeader + settingsKey_) {
+            std::cout << "The manifest was written with other settings; every input counts as new." << std::endl;
+            return false;
+        }
+        // hash \t size \t modified \t relative path
+        while (std::getline(in, line)) {
+            size_t a = line.find('\t');
+            size_t b = a == std::string::npos ? a : line.find('\t', a + 1);
+            size_t c = b == std::string::npos ? b : line.find('\t', b + 1);
+            Entry entry;
+            if (c == std::string::npos || c + 1 == line.size() ||
+                !ParseNumber(line.substr(0, a), entry.hash, 16) ||
+                !ParseNumber(line.substr(a + 1, b - a - 1), entry.size) ||
+                !ParseNumber(line.substr(b + 1, c - b - 1), entry.modified)) {
+                ignored_++;
+                continue;
+            }
+            entries_[LoadedPath(line.substr(c + 1))] = entry;
+        }
+        if (ignored_ > 0) std::cout << "Ignored " << ignored_ << " malformed manifest line(s); their files count as new." << std::endl;
+        return true;
+    }
+
+    bool SyncManifest::Save() const {
+        fs::path temp = FileUtils::TempPathFor(path_);
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out << kHeader << settingsKey_ << "\n";
+            for (const auto& item : entries_) {
+                const Entry& entry = item.second;
+                out << Hash::ToHex(entry.hash) << "\t" << entry.size << "\t" << entry.modified << "\t" << StoredPath(item.first) << "\n";
+            }
+            out.close();
+            if (out.fail()) {
+                std::error_code ec;
+                fs::remove(temp, ec);
+                std::wcerr << L"Failed to write the manifest: " << path_ << std::endl;
+                return false;
+            }
+        }
+        FileUtils::SyncFile(temp);
+        return FileUtils::Publish(temp, path_);
+    }
+
+    SyncPlan SyncManifest::Plan(const std::vector<ScannedFile>& files, int threads, const std::vector<std::wstring>& unreadable) {
+        SyncPlan plan;
+
+        // Unchanged files are decided from the listing alone
+        std::vector<size_t> candidates;
+        std::unordered_set<std::wstring> seen;
+        seen.reserve(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            seen.insert(files[i].relative);
+            auto it = entries_.find(files[i].relative);
+            if (it != entries_.end() && it->second.size == files[i].size && it->second.modified == files[i].modified) {
+                plan.unchanged++;
+            } else {
+                candidates.push_back(i);
+            }
+        }
+        // Files missing from the scan are only gone if their directory was listed
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (seen.count(it->first)) {
+                ++it;
+            } else if (std::any_of(unreadable.begin(), unreadable.end(), [&](const std::wstring& dir) { return IsUnder(it->first, dir); })) {
+                ++it;
+                plan.unlisted++;
+            } else {
+                it = entries_.erase(it);
+                plan.removed++;
+            }
+        }
+
+        // The rest are opened: signature check and content hash, in parallel
+        std::vector<uint64_t> hashes(candidates.size(), 0);
+        std::vector<char> valid(candidates.size(), 0);
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t k = next.fetch_add(1); k < candidates.size(); k = next.fetch_add(1)) {
+                const ScannedFile& file = files[candidates[k]];
+                valid[k] = DirectoryScan::HasImageSignature(file.path) && Hash::File(file.path, hashes[k]);
+            }
+        };
+        std::vector<std::thread> workers;
+        int count = std::max(1, std::min(threads, static_cast<int>(candidates.size())));
+        for (int t = 1; t < count; ++t) workers.emplace_back(worker);
+        worker();
+        for (auto& t : workers) t.join();
+
+        for (size_t k = 0; k < candidates.size(); ++k) {
+            const ScannedFile& file = files[candidates[k]];
+            if (!valid[k]) {
+                plan.rejected++;
+                continue;
+            }
+            auto it = entries_.find(file.relative);
+            if (it == entries_.end()) {
+                plan.added++;
+            } else if (it->second.size == file.size && it->second.hash == hashes[k]) {
+                it->second.modified = file.modified;
+                plan.touched++;
+                continue;
+            } else {
+                plan.modified++;
+            }
+            plan.process.push_back(candidates[k]);
+            plan.hashes.push_back(hashes[k]);
+        }
+        return plan;
+    }
+
+    void SyncManifest::Update(const ScannedFile& file, uint64_t hash) {
+        Entry& entry = entries_[file.relative];
+        entry.size = file.size;
+        entry.modified = file.modified;
+        entry.hash = hash;
+    }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DirectoryScan.hpp"
+
+namespace Core {
+
+    // What an incremental run has to do, from comparing a scan with the manifest
+    struct SyncPlan {
+        std::vector<size_t> process;  // Indices into the scan of new or modified images
+        std::vector<uint64_t> hashes; // Content hash of each file in `process`
+        size_t unchanged = 0;         // Same size and modification time
+        size_t touched = 0;           // New modification time, same contents
+        size_t added = 0;
+        size_t modified = 0;
+        size_t rejected = 0;          // Image name but no image signature
+        size_t removed = 0;           // In the manifest, gone from the input
+        size_t unlisted = 0;          // In the manifest, in a directory the scan could not read
+    };
+
+    // Persisted state of an incremental input directory: size, modification time and
+    // content hash of every input as of its last successful enhancement.
+    //
+    // A file whose size and modification time match its entry is skipped without being
+    // opened, so a rerun over a mostly unchanged tree costs one directory listing.
+    // Files with a new time but the same size are hashed; only changed contents count.
+    // Entries are tied to the output settings: a manifest written with others is ignored.
+    class SyncManifest {
+    public:
+        SyncManifest(const std::wstring& path, const std::string& settingsKey);
+
+        // Read the manifest; false (and empty) if it is missing or for other settings.
+        // Malformed entries are skipped (see Ignored), so their files count as new.
+        bool Load();
+
+        // Write the manifest through a temporary file
+        bool Save() const;
+
+        // Compare `files` (a scan) with the entries, hashing on `threads` threads where
+        // needed. Touched entries are updated and entries of removed files dropped;
+        // entries under `unreadable` directories (as reported by the scan) are kept.
+        SyncPlan Plan(const std::vector<ScannedFile>& files, int threads, const std::vector<std::wstring>& unreadable = {});
+
+        // Record a successfully enhanced file
+        void Update(const ScannedFile& file, uint64_t hash);
+
+        size_t Size() const { return entries_.size(); }
+
+        // Malformed lines skipped by the last Load
+        size_t Ignored() const { return ignored_; }
+
+    private:
+        struct Entry {
+            uint64_t size = 0;
+            int64_t modified = 0;
+            uint64_t hash = 0;
+        };
+
+        std::wstring path_;
+        std::string settingsKey_;
+        std::unordered_map<std::wstring, Entry> entries_; // By relative path
+        size_t ignored_ = 0;
+    };
+
+}
@@ -0,0 +1,233 @@
+#include "Telemetry.hpp"
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace Core {
+
+    namespace Telemetry {
+
+        namespace {
+
+            using Clock = std::chrono::steady_clock;
+
+            int64_t Nanoseconds(Clock::duration d) {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            }
+
+            // Small, stable thread numbers for trace rows
+            uint32_t ThreadNumber() {
+                static std::atomic<uint32_t> next{0};
+                thread_local uint32_t number = next.fetch_add(1);
+                return number;
+            }
+
+            std::string JsonString(const std::string& s) {
+                std::ostringstream out;
+                out << '"';
+                for (unsigned char c : s) {
+                    if (c == '"' || c == '\\') out << '\\' << c;
+                    else if (c < 0x20) out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                    else out << c;
+                }
+                out << '"';
+                return out.str();
+            }
+
+            void WriteStats(std::ostream& out, const Stats& stats, const std::string& indent) {
+                out << indent << "\"stages\": {";
+                for (size_t i = 0; i < kStageCount; ++i) {
+                    out << (i ? ", " : "") << "\"" << StageName(static_cast<Stage>(i)) << "\": {\"ms\": " << stats.stageMs[i]
+                        << ", \"calls\": " << stats.stageCalls[i] << "}";
+                }
+                out << "},\n" << indent << "\"counters\": {";
+                for (size_t i = 0; i < kCounterCount; ++i) {
+                    out << (i ? ", " : "") << "\"" << CounterName(static_cast<Counter>(i)) << "\": " << stats.counters[i];
+                }
+                out << "},\n" << indent << "\"tile_skip_ratio\": " << stats.TileSkipRatio();
+            }
+
+        }
+
+        const char* StageName(Stage stage) {
+            switch (stage) {
+            case Stage::ResultCache: return "result_cache";
+            case Stage::Decode: return "decode";
+            case Stage::PreProcess: return "preprocess";
+            case Stage::Inference: return "inference";
+            case Stage::Resample: return "resample";
+            case Stage::Blend: return "blend";
+            case Stage::Sharpen: return "sharpen";
+            case Stage::Encode: return "encode";
+            default: return "unknown";
+            }
+        }
+
+        const char* CounterName(Counter counter) {
+            switch (counter) {
+            case Counter::Tiles: return "tiles";
+            case Counter::TilesFilled: return "tiles_filled";
+            case Counter::TilesReused: return "tiles_reused";
+            case Counter::TilesResampled: return "tiles_resampled";
+            case Counter::InferenceCalls: return "inference_calls";
+            case Counter::BytesRead: return "bytes_read";
+            case Counter::BytesWritten: return "bytes_written";
+            case Counter::Allocations: return "allocations";
+            case Counter::AllocatedBytes: return "allocated_bytes";
+            case Counter::BufferReuses: return "buffer_reuses";
+            default: return "unknown";
+            }
+        }
+
+        const char* GaugeName(Gauge gauge) {
+            switch (gauge) {
+            case Gauge::DecodeQueueDepth: return "decode_queue_depth";
+            case Gauge::EncodeQueueDepth: return "encode_queue_depth";
+            case Gauge::TileQueueDepth: return "tile_queue_depth";
+            default: return "unknown";
+            }
+        }
+
+        void Stats::Add(const Stats& other) {
+            for (size_t i = 0; i < kStageCount; ++i) {
+                stageMs[i] += other.stageMs[i];
+                stageCalls[i] += other.stageCalls[i];
+            }
+            for (size_t i = 0; i < kCounterCount; ++i) counters[i] += other.counters[i];
+        }
+
+        double Stats::TileSkipRatio() const {
+            uint64_t skipped = Value(Counter::TilesFilled) + Value(Counter::TilesReused) + Value(Counter::TilesResampled);
+            uint64_t total = skipped + Value(Counter::Tiles);
+            return total ? static_cast<double>(skipped) / total : 0.0;
+        }
+
+        FileStats::FileStats(Collector& collector, uint32_t index, std::string file)
+            : collector_(collector), index_(index), file_(std::move(file)) {}
+
+        void FileStats::AddTime(Stage stage, Clock::time_point start, Clock::time_point end) {
+            size_t i = static_cast<size_t>(stage);
+            stageNs_[i].fetch_add(static_cast<uint64_t>(Nanoseconds(end - start)), std::memory_order_relaxed);
+            stageCalls_[i].fetch_add(1, std::memory_order_relaxed);
+            Touch(start, end);
+
+            if (collector_.trace_) collector_.AddEvent(*this, stage, start, end);
+        }
+
+        void FileStats::Finish(bool ok) {
+            ok_ = ok;
+            Clock::time_point now = Clock::now();
+            Touch(now, now);
+        }
+
+        void FileStats::Touch(Clock::time_point start, Clock::time_point end) {
+            int64_t startNs = Nanoseconds(start - collector_.batchBegin_);
+            int64_t endNs = Nanoseconds(end - collector_.batchBegin_);
+            int64_t first = firstNs_.load(std::memory_order_relaxed);
+            while (startNs < first && !firstNs_.compare_exchange_weak(first, startNs, std::memory_order_relaxed)) {}
+            int64_t last = lastNs_.load(std::memory_order_relaxed);
+            while (endNs > last && !lastNs_.compare_exchange_weak(last, endNs, std::memory_order_relaxed)) {}
+        }
+
+        FileReport FileStats::Report() const {
+            FileReport report;
+            report.file = file_;
+            report.ok = ok_;
+            int64_t first = firstNs_.load();
+            int64_t last = lastNs_.load();
+            report.wallMs = last > first ? (last - first) / 1e6 : 0.0;
+            for (size_t i = 0; i < kStageCount; ++i) {
+                report.stats.stageMs[i] = stageNs_[i].load() / 1e6;
+                report.stats.stageCalls[i] = stageCalls_[i].load();
+            }
+            for (size_t i = 0; i < kCounterCount; ++i) report.stats.counters[i] = counters_[i].load();
+            return report;
+        }
+
+        Collector::Collector(bool trace) : trace_(trace), batchBegin_(Clock::now()) {}
+
+        void Collector::BeginBatch() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_.clear();
+            events_.clear();
+            for (auto& peak : peaks_) peak = 0;
+            batchBegin_ = Clock::now();
+            batchEnd_ = Clock::time_point();
+        }
+
+        void Collector::EndBatch() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batchEnd_ = Clock::now();
+        }
+
+        FileStats* Collector::AddFile(const std::wstring& path) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_.push_back(std::make_unique<FileStats>(*this, static_cast<uint32_t>(files_.size()), std::filesystem::path(path).u8string()));
+            return files_.back().get();
+        }
+
+        void Collector::Peak(Gauge gauge, uint64_t value) {
+            std::atomic<uint64_t>& peak = peaks_[static_cast<size_t>(gauge)];
+            uint64_t current = peak.load(std::memory_order_relaxed);
+            while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        }
+
+        void Collector::AddEvent(const FileStats& file, Stage stage, Clock::time_point start, Clock::time_point end) {
+            TraceEvent event;
+            event.stage = stage;
+            event.fileIndex = file.index_;
+            event.thread = ThreadNumber();
+            event.beginUs = Nanoseconds(start - batchBegin_) / 1000;
+            event.durationUs = Nanoseconds(end - start) / 1000;
+            std::lock_guard<std::mutex> lock(mutex_);
+            events_.push_back(event);
+        }
+
+        BatchReport Collector::Report() const {
+            BatchReport report;
+            for (size_t i = 0; i < kGaugeCount; ++i) report.peaks[i] = peaks_[i].load();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            report.wallMs = Nanoseconds((batchEnd_ > batchBegin_ ? batchEnd_ : Clock::now()) - batchBegin_) / 1e6;
+            for (const auto& file : files_) {
+                report.files.push_back(file->Report());
+                report.totals.Add(report.files.back().stats);
+            }
+            return report;
+        }
+
+        void Collector::WriteJson(std::ostream& out) const {
+            BatchReport report = Report();
+            out << std::fixed << std::setprecision(3);
+            out << "{\n  \"wall_ms\": " << report.wallMs << ",\n  \"files\": " << report.files.size() << ",\n";
+            WriteStats(out, report.totals, "  ");
+            out << ",\n  \"peaks\": {";
+            for (size_t i = 0; i < kGaugeCount; ++i) {
+                out << (i ? ", " : "") << "\"" << GaugeName(static_cast<Gauge>(i)) << "\": " << report.peaks[i];
+            }
+            out << "},\n  \"per_file\": [";
+            for (size_t f = 0; f < report.files.size(); ++f) {
+                const FileReport& file = report.files[f];
+                out << (f ? "," : "") << "\n    {\n      \"file\": " << JsonString(file.file)
+                    << ",\n      \"ok\": " << (file.ok ? "true" : "false") << ",\n      \"wall_ms\": " << file.wallMs << ",\n";
+                WriteStats(out, file.stats, "      ");
+                out << "\n    }";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        void Collector::WriteChromeTrace(std::ostream& out) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+            for (size_t i = 0; i < events_.size(); ++i) {
+                const TraceEvent& e = events_[i];
+                out << (i ? "," : "") << "\n{\"name\": \"" << StageName(e.stage) << "\", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1"
+                    << ", \"tid\": " << e.thread << ", \"ts\": " << e.beginUs << ", \"dur\": " << e.durationUs
+                    << ", \"args\": {\"file\": " << JsonString(files_[e.fileIndex]->file_) << "}}";
+            }
+            out << "\n]}\n";
+        }
+
+    }
+
+}
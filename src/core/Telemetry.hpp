@@ -0,0 +1,222 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Core {
+
+    // Per-stage timers and counters, aggregated per file and per batch.
+    //
+    // Instrumented code (ScopedTimer, Count) reports to the file its thread is
+    // currently working on, set with a FileScope. Threads without one (every thread
+    // while collection is disabled) pay a single thread-local load per call site.
+    namespace Telemetry {
+
+        enum class Stage {
+            ResultCache, // Hashing the input, fetching and storing results
+            Decode,
+            PreProcess,
+            Inference,
+            Resample,    // Low-detail tiles upscaled without the model
+            Blend,       // Post-processing and merging tiles into the canvas
+            Sharpen,
+            Encode,      // Includes streamed band writes
+            Count
+        };
+
+        enum class Counter {
+            Tiles,          // Tiles run through the model
+            TilesFilled,    // Flat tiles filled with their colour instead
+            TilesReused,    // Tiles given the output of an identical, already inferred tile
+            TilesResampled, // Low-detail tiles upscaled and sharpened without the model
+            InferenceCalls,
+            BytesRead,
+            BytesWritten,
+            Allocations,    // Image and tile buffers allocated by the pipeline
+            AllocatedBytes,
+            BufferReuses,   // Scratch buffers served from the BufferPool instead
+            Count
+        };
+
+        // Batch-level high-water marks
+        enum class Gauge {
+            DecodeQueueDepth, // Decoded images waiting for inference (pipelined batches)
+            EncodeQueueDepth, // Finished images waiting for an encoder
+            TileQueueDepth,   // Images with tiles not yet claimed by an inference worker
+            Count
+        };
+
+        constexpr size_t kStageCount = static_cast<size_t>(Stage::Count);
+        constexpr size_t kCounterCount = static_cast<size_t>(Counter::Count);
+        constexpr size_t kGaugeCount = static_cast<size_t>(Gauge::Count);
+
+        const char* StageName(Stage stage);
+        const char* CounterName(Counter counter);
+        const char* GaugeName(Gauge gauge);
+
+        // Plain totals. Stage times are summed over threads, so with parallel stages
+        // they can exceed the wall time.
+        struct Stats {
+            std::array<double, kStageCount> stageMs{};
+            std::array<uint64_t, kStageCount> stageCalls{};
+            std::array<uint64_t, kCounterCount> counters{};
+
+            double StageMs(Stage stage) const { return stageMs[static_cast<size_t>(stage)]; }
+            uint64_t Value(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+            void Add(const Stats& other);
+
+            // Share of tiles whose inference was skipped (filled, reused or resampled)
+            double TileSkipRatio() const;
+        };
+
+        struct FileReport {
+            std::string file;
+            bool ok = false;
+            double wallMs = 0; // From the first to the last instrumented work on the file
+            Stats stats;
+        };
+
+        struct BatchReport {
+            double wallMs = 0;
+            Stats totals; // Sum over files
+            std::array<uint64_t, kGaugeCount> peaks{};
+            std::vector<FileReport> files;
+
+            uint64_t Peak(Gauge gauge) const { return peaks[static_cast<size_t>(gauge)]; }
+        };
+
+        class Collector;
+
+        // Live, thread-safe accumulator for one file
+        class FileStats {
+        public:
+            FileStats(Collector& collector, uint32_t index, std::string file);
+
+            void AddTime(Stage stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+            void Add(Counter counter, uint64_t n) { counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed); }
+            void Finish(bool ok);
+            void Touch(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+            Collector& Owner() const { return collector_; }
+            FileReport Report() const;
+
+        private:
+            Collector& collector_;
+            uint32_t index_; // Position in the batch, in order of AddFile
+            std::string file_;
+            // First and last instrumented work, in ns since the batch began
+            std::atomic<int64_t> firstNs_{INT64_MAX};
+            std::atomic<int64_t> lastNs_{0};
+            std::atomic<bool> ok_{false};
+            std::array<std::atomic<uint64_t>, kStageCount> stageNs_{};
+            std::array<std::atomic<uint64_t>, kStageCount> stageCalls_{};
+            std::array<std::atomic<uint64_t>, kCounterCount> counters_{};
+
+            friend class Collector;
+        };
+
+        // Owns the FileStats of a batch and, when tracing, every timed span as a
+        // Chrome trace event (load the file in chrome://tracing or Perfetto).
+        class Collector {
+        public:
+            explicit Collector(bool trace);
+
+            // Forget earlier files and events and restart the batch clock
+            void BeginBatch();
+            void EndBatch();
+
+            // Stats for a new file; stays valid until the next BeginBatch
+            FileStats* AddFile(const std::wstring& path);
+
+            void Peak(Gauge gauge, uint64_t value);
+
+            BatchReport Report() const;
+
+            void WriteJson(std::ostream& out) const;
+            void WriteChromeTrace(std::ostream& out) const;
+
+        private:
+            friend class FileStats;
+
+            struct TraceEvent {
+                Stage stage;
+                uint32_t fileIndex;
+                uint32_t thread;
+                int64_t beginUs;
+                int64_t durationUs;
+            };
+
+            bool trace_;
+            std::chrono::steady_clock::time_point batchBegin_;
+            std::chrono::steady_clock::time_point batchEnd_; // Before batchBegin_ while the batch runs
+            std::array<std::atomic<uint64_t>, kGaugeCount> peaks_{};
+
+            mutable std::mutex mutex_;
+            std::deque<std::unique_ptr<FileStats>> files_;
+            std::vector<TraceEvent> events_;
+
+            void AddEvent(const FileStats& file, Stage stage, std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::time_point end);
+        };
+
+        namespace detail {
+            inline thread_local FileStats* currentFile = nullptr;
+        }
+
+        inline FileStats* Current() { return detail::currentFile; }
+
+        // Attribute this thread's instrumented work to `file` (may be null) until destroyed
+        class FileScope {
+        public:
+            explicit FileScope(FileStats* file) : previous_(detail::currentFile) { detail::currentFile = file; }
+            ~FileScope() { detail::currentFile = previous_; }
+            FileScope(const FileScope&) = delete;
+            FileScope& operator=(const FileScope&) = delete;
+
+        private:
+            FileStats* previous_;
+        };
+
+        class ScopedTimer {
+        public:
+            explicit ScopedTimer(Stage stage) : file_(Current()), stage_(stage) {
+                if (file_) start_ = std::chrono::steady_clock::now();
+            }
+            ~ScopedTimer() {
+                if (file_) file_->AddTime(stage_, start_, std::chrono::steady_clock::now());
+            }
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        private:
+            FileStats* file_;
+            Stage stage_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        inline void Count(Counter counter, uint64_t n = 1) {
+            if (FileStats* file = Current()) file->Add(counter, n);
+        }
+
+        inline void CountAllocation(size_t bytes) {
+            if (FileStats* file = Current()) {
+                file->Add(Counter::Allocations, 1);
+                file->Add(Counter::AllocatedBytes, bytes);
+            }
+        }
+
+        inline void Peak(Gauge gauge, uint64_t value) {
+            if (FileStats* file = Current()) file->Owner().Peak(gauge, value);
+        }
+
+    }
+
+}
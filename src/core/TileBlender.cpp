@@ -0,0 +1,170 @@
+#include "TileBlender.hpp"
+#include "ImageUtils.hpp"
+#include "SimdKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace Core {
+
+    namespace {
+
+        constexpr int kLeadingRamp = 1;
+        constexpr int kTrailingRamp = 2;
+
+        std::vector<float> MakeRamp(int length, FeatherWindow window) {
+            // Strictly positive, so every output pixel keeps a non-zero total weight
+            std::vector<float> ramp(length);
+            for (int k = 0; k < length; ++k) {
+                double t = (k + 0.5) / length;
+                ramp[k] = static_cast<float>(window == FeatherWindow::Cosine ? 0.5 - 0.5 * std::cos(CV_PI * t) : t);
+            }
+            return ramp;
+        }
+
+        std::vector<float> MakeAxisWeights(int length, const std::vector<float>& ramp, int variant) {
+            int ov = static_cast<int>(ramp.size());
+            std::vector<float> w(length, 1.0f);
+            for (int u = 0; u < length; ++u) {
+                if ((variant & kLeadingRamp) && u < ov) w[u] *= ramp[u];
+                if ((variant & kTrailingRamp) && u >= length - ov) w[u] *= ramp[length - 1 - u];
+            }
+            return w;
+        }
+
+        int RampVariant(size_t index, size_t count) {
+            int variant = 0;
+            if (index > 0) variant |= kLeadingRamp;
+            if (index + 1 < count) variant |= kTrailingRamp;
+            return variant;
+        }
+
+        // Split each overlap at its midpoint so every output pixel has exactly one owner.
+        void OwnedRanges(const std::vector<int>& origins, int tileLength, int total,
+                         std::vector<int>& begin, std::vector<int>& end) {
+            size_t n = origins.size();
+            begin.assign(n, 0);
+            end.assign(n, total);
+            for (size_t i = 0; i + 1 < n; ++i) {
+                int boundary = (origins[i + 1] + origins[i] + tileLength) / 2;
+                end[i] = boundary;
+                begin[i + 1] = boundary;
+            }
+        }
+
+    }
+
+    TileLayout TileLayout::FromInput(const cv::Size& inputSize, int tileSize, int overlap, int scale) {
+        TileLayout layout;
+        for (int x : ImageUtils::TileOrigins(inputSize.width, tileSize, overlap)) layout.xs.push_back(x * scale);
+        for (int y : ImageUtils::TileOrigins(inputSize.height, tileSize, overlap)) layout.ys.push_back(y * scale);
+        layout.tileWidth = std::min(tileSize, inputSize.width) * scale;
+        layout.tileHeight = std::min(tileSize, inputSize.height) * scale;
+        layout.width = inputSize.width * scale;
+        layout.height = inputSize.height * scale;
+        layout.overlap = overlap * scale;
+        return layout;
+    }
+
+    std::shared_ptr<const FeatherWeights> FeatherWeights::Get(int tileWidth, int tileHeight, int overlap, FeatherWindow window) {
+        using Key = std::tuple<int, int, int, int>;
+        static std::mutex mutex;
+        static std::map<Key, std::shared_ptr<const FeatherWeights>> cache;
+
+        Key key(tileWidth, tileHeight, overlap, static_cast<int>(window));
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) return it->second;
+
+        auto weights = std::make_shared<FeatherWeights>();
+        std::vector<float> rampX = MakeRamp(std::min(overlap, tileWidth), window);
+        std::vector<float> rampY = MakeRamp(std::min(overlap, tileHeight), window);
+        for (int v = 0; v < 4; ++v) {
+            weights->x[v] = MakeAxisWeights(tileWidth, rampX, v);
+            weights->y[v] = MakeAxisWeights(tileHeight, rampY, v);
+        }
+        cache.emplace(key, weights);
+        return weights;
+    }
+
+    TileBlender::TileBlender(const TileLayout& layout, TileMergeMode mode, FeatherWindow window, BufferPool* pool)
+        : layout_(layout), mode_(mode) {
+        if (mode_ == TileMergeMode::CropToCenter) {
+            OwnedRanges(layout_.xs, layout_.tileWidth, layout_.width, ownX0_, ownX1_);
+            OwnedRanges(layout_.ys, layout_.tileHeight, layout_.height, ownY0_, ownY1_);
+        } else {
+            weights_ = FeatherWeights::Get(layout_.tileWidth, layout_.tileHeight, layout_.overlap, window);
+            planeSize_ = static_cast<size_t>(layout_.tileHeight) * layout_.width;
+            accumStorage_ = BufferPool::AcquireFrom(pool, 4 * planeSize_ * sizeof(float));
+            accum_ = static_cast<float*>(accumStorage_.get());
+            std::fill(accum_, accum_ + 4 * planeSize_, 0.0f);
+        }
+    }
+
+    int TileBlender::FinishedRowsAfter(int row) const {
+        if (row + 1 >= static_cast<int>(layout_.ys.size())) return layout_.height;
+        if (mode_ == TileMergeMode::CropToCenter) return ownY1_[row];
+        // The next tile row starts contributing at its origin
+        return layout_.ys[row + 1];
+    }
+
+    void TileBlender::AddTile(int col, int row, const float* data, cv::Mat dst, int dstTop) {
+        int tileW = layout_.tileWidth;
+        int tileH = layout_.tileHeight;
+        int x0 = layout_.xs[col];
+        int y0 = layout_.ys[row];
+
+        if (mode_ == TileMergeMode::CropToCenter) {
+            cv::Rect owned(ownX0_[col], ownY0_[row], ownX1_[col] - ownX0_[col], ownY1_[row] - ownY0_[row]);
+            cv::Rect local(owned.x - x0, owned.y - y0, owned.width, owned.height);
+            ImageUtils::PostProcessInto(data, tileH, tileW, local,
+                                        dst(cv::Rect(owned.x, owned.y - dstTop, owned.width, owned.height)));
+            return;
+        }
+
+        const std::vector<float>& wx = weights_->x[RampVariant(col, layout_.xs.size())];
+        const std::vector<float>& wy = weights_->y[RampVariant(row, layout_.ys.size())];
+        size_t tilePlane = static_cast<size_t>(tileW) * tileH;
+        float* weightPlane = accum_ + 3 * planeSize_;
+
+        for (int ty = 0; ty < tileH; ++ty) {
+            size_t accOffset = static_cast<size_t>(y0 + ty - finished_) * layout_.width + x0;
+            for (int c = 0; c < 3; ++c) {
+                Simd::MultiplyAccumulate(data + c * tilePlane + static_cast<size_t>(ty) * tileW, wx.data(), wy[ty],
+                                         accum_ + c * planeSize_ + accOffset, tileW);
+            }
+            Simd::AccumulateScaled(wx.data(), wy[ty], weightPlane + accOffset, tileW);
+        }
+    }
+
+    void TileBlender::FinishTileRow(int row, cv::Mat dst, int dstTop) {
+        int end = FinishedRowsAfter(row);
+        if (mode_ == TileMergeMode::CropToCenter) {
+            finished_ = end; // Tiles already wrote their owned pixels
+            return;
+        }
+
+        int rows = end - finished_;
+        int width = layout_.width;
+        size_t count = static_cast<size_t>(rows) * width;
+        const float* weightPlane = accum_ + 3 * planeSize_;
+        for (int c = 0; c < 3; ++c) {
+            Simd::DivideInPlace(accum_ + c * planeSize_, weightPlane, static_cast<int>(count));
+        }
+        Simd::PlanarRgbToBgr(accum_, planeSize_, width, width, rows,
+                             dst.ptr<uint8_t>(finished_ - dstTop), dst.step[0]);
+
+        // Slide the window: partially accumulated rows move to the top
+        size_t keep = planeSize_ - count;
+        for (int p = 0; p < 4; ++p) {
+            float* plane = accum_ + p * planeSize_;
+            std::memmove(plane, plane + count, keep * sizeof(float));
+            std::fill(plane + keep, plane + planeSize_, 0.0f);
+        }
+        finished_ = end;
+    }
+
+}
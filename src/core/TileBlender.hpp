@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+#include "BufferPool.hpp"
+
+namespace Core {
+
+    enum class TileMergeMode {
+        Feather,      // Weighted average across overlaps (best quality)
+        CropToCenter  // Each output pixel comes from one tile; overlap margins are discarded (fastest)
+    };
+
+    enum class FeatherWindow {
+        Linear,
+        Cosine
+    };
+
+    // Output-space tile grid: tile origins along each axis and the (uniform) tile size.
+    struct TileLayout {
+        std::vector<int> xs;
+        std::vector<int> ys;
+        int tileWidth = 0;
+        int tileHeight = 0;
+        int width = 0;   // Output image size
+        int height = 0;
+        int overlap = 0; // Nominal overlap between neighbouring tiles
+
+        // Scale an input-space tile grid (see ImageUtils::TileOrigins) to output space.
+        static TileLayout FromInput(const cv::Size& inputSize, int tileSize, int overlap, int scale);
+    };
+
+    // Per-axis feather weights for one (tile size, overlap, window) configuration.
+    // Four variants per axis: ramp on the leading edge, on the trailing edge, on both, or none.
+    struct FeatherWeights {
+        std::vector<float> x[4];
+        std::vector<float> y[4];
+
+        static std::shared_ptr<const FeatherWeights> Get(int tileWidth, int tileHeight, int overlap, FeatherWindow window);
+    };
+
+    // Merges tile outputs (CHW float, as produced by the model) into 8-bit BGR rows.
+    // Tiles must be added one tile row at a time, top to bottom. After each tile row,
+    // FinishTileRow writes out every output row that later tiles no longer touch, so
+    // only one tile row of accumulators is kept regardless of the image height.
+    class TileBlender {
+    public:
+        // The feather accumulators are drawn from `pool` when one is given
+        TileBlender(const TileLayout& layout, TileMergeMode mode, FeatherWindow window = FeatherWindow::Linear,
+                    BufferPool* pool = nullptr);
+
+        // First output row not yet written; rows before it are final.
+        int FinishedRows() const { return finished_; }
+
+        // Rows that will be final after tile row `row` has been finished.
+        int FinishedRowsAfter(int row) const;
+
+        // Add the output of tile (col, row). `dst` holds output rows [dstTop, dstTop + dst.rows)
+        // and must cover [FinishedRows(), FinishedRowsAfter(row)).
+        void AddTile(int col, int row, const float* data, cv::Mat dst, int dstTop);
+
+        // Complete tile row `row`: write rows [FinishedRows(), FinishedRowsAfter(row)) to `dst`.
+        void FinishTileRow(int row, cv::Mat dst, int dstTop);
+
+    private:
+        TileLayout layout_;
+        TileMergeMode mode_;
+        int finished_ = 0;
+
+        // CropToCenter: owned output range of each tile along each axis
+        std::vector<int> ownX0_, ownX1_, ownY0_, ownY1_;
+
+        // Feather: planar R, G, B and weight accumulators for output rows
+        // [finished_, finished_ + tileHeight)
+        std::shared_ptr<const FeatherWeights> weights_;
+        std::shared_ptr<void> accumStorage_;
+        float* accum_ = nullptr;
+        size_t planeSize_ = 0;
+    };
+
+}
@@ -0,0 +1,501 @@
+#include "TileScheduler.hpp"
+#include "Hash.hpp"
+#include "ImageUtils.hpp"
+#include "UnsharpMask.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Core {
+
+    namespace {
+
+        bool SamePixels(const cv::Mat& a, const cv::Mat& b) {
+            if (a.size() != b.size() || a.type() != b.type()) return false;
+            size_t rowBytes = a.cols * a.elemSize();
+            for (int y = 0; y < a.rows; ++y) {
+                if (std::memcmp(a.ptr(y), b.ptr(y), rowBytes) != 0) return false;
+            }
+            return true;
+        }
+
+        // True if no channel of the BGR `tile` varies by more than `tolerance`; `fill`
+        // then gets the mean of each channel as the model would output it (RGB, [0, 1])
+        bool IsFlat(const cv::Mat& tile, int tolerance, float fill[3]) {
+            int lo[3] = {255, 255, 255};
+            int hi[3] = {0, 0, 0};
+            uint64_t sum[3] = {};
+            for (int y = 0; y < tile.rows; ++y) {
+                const uint8_t* p = tile.ptr<uint8_t>(y);
+                for (int x = 0; x < tile.cols; ++x, p += 3) {
+                    for (int c = 0; c < 3; ++c) {
+                        lo[c] = std::min<int>(lo[c], p[c]);
+                        hi[c] = std::max<int>(hi[c], p[c]);
+                        sum[c] += p[c];
+                    }
+                }
+                // Checked per row, so busy tiles are given up on early
+                for (int c = 0; c < 3; ++c) {
+                    if (hi[c] - lo[c] > tolerance) return false;
+                }
+            }
+            double pixels = static_cast<double>(tile.rows) * tile.cols;
+            for (int c = 0; c < 3; ++c) {
+                // Same arithmetic as pre-processing, so a single-colour tile fills with exactly its value
+                fill[2 - c] = static_cast<float>(sum[c] / pixels) * (1.0f / 255.0f);
+            }
+            return true;
+        }
+
+    }
+
+    double TileDetail(const cv::Mat& tile) {
+        if (tile.rows < 2 || tile.cols < 2) return 0;
+        // Luma times 4 (B + 2G + R), one row at a time
+        std::vector<int> above(tile.cols);
+        std::vector<int> row(tile.cols);
+        auto luma = [&](int y, std::vector<int>& out) {
+            const uint8_t* p = tile.ptr<uint8_t>(y);
+            for (int x = 0; x < tile.cols; ++x, p += 3) out[x] = p[0] + 2 * p[1] + p[2];
+        };
+        luma(0, above);
+        uint64_t energy = 0;
+        for (int y = 1; y < tile.rows; ++y) {
+            luma(y, row);
+            for (int x = 1; x < tile.cols; ++x) {
+                int dx = row[x] - row[x - 1];
+                int dy = row[x] - above[x];
+                energy += static_cast<uint64_t>(dx * dx + dy * dy);
+            }
+            std::swap(above, row);
+        }
+        return energy / (16.0 * (tile.rows - 1) * (tile.cols - 1));
+    }
+
+    bool TileOutputCache::MakeRoom(size_t bytes, std::shared_ptr<Entry>* recycled) {
+        if (reserved_ + bytes > maxBytes_) return false;
+        while (bytes_ + reserved_ + bytes > maxBytes_) {
+            std::shared_ptr<Entry>& oldest = lru_.back().second;
+            bytes_ -= Bytes(*oldest);
+            // Recycle the buffers of an entry no job holds any more
+            if (recycled && !*recycled && oldest.use_count() == 1) *recycled = std::move(oldest);
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+        return true;
+    }
+
+    bool TileOutputCache::Reserve(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!MakeRoom(bytes, nullptr)) return false;
+        reserved_ += bytes;
+        return true;
+    }
+
+    void TileOutputCache::Release(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reserved_ -= bytes;
+    }
+
+    uint64_t TileOutputCache::TileHash(const cv::Mat& tile) {
+        uint64_t hash = (static_cast<uint64_t>(tile.cols) << 32) | static_cast<uint32_t>(tile.rows);
+        size_t rowBytes = tile.cols * tile.elemSize();
+        for (int y = 0; y < tile.rows; ++y) hash = Hash::Bytes(tile.ptr(y), rowBytes, hash);
+        return hash;
+    }
+
+    size_t TileOutputCache::Bytes(const Entry& entry) {
+        return entry.input.total() * entry.input.elemSize() + entry.output.size() * sizeof(float);
+    }
+
+    std::shared_ptr<const TileOutputCache::Entry> TileOutputCache::Find(uint64_t hash, const cv::Mat& tile, int scale) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(hash);
+        if (it == index_.end()) return nullptr;
+        const Entry& entry = *it->second->second;
+        if (entry.scale != scale || !SamePixels(entry.input, tile)) return nullptr;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    std::shared_ptr<const TileOutputCache::Entry> TileOutputCache::Insert(uint64_t hash, const cv::Mat& tile, int scale,
+                                                                          const float* output, size_t size, bool needed) {
+        auto fillEntry = [&](Entry& entry) {
+            tile.copyTo(entry.input);
+            entry.scale = scale;
+            entry.output.assign(output, output + size);
+        };
+
+        size_t bytes = tile.total() * tile.elemSize() + size * sizeof(float);
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = index_.find(hash);
+        if (it != index_.end()) {
+            // Same pixels (or a collision, which the newer tile replaces)
+            bytes_ -= Bytes(*it->second->second);
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        std::shared_ptr<Entry> entry;
+        if (!MakeRoom(bytes, &entry)) {
+            // Kept outputs are paid for by the job's reservation
+            lock.unlock();
+            if (!needed) return nullptr;
+            entry = std::make_shared<Entry>();
+            fillEntry(*entry);
+            return entry;
+        }
+        if (!entry) entry = std::make_shared<Entry>();
+        // Filled under the lock: other jobs can find the entry as soon as it is indexed
+        fillEntry(*entry);
+        lru_.emplace_front(hash, entry);
+        index_[hash] = lru_.begin();
+        bytes_ += bytes;
+        return entry;
+    }
+
+    bool TileJob::Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]() { return consumed_ == batchCount_; });
+        return !failed_;
+    }
+
+    bool TileJob::Failed() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return failed_;
+    }
+
+    void TileJob::Complete(size_t batch, bool ok, std::vector<float>* output) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (consumed_ != batch) {
+            if (parked_.size() < maxParked_) {
+                // The worker moves on to other batches; whoever holds the turn merges this one
+                ParkedBatch& parked = parked_[batch];
+                parked.ok = ok;
+                if (output) {
+                    parked.output.swap(*output);
+                    if (!spare_.empty()) {
+                        output->swap(spare_.back());
+                        spare_.pop_back();
+                    }
+                }
+                return;
+            }
+            cv_.wait(lock, [&]() { return consumed_ == batch; });
+        }
+
+        // Holding the turn: consume this batch, then the parked ones right after it
+        std::vector<float> parkedOutput;
+        const float* data = output ? output->data() : nullptr;
+        for (;;) {
+            ok = ok && !failed_;
+            lock.unlock();
+            ok = Consume(batch, ok, data);
+            lock.lock();
+            if (!ok) failed_ = true;
+            ++consumed_;
+            if (!parkedOutput.empty()) spare_.push_back(std::move(parkedOutput));
+
+            auto next = parked_.find(consumed_);
+            if (next == parked_.end()) break;
+            batch = next->first;
+            ok = next->second.ok;
+            parkedOutput = std::move(next->second.output);
+            parked_.erase(next);
+            data = parkedOutput.empty() ? nullptr : parkedOutput.data();
+        }
+        if (consumed_ == batchCount_) spare_.clear();
+        cv_.notify_all();
+    }
+
+    bool TileJob::Consume(size_t batch, bool ok, const float* output) {
+        // The last batch also hands over the skipped tiles after its own
+        if (ok) {
+            size_t end = batch + 1 == batchCount_ ? tiles_.size() : worked_[batches_[batch].second - 1] + 1;
+            try {
+                ok = Deliver(end, output);
+            } catch (const std::exception& e) {
+                std::cerr << "Tile merge failed: " << e.what() << std::endl;
+                ok = false;
+            }
+        }
+        // Drop the consumer's state (e.g. its blender) and kept outputs before Wait() returns
+        if (batch + 1 == batchCount_) {
+            consumer_ = nullptr;
+            kept_.clear();
+            if (reservedBytes_ > 0) cache_->Release(reservedBytes_);
+            reservedBytes_ = 0;
+            plan_.clear();
+            std::vector<float>().swap(fillBuffer_);
+        }
+        return ok;
+    }
+
+    bool TileJob::Deliver(size_t end, const float* output) {
+        while (delivered_ < end) {
+            size_t tile = delivered_;
+            if (!FromWorker(plan_[tile].origin)) {
+                if (!consumer_(tile, 1, SkippedOutput(tile), outTileSize_)) return false;
+                TilePlan& plan = plan_[tile];
+                plan.cached = nullptr;
+                if (plan.origin == Origin::Reuse && plan_[plan.source].lastUse == tile) kept_.erase(plan.source);
+                delivered_++;
+                continue;
+            }
+
+            // A run of worker outputs goes over in one call
+            size_t count = 1;
+            while (tile + count < end && FromWorker(plan_[tile + count].origin)) count++;
+            if (!consumer_(tile, count, output, outTileSize_)) return false;
+            if (cache_) {
+                for (size_t k = 0; k < count; ++k) {
+                    TilePlan& plan = plan_[tile + k];
+                    if (plan.origin != Origin::Infer) continue;
+                    auto entry = cache_->Insert(plan.hash, input_(tiles_[tile + k]), scale_, output + k * outTileSize_,
+                                                outTileSize_, plan.lastUse != 0);
+                    if (plan.lastUse != 0) kept_[tile + k] = std::move(entry);
+                }
+            }
+            output += count * outTileSize_;
+            delivered_ += count;
+        }
+        return true;
+    }
+
+    const float* TileJob::SkippedOutput(size_t tile) {
+        const TilePlan& plan = plan_[tile];
+        if (plan.origin == Origin::Reuse) {
+            return plan.cached ? plan.cached->output.data() : kept_.at(plan.source)->output.data();
+        }
+        // Fill: one plane per channel
+        size_t plane = outTileSize_ / 3;
+        bool same = fillBuffer_.size() == outTileSize_;
+        for (int c = 0; c < 3 && same; ++c) same = fillBuffer_[c * plane] == plan.fill[c];
+        if (!same) {
+            fillBuffer_.resize(outTileSize_);
+            for (int c = 0; c < 3; ++c) std::fill_n(fillBuffer_.begin() + c * plane, plane, plan.fill[c]);
+        }
+        return fillBuffer_.data();
+    }
+
+    TileScheduler::TileScheduler(std::vector<std::unique_ptr<InferenceSession>> sessions, size_t tileBatchSize,
+                                 const TileSkipOptions& skip, BufferPool* pool)
+        : tileBatchSize_(std::max<size_t>(1, tileBatchSize)), skip_(skip), pool_(pool) {
+        if (skip_.reuseBytes > 0) cache_ = std::make_shared<TileOutputCache>(skip_.reuseBytes);
+        for (auto& session : sessions) {
+            auto worker = std::make_unique<Worker>();
+            worker->session = std::move(session);
+            workers_.push_back(std::move(worker));
+        }
+        for (auto& worker : workers_) {
+            Worker* w = worker.get();
+            w->thread = std::thread([this, w]() { WorkerLoop(*w); });
+        }
+    }
+
+    TileScheduler::~TileScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) worker->thread.join();
+    }
+
+    std::shared_ptr<TileJob> TileScheduler::Submit(const cv::Mat& input, std::vector<cv::Rect> tiles, int scale, TileConsumer consumer) {
+        auto job = std::make_shared<TileJob>();
+        job->input_ = input;
+        job->tiles_ = std::move(tiles);
+        job->scale_ = scale;
+        job->consumer_ = std::move(consumer);
+        job->cache_ = cache_;
+        job->stats_ = Telemetry::Current();
+        if (job->tiles_.empty()) return job;
+
+        const cv::Rect& first = job->tiles_[0];
+        job->outTileSize_ = static_cast<size_t>(3) * first.height * scale * first.width * scale;
+        Plan(*job);
+        // Batches never mix inferred and resampled tiles. A job whose every tile is
+        // filled or reused still takes one (empty) batch to hand them over.
+        const std::vector<size_t>& worked = job->worked_;
+        for (size_t begin = 0; begin < worked.size();) {
+            TileJob::Origin origin = job->plan_[worked[begin]].origin;
+            size_t end = begin + 1;
+            while (end < worked.size() && end - begin < tileBatchSize_ && job->plan_[worked[end]].origin == origin) end++;
+            job->batches_.emplace_back(begin, end);
+            begin = end;
+        }
+        job->batchCount_ = std::max<size_t>(1, job->batches_.size());
+        job->maxParked_ = std::max<size_t>(1, workers_.size());
+
+        size_t depth = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.push_back(job);
+            depth = pending_.size();
+        }
+        Telemetry::Peak(Telemetry::Gauge::TileQueueDepth, depth);
+        cv_.notify_all();
+        return job;
+    }
+
+    void TileScheduler::WorkerLoop(Worker& worker) {
+        for (;;) {
+            std::shared_ptr<TileJob> job;
+            size_t batch = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&]() { return stopping_ || !pending_.empty(); });
+                if (pending_.empty()) return;
+
+                job = pending_.front();
+                batch = job->nextBatch_++;
+                if (job->nextBatch_ == job->batchCount_) pending_.pop_front();
+            }
+
+            // Batches of a failed job are skipped, but still take their turn so Wait() returns
+            Telemetry::FileScope scope(job->stats_);
+            bool ok = false;
+            std::vector<float>* output = nullptr;
+            if (!job->Failed()) {
+                try {
+                    ok = RunBatch(worker, *job, batch, output);
+                } catch (const std::exception& e) {
+                    std::cerr << "Tile inference failed: " << e.what() << std::endl;
+                }
+            }
+            job->Complete(batch, ok, output);
+        }
+    }
+
+    void TileScheduler::Plan(TileJob& job) const {
+        size_t tileCount = job.tiles_.size();
+        job.plan_.resize(tileCount);
+        job.worked_.reserve(tileCount);
+        std::unordered_map<uint64_t, size_t> firstSeen; // Hash -> first inferred tile with it
+        size_t outBytes = job.outTileSize_ * sizeof(float);
+        uint64_t filled = 0;
+        uint64_t reused = 0;
+        uint64_t resampled = 0;
+
+        for (size_t t = 0; t < tileCount; ++t) {
+            TileJob::TilePlan& plan = job.plan_[t];
+            cv::Mat pixels = job.input_(job.tiles_[t]);
+            if (skip_.flatTolerance >= 0 && IsFlat(pixels, skip_.flatTolerance, plan.fill)) {
+                plan.origin = TileJob::Origin::Fill;
+                filled++;
+                continue;
+            }
+            bool firstOfHash = false;
+            if (cache_) {
+                plan.hash = TileOutputCache::TileHash(pixels);
+                auto seen = firstSeen.find(plan.hash);
+                if (seen != firstSeen.end()) {
+                    // Reusing an output of this job keeps it in memory until its last use
+                    TileJob::TilePlan& source = job.plan_[seen->second];
+                    bool same = SamePixels(pixels, job.input_(job.tiles_[seen->second]));
+                    if (same && source.lastUse == 0 && cache_->Reserve(outBytes)) {
+                        job.reservedBytes_ += outBytes;
+                        source.lastUse = t;
+                    }
+                    if (same && source.lastUse != 0) {
+                        source.lastUse = t;
+                        plan.origin = TileJob::Origin::Reuse;
+                        plan.source = seen->second;
+                        reused++;
+                        continue;
+                    }
+                } else if ((plan.cached = cache_->Find(plan.hash, pixels, job.scale_))) {
+                    plan.origin = TileJob::Origin::Reuse;
+                    reused++;
+                    continue;
+                } else {
+                    firstOfHash = true;
+                }
+            }
+            // Low-detail tiles only take the cheap path if no model output can be reused
+            if (skip_.detailThreshold > 0 && TileDetail(pixels) < skip_.detailThreshold) {
+                plan.origin = TileJob::Origin::Resample;
+                resampled++;
+            } else if (firstOfHash) {
+                firstSeen.emplace(plan.hash, t);
+            }
+            job.worked_.push_back(t);
+        }
+        Telemetry::Count(Telemetry::Counter::TilesFilled, filled);
+        Telemetry::Count(Telemetry::Counter::TilesReused, reused);
+        Telemetry::Count(Telemetry::Counter::TilesResampled, resampled);
+    }
+
+    bool TileScheduler::RunBatch(Worker& worker, const TileJob& job, size_t batch, std::vector<float>*& output) {
+        if (job.batches_.empty()) return true;
+        size_t first = job.batches_[batch].first;
+        size_t count = job.batches_[batch].second - first;
+        if (job.plan_[job.worked_[first]].origin == TileJob::Origin::Resample) {
+            ResampleBatch(worker, job, first, count);
+            output = &worker.resampled;
+            return true;
+        }
+        int tileH = job.tiles_[0].height;
+        int tileW = job.tiles_[0].width;
+
+        int outTileH = tileH * job.scale_;
+        int outTileW = tileW * job.scale_;
+        size_t inTileSize = static_cast<size_t>(3) * tileH * tileW;
+        size_t outTileSize = job.outTileSize_;
+
+        // Buffers only grow, so their addresses (and the session's bindings)
+        // stay stable once the first batch has been seen.
+        if (worker.input.size() < count * inTileSize) {
+            worker.input.resize(count * inTileSize);
+            Telemetry::CountAllocation(worker.input.size() * sizeof(float));
+        }
+        if (worker.output.size() < count * outTileSize) {
+            worker.output.resize(count * outTileSize);
+            Telemetry::CountAllocation(worker.output.size() * sizeof(float));
+        }
+        Telemetry::Count(Telemetry::Counter::Tiles, count);
+
+        // Pre-process tiles into one contiguous batch
+        {
+            Telemetry::ScopedTimer timer(Telemetry::Stage::PreProcess);
+            for (size_t k = 0; k < count; ++k) {
+                ImageUtils::PreProcessInto(job.input_(job.tiles_[job.worked_[first + k]]), worker.input.data() + k * inTileSize);
+            }
+        }
+
+        // Run Inference
+        // Output dims should be [N, 3, H*scale, W*scale]
+        worker.inputDims[0] = static_cast<int64_t>(count);
+        worker.inputDims[2] = tileH;
+        worker.inputDims[3] = tileW;
+        worker.outputDims[0] = static_cast<int64_t>(count);
+        worker.outputDims[2] = outTileH;
+        worker.outputDims[3] = outTileW;
+        if (!worker.session->RunInto(worker.input.data(), worker.inputDims, worker.output.data(), worker.outputDims)) {
+            std::cerr << "Inference failed for tile batch." << std::endl;
+            return false;
+        }
+        output = &worker.output;
+        return true;
+    }
+
+    void TileScheduler::ResampleBatch(Worker& worker, const TileJob& job, size_t begin, size_t count) {
+        Telemetry::ScopedTimer timer(Telemetry::Stage::Resample);
+        if (worker.resampled.size() < count * job.outTileSize_) {
+            worker.resampled.resize(count * job.outTileSize_);
+            Telemetry::CountAllocation(worker.resampled.size() * sizeof(float));
+        }
+        // Bicubic upscale (and optional unsharp mask), converted like a model output
+        for (size_t k = 0; k < count; ++k) {
+            const cv::Rect& rect = job.tiles_[job.worked_[begin + k]];
+            cv::resize(job.input_(rect), worker.upscaled, cv::Size(rect.width * job.scale_, rect.height * job.scale_), 0, 0,
+                       cv::INTER_CUBIC);
+            if (skip_.resampleSharpen > 0) {
+                UnsharpMask(worker.upscaled.cols, worker.upscaled.rows, UnsharpMask::kDefaultSigma, skip_.resampleSharpen, pool_)
+                    .Advance(worker.upscaled, 0, worker.upscaled.rows);
+            }
+            ImageUtils::PreProcessInto(worker.upscaled, worker.resampled.data() + k * job.outTileSize_);
+        }
+    }
+
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "BufferPool.hpp"
+#include "InferenceSession.hpp"
+#include "Telemetry.hpp"
+
+namespace Core {
+
+    // Receives the model output for tiles [first, first + count) of a job:
+    // `count` consecutive CHW tiles of outTileSize floats each.
+    // Returning false fails the job.
+    using TileConsumer = std::function<bool(size_t first, size_t count, const float* output, size_t outTileSize)>;
+
+    // Tiles whose output is known without running the model
+    struct TileSkipOptions {
+        // Model outputs kept so that identical input tiles (of the same image, or of
+        // images submitted since) reuse them instead of being inferred; 0 disables reuse.
+        // One budget covers both the outputs kept for later images and those a job
+        // holds for its own repeated tiles.
+        size_t reuseBytes = 0;
+        // Tiles whose channels each vary by at most this much (0-255) are filled with
+        // their mean colour; -1 disables filling, 0 fills only single-colour tiles
+        int flatTolerance = -1;
+        // Tiles whose detail (TileDetail) is below this are upscaled with bicubic
+        // interpolation instead of being inferred; 0 disables it
+        double detailThreshold = 0;
+        double resampleSharpen = 0; // Unsharp mask amount for those tiles; 0 leaves them unsharpened
+    };
+
+    // Detail of a BGR tile: mean squared luma gradient, (dx^2 + dy^2) per pixel in 8-bit
+    // levels. Smooth gradients and soft backgrounds score a few units, text and texture hundreds.
+    double TileDetail(const cv::Mat& tile);
+
+    // Model outputs of recently inferred tiles, looked up by the tile's pixels.
+    // Least recently used outputs are dropped beyond the byte budget, which also
+    // covers the reservations of running jobs.
+    class TileOutputCache {
+    public:
+        struct Entry {
+            cv::Mat input; // The tile's pixels: a hash match is only used if they are equal
+            int scale = 1;
+            std::vector<float> output;
+        };
+
+        explicit TileOutputCache(size_t maxBytes) : maxBytes_(maxBytes) {}
+
+        // Output for `tile` (whose TileHash is `hash`) at `scale`, or null
+        std::shared_ptr<const Entry> Find(uint64_t hash, const cv::Mat& tile, int scale);
+
+        // Store a copy of `output` for `tile`. An output larger than the whole budget is not
+        // stored, and only copied (unindexed) if `needed`; otherwise null is returned.
+        std::shared_ptr<const Entry> Insert(uint64_t hash, const cv::Mat& tile, int scale, const float* output, size_t size,
+                                            bool needed);
+
+        // Set aside `bytes` of the budget (evicting cached outputs as needed) for outputs a
+        // job keeps itself; false if the budget cannot hold them
+        bool Reserve(size_t bytes);
+        void Release(size_t bytes);
+
+        // Hash of a tile's size and pixels
+        static uint64_t TileHash(const cv::Mat& tile);
+
+    private:
+        using Lru = std::list<std::pair<uint64_t, std::shared_ptr<Entry>>>; // Most recently used first
+
+        size_t maxBytes_;
+        size_t bytes_ = 0;    // Cached entries
+        size_t reserved_ = 0; // Held by jobs
+        std::mutex mutex_;
+        Lru lru_;
+        std::unordered_map<uint64_t, Lru::iterator> index_;
+
+        static size_t Bytes(const Entry& entry);
+
+        // Drop least recently used entries until `bytes` more fit; false if they never will
+        bool MakeRoom(size_t bytes, std::shared_ptr<Entry>* recycled);
+    };
+
+    // The tiles of one image, as queued on a TileScheduler.
+    class TileJob {
+    public:
+        // Block until every tile batch has been consumed. False if any batch failed.
+        bool Wait();
+
+    private:
+        friend class TileScheduler;
+
+        enum class Origin : uint8_t { Infer, Fill, Reuse, Resample };
+
+        // How one tile's output is produced, decided when the job is submitted
+        struct TilePlan {
+            Origin origin = Origin::Infer;
+            uint64_t hash = 0;     // TileHash, if outputs are reused
+            float fill[3] = {};    // Fill: the output value of each (RGB) channel
+            size_t source = 0;     // Reuse: earlier inferred tile of this job with the same pixels...
+            std::shared_ptr<const TileOutputCache::Entry> cached; // ...or the output of an earlier job
+            size_t lastUse = 0;    // Infer: last tile reusing this output (0 if none)
+        };
+
+        static bool FromWorker(Origin origin) { return origin == Origin::Infer || origin == Origin::Resample; }
+
+        cv::Mat input_;
+        std::vector<cv::Rect> tiles_;
+        int scale_ = 1;
+        TileConsumer consumer_;
+        std::vector<TilePlan> plan_;
+        std::vector<size_t> worked_; // Tiles inferred or resampled by the workers, in tile order
+        std::vector<std::pair<size_t, size_t>> batches_; // Slices [begin, end) of worked_, each of one origin
+        size_t outTileSize_ = 0;
+        std::shared_ptr<TileOutputCache> cache_; // Null unless outputs are reused
+        size_t reservedBytes_ = 0; // Of cache_'s budget, for kept_
+        size_t batchCount_ = 0;
+        size_t nextBatch_ = 0; // Next batch to claim (guarded by the scheduler's mutex)
+        Telemetry::FileStats* stats_ = nullptr; // Submitting thread's file, for the workers' timers
+
+        // Outputs of a batch finished before its turn
+        struct ParkedBatch {
+            bool ok = false;
+            std::vector<float> output;
+        };
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        size_t consumed_ = 0;  // Batches handed to the consumer; also whose turn it is
+        bool failed_ = false;
+        std::unordered_map<size_t, ParkedBatch> parked_; // Merged by the worker holding the turn
+        std::vector<std::vector<float>> spare_;         // Buffers of merged parked batches, for parking workers
+        size_t maxParked_ = 1; // Past this many parked batches, a finished worker waits for its turn
+
+        // Only touched by the worker holding the turn
+        size_t delivered_ = 0; // Tiles handed to the consumer
+        std::unordered_map<size_t, std::shared_ptr<const TileOutputCache::Entry>> kept_; // Outputs reused later in this job
+        std::vector<float> fillBuffer_;
+
+        bool Failed();
+
+        // Hand in batch `batch`, whose outputs are in `output` (null if it has none). On its
+        // turn it is consumed (if ok), along with any parked batches that follow. Otherwise
+        // the outputs are parked (swapping `output` for a spare buffer) and the worker returns
+        // at once, unless maxParked_ batches are parked already; then it waits for its turn.
+        void Complete(size_t batch, bool ok, std::vector<float>* output);
+
+        // Consume one batch on its turn (unlocked). Skipped tiles are handed over in
+        // between, so the consumer still sees every tile in order.
+        bool Consume(size_t batch, bool ok, const float* output);
+
+        // Hand tiles [delivered_, end) to the consumer; `output` holds the worker outputs of
+        // the inferred or resampled ones among them
+        bool Deliver(size_t end, const float* output);
+        const float* SkippedOutput(size_t tile);
+    };
+
+    // Runs tile inference on a pool of worker threads, each with its own
+    // InferenceSession and bound tile buffers.
+    // Workers always take the next batch of the oldest job that still has unclaimed
+    // batches, so once one image runs out of tiles, idle workers start on the next
+    // submitted image instead of waiting for the last tiles to finish.
+    // Outputs are still handed to each job's consumer strictly in tile order, one
+    // batch at a time, so consumers need no locking of their own. A batch finished
+    // ahead of its turn is parked on the job and merged by whichever worker holds the
+    // turn, so the worker that ran it goes straight on to the next batch.
+    // Tiles that can be skipped (see TileSkipOptions) are sorted out on submission.
+    // Filled and reused tiles never reach a worker; their outputs are made when their
+    // turn comes, so they meet their neighbours in the blender's overlaps. Resampled
+    // tiles are batched separately from inferred ones and upscaled by the workers.
+    class TileScheduler {
+    public:
+        // One worker thread per session. Sessions must already be loaded.
+        // `pool` (optional) recycles the sharpening buffers of resampled tiles.
+        TileScheduler(std::vector<std::unique_ptr<InferenceSession>> sessions, size_t tileBatchSize,
+                      const TileSkipOptions& skip = TileSkipOptions(), BufferPool* pool = nullptr);
+        ~TileScheduler();
+
+        size_t WorkerCount() const { return workers_.size(); }
+
+        // Queue the tiles of `input` (all of one size) and return immediately.
+        // `input` must stay unmodified until the job completes; the consumer runs on worker threads.
+        std::shared_ptr<TileJob> Submit(const cv::Mat& input, std::vector<cv::Rect> tiles, int scale, TileConsumer consumer);
+
+    private:
+        struct Worker {
+            std::unique_ptr<InferenceSession> session;
+            // Tile tensors reused across batches and images (rebound by the session only
+            // when an output buffer was swapped for a spare while parking a batch)
+            std::vector<float> input;
+            std::vector<float> output;
+            std::vector<int64_t> inputDims = {0, 3, 0, 0};
+            std::vector<int64_t> outputDims = {0, 3, 0, 0};
+            // Resampled tiles, upscaled and converted outside the session's bindings
+            cv::Mat upscaled;
+            std::vector<float> resampled;
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        size_t tileBatchSize_;
+        TileSkipOptions skip_;
+        BufferPool* pool_;
+        std::shared_ptr<TileOutputCache> cache_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::shared_ptr<TileJob>> pending_; // Jobs with unclaimed batches, oldest first
+        bool stopping_ = false;
+
+        void WorkerLoop(Worker& worker);
+
+        // Decide the origin of every tile of a new job
+        void Plan(TileJob& job) const;
+
+        // Pre-process and infer one batch into worker.output, or resample it into
+        // worker.resampled; `output` is set to the buffer holding the batch's outputs
+        bool RunBatch(Worker& worker, const TileJob& job, size_t batch, std::vector<float>*& output);
+        void ResampleBatch(Worker& worker, const TileJob& job, size_t begin, size_t count);
+    };
+
+}
@@ -0,0 +1,106 @@
+#include "UnsharpMask.hpp"
+#include "SimdKernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Core {
+
+    namespace {
+
+        constexpr int kChannels = 3;
+
+        // Columns per vertical pass, so the accumulator stays in L1
+        constexpr int kBlockFloats = 2048;
+
+        int Reflect101(int i, int n) {
+            if (n == 1) return 0;
+            while (i < 0 || i >= n) {
+                if (i < 0) i = -i;
+                if (i >= n) i = 2 * n - 2 - i;
+            }
+            return i;
+        }
+
+    }
+
+    int UnsharpMask::RadiusFor(double sigma) {
+        return (static_cast<int>(std::lround(sigma * 6 + 1)) | 1) / 2;
+    }
+
+    size_t UnsharpMask::WorkingSetBytes(int width, double sigma) {
+        int radius = RadiusFor(sigma);
+        size_t rowFloats = static_cast<size_t>(width) * kChannels;
+        return sizeof(float) * ((2 * radius + 1) * rowFloats + rowFloats + 2 * radius * kChannels + kBlockFloats);
+    }
+
+    UnsharpMask::UnsharpMask(int width, int height, double sigma, double amount, BufferPool* pool)
+        : width_(width), height_(height), radius_(RadiusFor(sigma)), amount_(static_cast<float>(amount)),
+          rowFloats_(static_cast<size_t>(width) * kChannels) {
+        kernel_.resize(2 * radius_ + 1);
+        double sum = 0;
+        for (int i = -radius_; i <= radius_; ++i) {
+            double w = std::exp(-(i * i) / (2 * sigma * sigma));
+            kernel_[i + radius_] = static_cast<float>(w);
+            sum += w;
+        }
+        for (float& w : kernel_) w = static_cast<float>(w / sum);
+
+        storage_ = BufferPool::AcquireFrom(pool, WorkingSetBytes(width, sigma));
+        ring_ = static_cast<float*>(storage_.get());
+        padded_ = ring_ + (2 * radius_ + 1) * rowFloats_;
+        acc_ = padded_ + rowFloats_ + 2 * radius_ * kChannels;
+    }
+
+    void UnsharpMask::BlurRow(const uint8_t* src, float* dst) {
+        float* center = padded_ + radius_ * kChannels;
+        Simd::BytesToFloat(src, center, static_cast<int>(rowFloats_));
+        for (int i = 1; i <= radius_; ++i) {
+            std::copy_n(center + Reflect101(-i, width_) * kChannels, kChannels, center - i * kChannels);
+            std::copy_n(center + Reflect101(width_ - 1 + i, width_) * kChannels, kChannels, center + (width_ - 1 + i) * kChannels);
+        }
+
+        // Interleaved channels: tap k of every output float is k pixels (3k floats) further on
+        for (size_t x0 = 0; x0 < rowFloats_; x0 += kBlockFloats) {
+            int count = static_cast<int>(std::min<size_t>(kBlockFloats, rowFloats_ - x0));
+            std::fill_n(dst + x0, count, 0.0f);
+            for (int k = 0; k <= 2 * radius_; ++k) {
+                Simd::AddScaled(padded_ + x0 + k * kChannels, kernel_[k], dst + x0, count);
+            }
+        }
+    }
+
+    void UnsharpMask::SharpenRow(int y, uint8_t* row) {
+        for (size_t x0 = 0; x0 < rowFloats_; x0 += kBlockFloats) {
+            int count = static_cast<int>(std::min<size_t>(kBlockFloats, rowFloats_ - x0));
+            std::fill_n(acc_, count, 0.0f);
+            for (int k = 0; k <= 2 * radius_; ++k) {
+                Simd::AddScaled(RingRow(Reflect101(y + k - radius_, height_)) + x0, kernel_[k], acc_, count);
+            }
+            Simd::UnsharpBytes(row + x0, acc_, amount_, row + x0, count);
+        }
+    }
+
+    int UnsharpMask::Advance(cv::Mat band, int bandTop, int finishedRows) {
+        CV_Assert(band.type() == CV_8UC3 && band.cols == width_);
+        finishedRows = std::min(finishedRows, height_);
+
+        // Row y needs the blurred rows [y - radius, y + radius], which are exactly the
+        // rows in the ring once row y + radius has been blurred. Reflected rows at the
+        // image borders always fall inside that window too.
+        for (; blurred_ < finishedRows; ++blurred_) {
+            BlurRow(band.ptr<uint8_t>(blurred_ - bandTop), RingRow(blurred_));
+            int ready = blurred_ - radius_;
+            if (ready >= 0 && ready == sharpened_) {
+                SharpenRow(ready, band.ptr<uint8_t>(ready - bandTop));
+                ++sharpened_;
+            }
+        }
+        if (finishedRows == height_) {
+            for (; sharpened_ < height_; ++sharpened_) {
+                SharpenRow(sharpened_, band.ptr<uint8_t>(sharpened_ - bandTop));
+            }
+        }
+        return sharpened_;
+    }
+
+}
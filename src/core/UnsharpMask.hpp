@@ -0,0 +1,62 @@
+#pragma once
+
+#include "BufferPool.hpp"
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <vector>
+
+namespace Core {
+
+    // Gaussian unsharp mask, dst = src + amount * (src - blur(src)), for 8-bit BGR
+    // images that are produced top to bottom (e.g. by a TileBlender).
+    //
+    // Rows are sharpened in place as soon as the rows below them within the blur
+    // radius are final, so the mask runs right behind the merge while the rows are
+    // still in cache, and never needs whole-image temporaries: the separable blur
+    // keeps only the horizontally blurred rows of one vertical window.
+    // Borders are reflected like OpenCV's BORDER_REFLECT_101.
+    class UnsharpMask {
+    public:
+        static constexpr double kDefaultSigma = 3.0;
+
+        // Working memory comes from `pool` when one is given
+        UnsharpMask(int width, int height, double sigma, double amount, BufferPool* pool = nullptr);
+
+        // Kernel radius for `sigma` (OpenCV's kernel size for 8-bit images)
+        static int RadiusFor(double sigma);
+
+        // Bytes of working memory for an image `width` pixels wide
+        static size_t WorkingSetBytes(int width, double sigma);
+
+        // Rows still unsharpened after Advance(finishedRows) for finishedRows < height
+        int Radius() const { return radius_; }
+
+        int SharpenedRows() const { return sharpened_; }
+
+        // Image rows [0, finishedRows) are final. `band` holds image rows
+        // [bandTop, bandTop + band.rows) and must contain rows [SharpenedRows(), finishedRows).
+        // Sharpens every row whose neighbourhood is now complete, in place (all
+        // remaining rows once finishedRows reaches the height), and returns SharpenedRows().
+        int Advance(cv::Mat band, int bandTop, int finishedRows);
+
+    private:
+        int width_;
+        int height_;
+        int radius_;
+        float amount_;
+        std::vector<float> kernel_; // 2 * radius_ + 1 taps
+        int blurred_ = 0;           // Rows horizontally blurred into ring_
+        int sharpened_ = 0;
+
+        size_t rowFloats_;          // width_ * 3
+        std::shared_ptr<void> storage_; // Backs the three buffers below
+        float* ring_ = nullptr;     // Horizontally blurred rows, row y in slot y % (2 * radius_ + 1)
+        float* padded_ = nullptr;   // One source row with reflected borders
+        float* acc_ = nullptr;      // Vertical blur of one column block
+
+        float* RingRow(int y) { return ring_ + static_cast<size_t>(y % (2 * radius_ + 1)) * rowFloats_; }
+        void BlurRow(const uint8_t* src, float* dst);
+        void SharpenRow(int y, uint8_t* row);
+    };
+
+}
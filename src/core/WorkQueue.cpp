@@ -0,0 +1,265 @@
+#include "WorkQueue.hpp"
+#include "FileUtils.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace Core {
+
+    namespace {
+
+        const char* const kLease = "lease";
+        const char* const kDone = "done";
+        const char* const kFailed = "failed";
+
+        std::string DefaultWorkerId() {
+            std::string host = "worker";
+            unsigned long pid = 0;
+#ifdef _WIN32
+            char name[MAX_COMPUTERNAME_LENGTH + 1];
+            DWORD size = sizeof(name);
+            if (GetComputerNameA(name, &size)) host.assign(name, size);
+            pid = GetCurrentProcessId();
+#else
+            char name[256] = {};
+            if (gethostname(name, sizeof(name) - 1) == 0 && name[0]) host = name;
+            pid = static_cast<unsigned long>(getpid());
+#endif
+            // Tells apart queues opened by one process, and a restarted process reusing a pid
+            uint64_t seed[2] = {static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()),
+                                static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&host))};
+            return host + "-" + std::to_string(pid) + "-" + Hash::ToHex(Hash::Bytes(seed, sizeof(seed))).substr(0, 8);
+        }
+
+        std::string ReadFirstLine(const fs::path& path) {
+            std::ifstream file(path);
+            std::string line;
+            std::getline(file, line);
+            return line;
+        }
+
+    }
+
+    WorkQueue::WorkQueue(const WorkQueueOptions& options, std::vector<std::wstring> items)
+        : options_(options), items_(std::move(items)), finished_(items_.size(), false) {
+        workerId_ = options_.workerId.empty() ? DefaultWorkerId() : options_.workerId;
+        // Generic UTF-8 names, so workers on other systems derive the same keys
+        keys_.reserve(items_.size());
+        for (const auto& item : items_) {
+            keys_.push_back(Hash::ToHex(Hash::String(fs::path(item).generic_u8string())));
+        }
+        // Workers start at different points, so they rarely race for the same lease
+        if (!items_.empty()) cursor_ = static_cast<size_t>(Hash::String(workerId_) % items_.size());
+        options_.heartbeatInterval = std::max(std::chrono::milliseconds(10),
+                                              std::min(options_.heartbeatInterval, options_.leaseTimeout / 3));
+    }
+
+    WorkQueue::~WorkQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (heartbeat_.joinable()) heartbeat_.join();
+
+        // Hand unfinished items back right away instead of letting their leases expire
+        for (size_t index : held_) {
+            fs::path lease = ItemPath(kLease, index);
+            std::error_code ec;
+            if (ReadFirstLine(lease) == workerId_) fs::remove(lease, ec);
+        }
+        std::error_code ec;
+        fs::remove(ProbePath(), ec);
+    }
+
+    bool WorkQueue::Open() {
+        std::error_code ec;
+        for (const char* kind : {kLease, kDone, kFailed}) {
+            for (int shard = 0; shard < 256; ++shard) {
+                static const char hex[] = "0123456789abcdef";
+                char name[3] = {hex[shard >> 4], hex[shard & 15], 0};
+                fs::create_directories(fs::path(options_.dir) / kind / name, ec);
+                if (ec) {
+                    std::wcerr << L"Cannot create work queue directory: " << options_.dir << std::endl;
+                    return false;
+                }
+            }
+        }
+        fs::create_directories(fs::path(options_.dir) / "workers", ec);
+        if (!Refresh(ProbePath())) {
+            std::wcerr << L"Cannot write to work queue directory: " << options_.dir << std::endl;
+            return false;
+        }
+        heartbeat_ = std::thread([this]() { Heartbeat(); });
+        return true;
+    }
+
+    fs::path WorkQueue::ItemPath(const char* kind, size_t index) const {
+        const std::string& key = keys_[index];
+        return fs::path(options_.dir) / kind / key.substr(0, 2) / key;
+    }
+
+    fs::path WorkQueue::ProbePath() const {
+        return fs::path(options_.dir) / "workers" / workerId_;
+    }
+
+    bool WorkQueue::IsFinished(size_t index) const {
+        std::error_code ec;
+        return fs::exists(ItemPath(kDone, index), ec) || fs::exists(ItemPath(kFailed, index), ec);
+    }
+
+    bool WorkQueue::Refresh(const fs::path& path) const {
+        std::ofstream file(path, std::ios::trunc);
+        file << workerId_ << "\n";
+        file.close();
+        return !file.fail();
+    }
+
+    bool WorkQueue::RefreshLease(const fs::path& path) const {
+        // Opened without creating it: a lease released or taken over meanwhile stays gone
+        std::fstream file(path, std::ios::in | std::ios::out);
+        std::string owner;
+        if (!file || !std::getline(file, owner) || owner != workerId_) return false;
+        file.clear();
+        file.seekp(0);
+        file << workerId_ << "\n";
+        file.close();
+        if (file.fail()) return false;
+        // A reclaiming worker may have renamed it away just before it was rewritten
+        return ReadFirstLine(path) == workerId_;
+    }
+
+    std::chrono::milliseconds WorkQueue::Age(const fs::path& path) const {
+        std::error_code ec;
+        fs::file_time_type stamp = fs::last_write_time(path, ec);
+        if (ec) return std::chrono::milliseconds(-1);
+        // "Now" on the file server: the time it stamps on a file written just now
+        Refresh(ProbePath());
+        fs::file_time_type now = fs::last_write_time(ProbePath(), ec);
+        if (ec) return std::chrono::milliseconds(0);
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now - stamp);
+    }
+
+    WorkQueue::ClaimResult WorkQueue::TryClaim(size_t index) {
+        if (IsFinished(index)) return ClaimResult::Finished;
+
+        fs::path lease = ItemPath(kLease, index);
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (FileUtils::CreateExclusive(lease, workerId_ + "\n")) {
+                // Another worker may have finished it and dropped its lease just before
+                if (IsFinished(index)) {
+                    std::error_code ec;
+                    fs::remove(lease, ec);
+                    return ClaimResult::Finished;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                held_.insert(index);
+                return ClaimResult::Claimed;
+            }
+            if (attempt > 0) break;
+
+            std::chrono::milliseconds age = Age(lease);
+            if (age.count() < 0) continue; // Released meanwhile
+            if (age < options_.leaseTimeout) return ClaimResult::LeasedElsewhere;
+
+            // Expired. Move it out of the way first: of several workers trying, only one
+            // rename succeeds. If what was moved turns out to be fresh (another worker
+            // reclaimed it a moment ago), put it back.
+            fs::path moved = FileUtils::TempPathFor(lease);
+            std::error_code ec;
+            fs::rename(lease, moved, ec);
+            if (ec) return ClaimResult::LeasedElsewhere;
+            std::string owner = ReadFirstLine(moved);
+            if (Age(moved) < options_.leaseTimeout) {
+                FileUtils::CreateExclusive(lease, owner + "\n");
+                fs::remove(moved, ec);
+                return ClaimResult::LeasedElsewhere;
+            }
+            fs::remove(moved, ec);
+            std::wcout << L"Reclaiming expired lease of " << std::wstring(owner.begin(), owner.end())
+                       << L": " << items_[index] << std::endl;
+        }
+        return ClaimResult::LeasedElsewhere;
+    }
+
+    bool WorkQueue::Claim(size_t& index) {
+        for (;;) {
+            bool waiting = false;
+            for (size_t n = 0; n < items_.size(); ++n) {
+                size_t i = (cursor_ + n) % items_.size();
+                if (finished_[i]) continue;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (stopping_) return false;
+                    if (held_.count(i)) continue;
+                }
+                switch (TryClaim(i)) {
+                case ClaimResult::Claimed:
+                    cursor_ = i + 1;
+                    index = i;
+                    return true;
+                case ClaimResult::Finished:
+                    finished_[i] = true;
+                    break;
+                case ClaimResult::LeasedElsewhere:
+                    waiting = true;
+                    break;
+                }
+            }
+            if (!waiting) return false;
+
+            // Everything left is leased; wait for those workers to finish or expire
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (cv_.wait_for(lock, options_.heartbeatInterval, [this]() { return stopping_; })) return false;
+        }
+    }
+
+    bool WorkQueue::Complete(size_t index, bool ok) {
+        fs::path lease = ItemPath(kLease, index);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!held_.erase(index) || ReadFirstLine(lease) != workerId_) return false;
+        FileUtils::CreateExclusive(ItemPath(ok ? kDone : kFailed, index), workerId_ + "\n");
+        finished_[index] = true;
+        std::error_code ec;
+        fs::remove(lease, ec);
+        return true;
+    }
+
+    size_t WorkQueue::FinishedCount() const {
+        return static_cast<size_t>(std::count(finished_.begin(), finished_.end(), true));
+    }
+
+    void WorkQueue::Heartbeat() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, options_.heartbeatInterval, [this]() { return stopping_; })) {
+            std::vector<size_t> held(held_.begin(), held_.end());
+            lock.unlock();
+            Refresh(ProbePath());
+            std::vector<size_t> lost;
+            for (size_t index : held) {
+                // Only possible after a stall longer than leaseTimeout
+                if (!RefreshLease(ItemPath(kLease, index))) lost.push_back(index);
+            }
+            lock.lock();
+            for (size_t index : lost) {
+                if (held_.erase(index)) {
+                    std::wcerr << L"Lease lost to another worker: " << items_[index] << std::endl;
+                }
+            }
+        }
+    }
+
+}
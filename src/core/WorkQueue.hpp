@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+    struct WorkQueueOptions {
+        std::wstring dir;      // Shared by every worker of one job
+        std::string workerId;  // Empty: host name, process id and a random suffix
+        std::chrono::milliseconds leaseTimeout{120000};    // Leases not refreshed for this long are taken over
+        std::chrono::milliseconds heartbeatInterval{10000}; // At most a third of leaseTimeout
+    };
+
+    // Shares a fixed list of work items between worker processes through a directory,
+    // on one machine or on a shared (NFS/SMB) mount. No coordinator process is needed.
+    //
+    // A worker owns an item while its lease file exists (created with O_EXCL, so only
+    // one worker wins). A heartbeat thread rewrites the worker's leases, and leases
+    // left unrefreshed for leaseTimeout (a crashed worker) are taken over by renaming
+    // them away first, so only one worker can reclaim each. Finished items get a done
+    // or failed marker and are never handed out again.
+    //
+    // Lease ages are measured with the file server's clock (file modification times),
+    // so the workers' clocks need not agree.
+    //
+    // Layout: <dir>/lease, <dir>/done and <dir>/failed, each sharded by key prefix,
+    // plus <dir>/workers/<id> (a worker's clock probe).
+    class WorkQueue {
+    public:
+        // `items` identify the work (e.g. input file names relative to the input
+        // directory); every worker must pass the same names.
+        WorkQueue(const WorkQueueOptions& options, std::vector<std::wstring> items);
+        ~WorkQueue();
+
+        WorkQueue(const WorkQueue&) = delete;
+        WorkQueue& operator=(const WorkQueue&) = delete;
+
+        // Create the directories and start the heartbeat. False if the directory is unusable.
+        bool Open();
+
+        // Lease the next unfinished item. Waits while the only unfinished items are leased
+        // by live workers. False once every item is done or failed.
+        bool Claim(size_t& index);
+
+        // Record the outcome of a claimed item and release its lease. False, with nothing
+        // recorded, if the lease was lost meanwhile (the new owner records the outcome).
+        bool Complete(size_t index, bool ok);
+
+        const std::string& WorkerId() const { return workerId_; }
+
+        // Items finished by any worker, as seen by this one
+        size_t FinishedCount() const;
+
+    private:
+        enum class ClaimResult {
+            Claimed,
+            Finished,
+            LeasedElsewhere
+        };
+
+        WorkQueueOptions options_;
+        std::string workerId_;
+        std::vector<std::wstring> items_;
+        std::vector<std::string> keys_;  // Hash of each item, names its files
+        std::vector<bool> finished_; // Known finished; markers are permanent
+        size_t cursor_ = 0;          // Where the next scan starts
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::set<size_t> held_; // Leased by this worker
+        bool stopping_ = false;
+        std::thread heartbeat_;
+
+        std::filesystem::path ItemPath(const char* kind, size_t index) const;
+        std::filesystem::path ProbePath() const;
+        ClaimResult TryClaim(size_t index);
+        bool IsFinished(size_t index) const;
+
+        // Rewrite a file so the server stamps it with its current time
+        bool Refresh(const std::filesystem::path& path) const;
+
+        // Refresh an existing lease of this worker. False, leaving the file alone, if it is
+        // gone or owned by another worker.
+        bool RefreshLease(const std::filesystem::path& path) const;
+
+        // Age of `path` on the file server's clock; negative if it does not exist
+        std::chrono::milliseconds Age(const std::filesystem::path& path) const;
+
+        void Heartbeat();
+    };
+
+}
@@ -1,25 +1,121 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <optional>
 #include <string>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
+#include "core/DirectoryScan.hpp"
 #include "core/Engine.hpp"
+#include "core/JobServer.hpp"
+#include "core/SyncManifest.hpp"
 
 // Simple argument parsing helper
 struct Args {
     std::wstring input;
     std::wstring output;
     std::wstring model;
+    std::wstring modelCache = (std::filesystem::temp_directory_path() / "OfflinePhotoEnhancer" / "model-cache").wstring();
+    std::optional<std::wstring> tuneProfiles; // Unset: the temp dir, with --autotune only; empty: off
+    bool autotune = false;
+    size_t autotuneMemoryMB = 2048;
     int scale = 4;
     Core::Device device = Core::Device::CPU;
+    Core::ModelPrecision precision = Core::ModelPrecision::FP32;
+    std::wstring calibrationDir;
+    double minPsnr = 38.0;
     bool batch = false;
+    bool sync = false;                    // --sync: recursive, incremental batch
+    std::wstring manifest = L"default";   // Sync manifest; "default" is <output>/.enhancer-manifest
+    int scanThreads = 8;
+    bool pipeline = false;
+    std::wstring journal = L"default"; // Batch journal file; "default" is <output>/.enhancer-journal
+    bool resume = false;
+    int decodeThreads = 2;
+    int encodeThreads = 2;
+    int prefetchFiles = 4;
+    std::optional<int> tileBatch; // Unset: the engine's default or a tuning profile's
+    size_t tileReuseMB = 256;
+    int flatTiles = -1;
+    double detailThreshold = 0;
+    size_t maxMemoryMB = 0;
+    std::wstring resultCache;
+    size_t resultCacheMB = 2048;
+    std::optional<int> workers;      // Unset: the engine's default or a tuning profile's
+    std::optional<int> intraThreads; // Likewise
+    int interThreads = 0;
+    std::string statsJson;
+    std::string traceFile;
+    std::optional<double> strength;   // Unset: the engine's (or, with --submit, the server's) setting
+    Core::EncodeOptions encode;
+    std::optional<std::string> merge; // As given; mergeMode and featherWindow hold its meaning
+    std::wstring serveSocket;  // --serve: run as a job server on this socket
+    std::wstring submitSocket; // --submit: send one job to the server on this socket
+    int serveJobs = 2;
+    int serveQueue = 8;
+    bool sendBytes = false;
+    std::wstring workQueue; // --work-queue: share the batch with other workers through this directory
+    std::string workerId;
+    int leaseTimeoutSec = 120;
+    Core::TileMergeMode mergeMode = Core::TileMergeMode::Feather;
+    Core::FeatherWindow featherWindow = Core::FeatherWindow::Linear;
 };
 
 void print_usage() {
     std::cout << "Usage: enhancer-cli --input <path> --output <path> --model <path> [options]\n"
+              << "       enhancer-cli --serve <socket> --model <path> [options]\n"
+              << "       enhancer-cli --submit <socket> --input <path> --output <path> [--send-bytes]\n"
               << "Options:\n"
               << "  --scale <2|4>       Upscale factor (default: 4)\n"
               << "  --device <cpu|dml>  Inference device (default: cpu)\n"
-              << "  --batch             Treat input as directory\n";
+              << "  --precision <fp32|fp16|int8> Model variant to use, see scripts/quantize_model.py (default: fp32)\n"
+              << "  --calibration <dir> Sample images for checking a reduced-precision model\n"
+              << "  --min-psnr <dB>     Lowest accepted PSNR of that model vs FP32, 0 skips the check (default: 38)\n"
+              << "  --model-cache <dir|off> Optimized model cache (default: temp dir)\n"
+              << "  --tune-profiles <dir|off> Stored tuning profiles, applied at startup (default: temp dir with --autotune)\n"
+              << "  --autotune          Benchmark tile settings if this model has no profile yet\n"
+              << "  --autotune-memory <MB> Memory limit for autotune candidates (default: 2048)\n"
+              << "  --batch             Treat input as directory\n"
+              << "  --sync              Batch over the input tree: only new or changed images, output tree mirrors it\n"
+              << "  --manifest <file>   State of the input tree for --sync (default: <output>/.enhancer-manifest)\n"
+              << "  --scan-threads <n>  Directories listed and files hashed in parallel (default: 8)\n"
+              << "  --journal <file|off> Batch progress journal (default: <output>/.enhancer-journal)\n"
+              << "  --resume            Skip files a previous run of the same batch finished\n"
+              << "  --tile-batch <n>    Tiles per inference call (default: 1)\n"
+              << "  --tile-reuse-mb <n> Outputs kept for tiles identical to earlier ones, 0 disables (default: 256)\n"
+              << "  --flat-tiles <0..255|off> Fill tiles varying by at most this much instead of inferring them (default: off)\n"
+              << "  --detail-threshold <v> Upscale tiles with less detail than this without the model, 0 disables (default: 0)\n"
+              << "  --merge <feather|feather-cos|crop>  Tile overlap handling (default: feather)\n"
+              << "  --strength <0..1>   Sharpening amount, 0 disables (default: 0.5)\n"
+              << "  --png-level <0..9>  PNG compression, 0 is fastest (default: 1)\n"
+              << "  --png-strategy <default|filtered|huffman|rle|fixed> PNG zlib strategy (default: default)\n"
+              << "  --jpeg-quality <0..100> JPEG quality (default: 95)\n"
+              << "  --jpeg-progressive  Write progressive JPEGs\n"
+              << "  --webp-quality <1..101> WebP quality, 101 is lossless (default: 101)\n"
+              << "  --pipeline          Overlap decode, inference and encode in batch mode\n"
+              << "  --decode-threads <n> Decoder threads for --pipeline (default: 2)\n"
+              << "  --encode-threads <n> Encoder threads for --pipeline (default: 2)\n"
+              << "  --prefetch <n>      Input files read ahead in batch mode, 0 disables (default: 4)\n"
+              << "  --max-memory <MB>   Stream larger outputs in bands (PNG only, default: unlimited)\n"
+              << "  --result-cache <dir> Reuse outputs for inputs already enhanced with the same settings\n"
+              << "  --result-cache-size <MB> Result cache size limit (default: 2048)\n"
+              << "  --workers <n>       Parallel tile inference workers (default: 1)\n"
+              << "  --intra-threads <n> ORT intra-op threads per worker (default: cores / workers)\n"
+              << "  --inter-threads <n> ORT inter-op threads per worker (default: ORT default)\n"
+              << "  --work-queue <dir>  With --batch, share the files with other workers using this directory\n"
+              << "  --lease-timeout <s> Take over files of workers silent this long (default: 120)\n"
+              << "  --worker-id <id>    Name of this worker in the work queue (default: host-pid-random)\n"
+              << "  --stats-json <file> Write per-stage timings and counters as JSON\n"
+              << "  --trace <file>      Write a Chrome trace of every stage (chrome://tracing, Perfetto)\n"
+              << "Server mode:\n"
+              << "  --serve <socket>    Keep the model loaded and run jobs sent to a local socket\n"
+              << "  --jobs <n>          Jobs run at once (default: 2)\n"
+              << "  --queue <n>         Accepted jobs waiting to run; clients block beyond it (default: 8)\n"
+              << "  --submit <socket>   Send one job (--input, --output, --strength, --merge,\n"
+              << "                      --max-memory) to a server and print its timings\n"
+              << "  --send-bytes        With --submit, send the input file's contents instead of its path\n";
 }
 
 Args parse_args(int argc, char* argv[]) {
@@ -35,19 +131,227 @@ Args parse_args(int argc, char* argv[]) {
         } else if (arg == "--model" && i + 1 < argc) {
             std::string val = argv[++i];
             args.model = std::wstring(val.begin(), val.end());
+        } else if (arg == "--model-cache" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.modelCache = (val == "off") ? std::wstring() : std::wstring(val.begin(), val.end());
+        } else if (arg == "--tune-profiles" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.tuneProfiles = (val == "off") ? std::wstring() : std::wstring(val.begin(), val.end());
+        } else if (arg == "--autotune") {
+            args.autotune = true;
+        } else if (arg == "--autotune-memory" && i + 1 < argc) {
+            args.autotuneMemoryMB = std::stoull(argv[++i]);
         } else if (arg == "--scale" && i + 1 < argc) {
             args.scale = std::stoi(argv[++i]);
         } else if (arg == "--device" && i + 1 < argc) {
             std::string val = argv[++i];
             if (val == "dml" || val == "cuda") args.device = Core::Device::DirectML; // Map cuda to DML for now or separate
             else args.device = Core::Device::CPU;
+        } else if (arg == "--precision" && i + 1 < argc) {
+            std::string val = argv[++i];
+            if (val == "int8") args.precision = Core::ModelPrecision::INT8;
+            else if (val == "fp16") args.precision = Core::ModelPrecision::FP16;
+            else args.precision = Core::ModelPrecision::FP32;
+        } else if (arg == "--calibration" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.calibrationDir = std::wstring(val.begin(), val.end());
+        } else if (arg == "--min-psnr" && i + 1 < argc) {
+            args.minPsnr = std::stod(argv[++i]);
         } else if (arg == "--batch") {
             args.batch = true;
+        } else if (arg == "--sync") {
+            args.batch = true;
+            args.sync = true;
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.manifest = std::wstring(val.begin(), val.end());
+        } else if (arg == "--scan-threads" && i + 1 < argc) {
+            args.scanThreads = std::stoi(argv[++i]);
+        } else if (arg == "--journal" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.journal = (val == "off") ? std::wstring() : std::wstring(val.begin(), val.end());
+        } else if (arg == "--resume") {
+            args.resume = true;
+        } else if (arg == "--tile-batch" && i + 1 < argc) {
+            args.tileBatch = std::stoi(argv[++i]);
+        } else if (arg == "--tile-reuse-mb" && i + 1 < argc) {
+            args.tileReuseMB = std::stoull(argv[++i]);
+        } else if (arg == "--flat-tiles" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.flatTiles = (val == "off") ? -1 : std::min(255, std::max(0, std::stoi(val)));
+        } else if (arg == "--detail-threshold" && i + 1 < argc) {
+            args.detailThreshold = std::max(0.0, std::stod(argv[++i]));
+        } else if (arg == "--merge" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.merge = val;
+            if (val == "crop") {
+                args.mergeMode = Core::TileMergeMode::CropToCenter;
+            } else {
+                args.mergeMode = Core::TileMergeMode::Feather;
+                args.featherWindow = (val == "feather-cos") ? Core::FeatherWindow::Cosine : Core::FeatherWindow::Linear;
+            }
+        } else if (arg == "--pipeline") {
+            args.pipeline = true;
+        } else if (arg == "--decode-threads" && i + 1 < argc) {
+            args.decodeThreads = std::stoi(argv[++i]);
+        } else if (arg == "--encode-threads" && i + 1 < argc) {
+            args.encodeThreads = std::stoi(argv[++i]);
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            args.prefetchFiles = std::stoi(argv[++i]);
+        } else if (arg == "--max-memory" && i + 1 < argc) {
+            args.maxMemoryMB = std::stoull(argv[++i]);
+        } else if (arg == "--result-cache" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.resultCache = std::wstring(val.begin(), val.end());
+        } else if (arg == "--result-cache-size" && i + 1 < argc) {
+            args.resultCacheMB = std::stoull(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            args.workers = std::stoi(argv[++i]);
+        } else if (arg == "--intra-threads" && i + 1 < argc) {
+            args.intraThreads = std::stoi(argv[++i]);
+        } else if (arg == "--inter-threads" && i + 1 < argc) {
+            args.interThreads = std::stoi(argv[++i]);
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            args.statsJson = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            args.traceFile = argv[++i];
+        } else if (arg == "--strength" && i + 1 < argc) {
+            args.strength = std::stod(argv[++i]);
+        } else if (arg == "--png-level" && i + 1 < argc) {
+            args.encode.pngCompression = std::stoi(argv[++i]);
+        } else if (arg == "--png-strategy" && i + 1 < argc) {
+            std::string val = argv[++i];
+            if (val == "filtered") args.encode.pngStrategy = Core::PngStrategy::Filtered;
+            else if (val == "huffman") args.encode.pngStrategy = Core::PngStrategy::HuffmanOnly;
+            else if (val == "rle") args.encode.pngStrategy = Core::PngStrategy::Rle;
+            else if (val == "fixed") args.encode.pngStrategy = Core::PngStrategy::Fixed;
+            else args.encode.pngStrategy = Core::PngStrategy::Default;
+        } else if (arg == "--jpeg-quality" && i + 1 < argc) {
+            args.encode.jpegQuality = std::stoi(argv[++i]);
+        } else if (arg == "--jpeg-progressive") {
+            args.encode.jpegProgressive = true;
+        } else if (arg == "--webp-quality" && i + 1 < argc) {
+            args.encode.webpQuality = std::stoi(argv[++i]);
+        } else if (arg == "--serve" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.serveSocket = std::wstring(val.begin(), val.end());
+        } else if (arg == "--submit" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.submitSocket = std::wstring(val.begin(), val.end());
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            args.serveJobs = std::stoi(argv[++i]);
+        } else if (arg == "--queue" && i + 1 < argc) {
+            args.serveQueue = std::stoi(argv[++i]);
+        } else if (arg == "--work-queue" && i + 1 < argc) {
+            std::string val = argv[++i];
+            args.workQueue = std::wstring(val.begin(), val.end());
+        } else if (arg == "--lease-timeout" && i + 1 < argc) {
+            args.leaseTimeoutSec = std::stoi(argv[++i]);
+        } else if (arg == "--worker-id" && i + 1 < argc) {
+            args.workerId = argv[++i];
+        } else if (arg == "--send-bytes") {
+            args.sendBytes = true;
         }
     }
     return args;
 }
 
+// Write the engine's stats and trace files, if requested
+void write_stats(const Core::Engine& engine, const Args& args) {
+    const Core::Telemetry::Collector* stats = engine.Stats();
+    if (!stats) return;
+    if (!args.statsJson.empty()) {
+        std::ofstream out(args.statsJson);
+        stats->WriteJson(out);
+        std::cout << "Stats written to " << args.statsJson << std::endl;
+
+        Core::BufferPool::Stats pool = engine.BufferPoolStats();
+        std::cout << "Scratch buffers: " << pool.allocated << " allocated, " << pool.reused << " reused, peak "
+                  << pool.peakBytesInUse / (1024 * 1024) << " MB in use" << std::endl;
+    }
+    if (!args.traceFile.empty()) {
+        std::ofstream out(args.traceFile);
+        stats->WriteChromeTrace(out);
+        std::cout << "Trace written to " << args.traceFile << std::endl;
+    }
+}
+
+// Incremental batch: enhance the new and changed images of the input tree into the
+// same structure under the output directory, then record them in the manifest
+Core::BatchSummary sync_batch(Core::Engine& engine, const Args& args, Core::ProgressCallback progress) {
+    namespace fs = std::filesystem;
+    Core::ScanOptions scanOpts;
+    scanOpts.root = args.input;
+    scanOpts.threads = args.scanThreads;
+    scanOpts.excludeDirs = {args.output};
+    auto scanBegin = std::chrono::steady_clock::now();
+    std::vector<std::wstring> unreadable;
+    std::vector<Core::ScannedFile> files = Core::DirectoryScan::Scan(scanOpts, &unreadable);
+
+    std::wstring manifestPath = (args.manifest == L"default") ? (fs::path(args.output) / ".enhancer-manifest").wstring() : args.manifest;
+    Core::SyncManifest manifest(manifestPath, engine.OutputSettingsKey());
+    manifest.Load();
+    Core::SyncPlan plan = manifest.Plan(files, args.scanThreads, unreadable);
+    auto scanMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scanBegin).count();
+    std::cout << "Scanned " << files.size() << " images in " << scanMs << " ms: " << plan.added << " new, " << plan.modified
+              << " modified, " << plan.unchanged << " unchanged, " << plan.touched << " touched but unchanged, "
+              << plan.rejected << " not images, " << plan.removed << " removed." << std::endl;
+    if (!unreadable.empty()) {
+        std::cout << unreadable.size() << " director" << (unreadable.size() == 1 ? "y" : "ies") << " could not be read; "
+                  << plan.unlisted << " known images in them are kept for the next run." << std::endl;
+    }
+
+    std::vector<std::wstring> inputs, outputs;
+    for (size_t index : plan.process) {
+        fs::path outputDir = fs::path(args.output) / fs::path(files[index].relative).parent_path();
+        std::error_code ec;
+        fs::create_directories(outputDir, ec);
+        inputs.push_back(files[index].path);
+        outputs.push_back(Core::Engine::OutputPathFor(files[index].path, outputDir.wstring()));
+    }
+    Core::BatchSummary summary = engine.ProcessBatch(inputs, outputs, progress);
+
+    // Failed files stay out of the manifest, so the next run tries them again
+    std::unordered_set<std::wstring> failed(summary.failedFiles.begin(), summary.failedFiles.end());
+    for (size_t k = 0; k < plan.process.size(); ++k) {
+        if (!failed.count(inputs[k])) manifest.Update(files[plan.process[k]], plan.hashes[k]);
+    }
+    manifest.Save();
+    return summary;
+}
+
+// Client mode: send one job to a running server and print the response
+int submit_job(const Args& args) {
+    Core::JobMessage request;
+    request.Set("id", "cli");
+    // The server resolves paths against its own working directory
+    request.Set("output", std::filesystem::absolute(args.output).u8string());
+    // Only flags given on the command line override the server's settings
+    if (args.strength) request.Set("strength", std::to_string(*args.strength));
+    if (args.merge) request.Set("merge", *args.merge);
+    if (args.maxMemoryMB > 0) request.Set("max-memory", std::to_string(args.maxMemoryMB));
+    if (args.sendBytes) {
+        std::ifstream file(std::filesystem::path(args.input), std::ios::binary);
+        request.payload.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (request.payload.empty()) {
+            std::cerr << "Failed to read input file." << std::endl;
+            return 1;
+        }
+    } else {
+        request.Set("input", std::filesystem::absolute(args.input).u8string());
+    }
+
+    Core::JobMessage response;
+    if (!Core::JobServer::Submit(args.submitSocket, request, response)) {
+        std::cerr << "Job submission failed." << std::endl;
+        return 1;
+    }
+    for (const auto& field : response.fields) {
+        std::cout << field.first << ": " << field.second << std::endl;
+    }
+    return response.Get("status") == "ok" ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 4) {
         print_usage();
@@ -55,38 +359,147 @@ int main(int argc, char* argv[]) {
     }
 
     Args args = parse_args(argc, argv);
+    if (!args.submitSocket.empty()) {
+        return submit_job(args);
+    }
 
     Core::EngineOptions opts;
     opts.modelPath = args.model;
+    opts.modelCacheDir = args.modelCache;
+    // Profiles may change the tile size, and with it the output settings (invalidating
+    // --sync manifests and cached results), so they are only used when asked for
+    if (args.tuneProfiles) {
+        opts.tuneProfileDir = *args.tuneProfiles;
+    } else if (args.autotune) {
+        opts.tuneProfileDir = (std::filesystem::temp_directory_path() / "OfflinePhotoEnhancer" / "tune-profiles").wstring();
+    }
+    opts.autotune = args.autotune;
+    opts.autotuneMemoryBytes = args.autotuneMemoryMB * 1024 * 1024;
     opts.scale = args.scale;
+    if (args.strength) opts.strength = *args.strength;
+    opts.encode = args.encode;
     opts.device = args.device;
+    opts.precision = args.precision;
+    opts.calibrationDir = args.calibrationDir;
+    opts.minPrecisionPsnr = args.minPsnr;
+    if (args.tileBatch) {
+        opts.tileBatchSize = *args.tileBatch;
+        opts.explicitTuning.tileBatchSize = true;
+    }
+    opts.tileReuseBytes = args.tileReuseMB * 1024 * 1024;
+    opts.flatTileTolerance = args.flatTiles;
+    opts.detailThreshold = args.detailThreshold;
+    opts.mergeMode = args.mergeMode;
+    opts.featherWindow = args.featherWindow;
+    opts.pipelineBatch = args.pipeline;
+    if (args.batch && args.workQueue.empty()) {
+        // A shared work queue records progress itself
+        opts.journalPath = (args.journal == L"default") ? (std::filesystem::path(args.output) / ".enhancer-journal").wstring() : args.journal;
+        opts.resume = args.resume;
+    }
+    opts.decodeThreads = args.decodeThreads;
+    opts.encodeThreads = args.encodeThreads;
+    opts.prefetchFiles = args.prefetchFiles;
+    opts.maxMemoryBytes = args.maxMemoryMB * 1024 * 1024;
+    opts.resultCacheDir = args.resultCache;
+    opts.resultCacheMaxBytes = static_cast<uint64_t>(args.resultCacheMB) * 1024 * 1024;
+    if (args.workers) {
+        opts.inferenceWorkers = *args.workers;
+        opts.explicitTuning.inferenceWorkers = true;
+    }
+    if (args.intraThreads) {
+        opts.intraOpThreads = *args.intraThreads;
+        opts.explicitTuning.intraOpThreads = true;
+    }
+    opts.interOpThreads = args.interThreads;
+    // A server reports timings per job instead
+    opts.collectStats = !args.statsJson.empty() && args.serveSocket.empty();
+    opts.collectTrace = !args.traceFile.empty() && args.serveSocket.empty();
 
     Core::Engine engine(opts);
     
     std::cout << "Initializing engine..." << std::endl;
+    auto startupBegin = std::chrono::steady_clock::now();
     if (!engine.Initialize()) {
         std::cerr << "Engine initialization failed." << std::endl;
         return 1;
     }
+    auto startupMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startupBegin).count();
+    std::cout << "Engine ready in " << startupMs << " ms"
+              << (engine.UsedModelCache() ? " (optimized model from cache)" : "") << std::endl;
 
-    if (args.batch) {
-        // Collect files
+    if (!args.serveSocket.empty()) {
+        Core::JobServerOptions serverOpts;
+        serverOpts.socketPath = args.serveSocket;
+        serverOpts.concurrentJobs = args.serveJobs;
+        serverOpts.queueDepth = args.serveQueue;
+        Core::JobServer server(engine, serverOpts);
+        if (!server.Start()) {
+            std::cerr << "Failed to start the job server." << std::endl;
+            return 1;
+        }
+        std::wcout << L"Serving jobs on " << args.serveSocket << std::endl;
+        server.Wait();
+        server.Stop();
+        std::cout << "Server stopped." << std::endl;
+
+    } else if (args.batch) {
+        // Collect images (sorted: workers sharing a queue must see the same list)
         std::vector<std::wstring> files;
-        for (const auto& entry : std::filesystem::directory_iterator(args.input)) {
-            if (entry.is_regular_file()) {
-                files.push_back(entry.path().wstring());
-            }
+        if (!args.sync) {
+            Core::ScanOptions scanOpts;
+            scanOpts.root = args.input;
+            scanOpts.recursive = false;
+            for (const auto& file : Core::DirectoryScan::Scan(scanOpts)) files.push_back(file.path);
         }
-        
-        engine.ProcessBatch(files, args.output, [](const Core::ProgressEvent& evt) {
+
+        auto progress = [](const Core::ProgressEvent& evt) {
             std::cout << "[" << evt.currentFileIndex << "/" << evt.totalFiles << "] " 
                       << (int)(evt.percentComplete * 100) << "% - " << evt.statusMessage << "\r";
-        });
-        std::cout << "\nBatch processing complete." << std::endl;
+        };
+        Core::BatchSummary summary;
+        if (args.sync) {
+            if (!args.workQueue.empty()) {
+                std::cerr << "--sync cannot be combined with --work-queue." << std::endl;
+                return 1;
+            }
+            summary = sync_batch(engine, args, progress);
+        } else if (!args.workQueue.empty()) {
+            Core::WorkQueueOptions queueOpts;
+            queueOpts.dir = args.workQueue;
+            queueOpts.workerId = args.workerId;
+            queueOpts.leaseTimeout = std::chrono::seconds(std::max(1, args.leaseTimeoutSec));
+            // Items are file names, so workers may mount the input directory at different paths
+            std::vector<std::wstring> names;
+            for (const auto& file : files) names.push_back(std::filesystem::path(file).filename().wstring());
+            Core::WorkQueue queue(queueOpts, names);
+            if (!queue.Open()) {
+                std::cerr << "Failed to open the work queue." << std::endl;
+                return 1;
+            }
+            std::cout << "Worker " << queue.WorkerId() << " joined the work queue." << std::endl;
+            summary = engine.ProcessQueued(files, args.output, queue, progress);
+        } else {
+            summary = engine.ProcessBatch(files, args.output, progress);
+        }
+        std::cout << "\nBatch processing complete: " << summary.succeeded << " of " << summary.totalFiles
+                  << " succeeded, " << summary.failed << " failed";
+        if (summary.resumed > 0) std::cout << ", " << summary.resumed << " already done";
+        std::cout << "." << std::endl;
+        if (!summary.failedFiles.empty()) {
+            std::cerr << "Failed files (see the errors above; --resume retries them):" << std::endl;
+            for (const auto& file : summary.failedFiles) std::wcerr << L"  " << file << std::endl;
+        }
+        if (!opts.resultCacheDir.empty()) {
+            std::cout << "Result cache: " << summary.cacheHits << " hits, " << summary.cacheMisses << " misses." << std::endl;
+        }
+        write_stats(engine, args);
 
     } else {
         std::cout << "Processing file..." << std::endl;
-        if (engine.ProcessFile(args.input, args.output)) {
+        bool ok = engine.ProcessFile(args.input, args.output);
+        write_stats(engine, args);
+        if (ok) {
             std::cout << "Success!" << std::endl;
         } else {
             std::cerr << "Failed to process file." << std::endl;
@@ -1,8 +1,77 @@
 #include <iostream>
-#include <cassert>
+#include <cstdlib>
 #include <vector>
 #include <cmath>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+#include "../src/core/Autotuner.hpp"
+#include "../src/core/BufferPool.hpp"
+#include "../src/core/DirectoryScan.hpp"
+#include "../src/core/Engine.hpp"
+#include "../src/core/FilePrefetcher.hpp"
+#include "../src/core/Hash.hpp"
 #include "../src/core/ImageUtils.hpp"
+#include "../src/core/JobServer.hpp"
+#include "../src/core/LocalSocket.hpp"
+#include "../src/core/MappedFile.hpp"
+#include "../src/core/ModelVariants.hpp"
+#include "../src/core/Pipeline.hpp"
+#include "../src/core/ResultCache.hpp"
+#include "../src/core/RowWriter.hpp"
+#include "../src/core/SyncManifest.hpp"
+#include "../src/core/SimdKernels.hpp"
+#include "../src/core/UnsharpMask.hpp"
+
+// Like assert(), but also evaluated in release builds (NDEBUG), so checks may call the code under test
+#define CHECK(cond)                                                                                \
+    do {                                                                                           \
+        if (!(cond)) {                                                                             \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": Check failed: " << #cond << std::endl; \
+            std::abort();                                                                          \
+        }                                                                                          \
+    } while (0)
+
+// A fresh directory under the temp directory with an empty stub.onnx (the test model)
+// and `subdirs` in it; removed again when the test ends
+struct TestDir {
+    std::filesystem::path path;
+
+    explicit TestDir(const std::string& name, std::initializer_list<const char*> subdirs = {})
+        : path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+        for (const char* subdir : subdirs) std::filesystem::create_directories(path / subdir);
+        std::ofstream(path / "stub.onnx").close();
+    }
+    ~TestDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+    TestDir(const TestDir&) = delete;
+    TestDir& operator=(const TestDir&) = delete;
+
+    std::filesystem::path operator/(const std::string& name) const { return path / name; }
+    std::wstring StubModel() const { return (path / "stub.onnx").wstring(); }
+};
+
+// 2x upscale with the stub model in `dir`
+Core::EngineOptions StubEngineOptions(const TestDir& dir, int tileSize, int tileOverlap = 4) {
+    Core::EngineOptions opts;
+    opts.modelPath = dir.StubModel();
+    opts.scale = 2;
+    opts.tileSize = tileSize;
+    opts.tileOverlap = tileOverlap;
+    return opts;
+}
 
 void test_tiling() {
     std::cout << "Testing Tiling..." << std::endl;
@@ -15,13 +84,20 @@ void test_tiling() {
     auto tiles = Core::ImageUtils::SplitTiles(img, tile_size, overlap);
     
     // Check if we have tiles
-    assert(!tiles.empty());
+    CHECK(!tiles.empty());
     
     // Check first tile
-    assert(tiles[0].x == 0);
-    assert(tiles[0].y == 0);
-    assert(tiles[0].width == 32);
-    assert(tiles[0].height == 32);
+    CHECK(tiles[0].x == 0);
+    CHECK(tiles[0].y == 0);
+    CHECK(tiles[0].width == 32);
+    CHECK(tiles[0].height == 32);
+
+    // Edge tiles are shifted back instead of cropped, so all tiles share one size
+    for (const auto& tile : tiles) {
+        CHECK(tile.width == tile_size && tile.height == tile_size);
+    }
+    CHECK(tiles.back().x + tiles.back().width == 100);
+    CHECK(tiles.back().y + tiles.back().height == 100);
     
     std::cout << "Tiling OK. Generated " << tiles.size() << " tiles." << std::endl;
 }
@@ -33,20 +109,1574 @@ void test_preprocess() {
     auto data = Core::ImageUtils::PreProcess(img);
     
     // Size should be 3 channels * 2 * 2 = 12
-    assert(data.size() == 12);
+    CHECK(data.size() == 12);
     
     // Check value: Red channel (index 0 in RGB) should be 1.0
     // PreProcess converts BGR -> RGB. So R is first channel.
     // data layout: RRRR GGGG BBBB
     // R channel is first 4 elements.
-    assert(std::abs(data[0] - 1.0f) < 1e-5);
+    CHECK(std::abs(data[0] - 1.0f) < 1e-5);
     
+    // Fused path on a non-contiguous ROI wide enough to hit the SIMD loop and the scalar tail
+    cv::Mat big(8, 64, CV_8UC3);
+    cv::randu(big, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Mat roi = big(cv::Rect(5, 2, 37, 3));
+    std::vector<float> fused(3 * 37 * 3);
+    Core::ImageUtils::PreProcessInto(roi, fused.data());
+    for (int y = 0; y < roi.rows; ++y) {
+        for (int x = 0; x < roi.cols; ++x) {
+            cv::Vec3b px = roi.at<cv::Vec3b>(y, x);
+            for (int c = 0; c < 3; ++c) {
+                CHECK(std::abs(fused[c * 37 * 3 + y * 37 + x] - px[2 - c] / 255.0f) < 1e-6);
+            }
+        }
+    }
+
     std::cout << "Preprocess OK." << std::endl;
 }
 
+void test_postprocess() {
+    std::cout << "Testing Postprocess..." << std::endl;
+    // 3x20 CHW output with out-of-range values; write the 17x2 region at (2, 1) into a canvas ROI
+    const int h = 3, w = 20;
+    std::vector<float> data(3 * h * w);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (i % 13) * 0.1f - 0.1f;
+
+    cv::Mat canvas = cv::Mat::zeros(10, 30, CV_8UC3);
+    cv::Rect region(2, 1, 17, 2);
+    Core::ImageUtils::PostProcessInto(data.data(), h, w, region, canvas(cv::Rect(5, 4, 17, 2)));
+
+    for (int y = 0; y < region.height; ++y) {
+        for (int x = 0; x < region.width; ++x) {
+            cv::Vec3b px = canvas.at<cv::Vec3b>(4 + y, 5 + x);
+            for (int c = 0; c < 3; ++c) {
+                float v = data[c * h * w + (region.y + y) * w + region.x + x];
+                v = std::min(1.0f, std::max(0.0f, v));
+                CHECK(px[2 - c] == cv::saturate_cast<uchar>(v * 255.0f));
+            }
+        }
+    }
+    // Pixels outside the ROI are untouched
+    CHECK(canvas.at<cv::Vec3b>(3, 5) == cv::Vec3b(0, 0, 0));
+    CHECK(canvas.at<cv::Vec3b>(4, 22) == cv::Vec3b(0, 0, 0));
+
+    std::cout << "Postprocess OK." << std::endl;
+}
+
+void test_merge_tiles() {
+    std::cout << "Testing MergeTiles..." << std::endl;
+    cv::Mat img(70, 90, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    auto tiles = Core::ImageUtils::SplitTiles(img, 32, 8);
+    cv::Mat merged = Core::ImageUtils::MergeTiles(tiles, img.cols, img.rows, 32, 8);
+    CHECK(cv::norm(merged, img, cv::NORM_INF) <= 1);
+
+    std::cout << "MergeTiles OK." << std::endl;
+}
+
+void test_blending_identity() {
+    std::cout << "Testing tile blending with the stub model..." << std::endl;
+    // The stub model is a nearest-neighbour upscale, so any seam shows up as a
+    // difference against cv::resize(INTER_NEAREST).
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_blend");
+
+    cv::Mat img(77, 130, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::SaveImage((dir / "in.png").wstring(), img));
+
+    for (auto mode : {Core::TileMergeMode::Feather, Core::TileMergeMode::CropToCenter}) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 32, 6);
+        opts.strength = 0;
+        opts.tileBatchSize = 3;
+        opts.mergeMode = mode;
+
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.ProcessFile((dir / "in.png").wstring(), (dir / "out.png").wstring()));
+
+        cv::Mat out = Core::ImageUtils::LoadImage((dir / "out.png").wstring());
+        cv::Mat expected;
+        cv::resize(img, expected, cv::Size(img.cols * 2, img.rows * 2), 0, 0, cv::INTER_NEAREST);
+        CHECK(out.size() == expected.size());
+        CHECK(cv::norm(out, expected, cv::NORM_INF) <= 1);
+    }
+
+    std::cout << "Tile blending OK." << std::endl;
+}
+
+void test_unsharp_mask() {
+    std::cout << "Testing unsharp mask..." << std::endl;
+    // Band-wise, in-place sharpening must match a whole-image Gaussian unsharp mask,
+    // however the rows arrive. Includes images smaller than the blur radius.
+    for (cv::Size size : {cv::Size(67, 45), cv::Size(5, 4), cv::Size(1, 30)}) {
+        cv::Mat img(size, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        cv::Mat blurred, expected;
+        cv::GaussianBlur(img, blurred, cv::Size(0, 0), Core::UnsharpMask::kDefaultSigma);
+        cv::addWeighted(img, 1.5, blurred, -0.5, 0, expected);
+
+        for (int step : {1, 7, size.height}) {
+            cv::Mat out = img.clone();
+            Core::UnsharpMask mask(size.width, size.height, Core::UnsharpMask::kDefaultSigma, 0.5);
+            for (int finished = std::min(step, size.height); ; finished = std::min(finished + step, size.height)) {
+                int sharpened = mask.Advance(out, 0, finished);
+                CHECK(sharpened <= finished);
+                CHECK(finished == size.height ? sharpened == finished : sharpened >= finished - mask.Radius());
+                if (finished == size.height) break;
+            }
+            // The reference rounds the blur to 8 bits first
+            CHECK(cv::norm(out, expected, cv::NORM_INF) <= 2);
+        }
+    }
+
+    // Every SIMD level computes the same result
+    cv::Mat img(37, 101, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    cv::Mat reference = Core::ImageUtils::Sharpen(img, 0.7);
+    for (auto level : {Core::Simd::Level::Scalar, Core::Simd::Level::SSE41}) {
+        Core::Simd::SetMaxLevel(level);
+        CHECK(cv::norm(Core::ImageUtils::Sharpen(img, 0.7), reference, cv::NORM_INF) <= 1);
+    }
+    Core::Simd::SetMaxLevel(Core::Simd::Level::AVX2);
+    std::cout << "Unsharp mask OK." << std::endl;
+}
+
+void test_streaming() {
+    std::cout << "Testing band streaming..." << std::endl;
+    // Streamed output must match the in-memory result exactly, whatever the band height.
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_stream");
+
+    cv::Mat img(200, 130, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::SaveImage((dir / "in.png").wstring(), img));
+
+    for (auto mode : {Core::TileMergeMode::Feather, Core::TileMergeMode::CropToCenter})
+    for (double strength : {0.0, 0.5}) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.strength = strength;
+        opts.mergeMode = mode;
+
+        Core::Engine inMemory(opts);
+        CHECK(inMemory.Initialize());
+        CHECK(inMemory.ProcessFile((dir / "in.png").wstring(), (dir / "expected.png").wstring()));
+        cv::Mat expected = Core::ImageUtils::LoadImage((dir / "expected.png").wstring());
+
+        // 1 byte: one tile row per band; 400 KB: a few tile rows per band
+        for (size_t budget : {size_t(1), size_t(400000)}) {
+            opts.maxMemoryBytes = budget;
+            Core::Engine streamed(opts);
+            CHECK(streamed.Initialize());
+            CHECK(streamed.ProcessFile((dir / "in.png").wstring(), (dir / "out.png").wstring()));
+
+            cv::Mat out = Core::ImageUtils::LoadImage((dir / "out.png").wstring());
+            CHECK(out.size() == expected.size());
+            CHECK(cv::norm(out, expected, cv::NORM_INF) == 0);
+        }
+    }
+
+    std::cout << "Band streaming OK." << std::endl;
+}
+
+void test_parallel_workers() {
+    std::cout << "Testing parallel tile workers..." << std::endl;
+    // Several workers and cross-image scheduling must not change the result.
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_workers", {"out"});
+
+    std::vector<std::wstring> inputs;
+    std::vector<cv::Mat> images;
+    for (int i = 0; i < 4; ++i) {
+        cv::Mat img(40 + 17 * i, 90 - 11 * i, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        inputs.push_back(path.wstring());
+        images.push_back(img);
+    }
+
+    Core::EngineOptions opts = StubEngineOptions(dir, 16);
+    opts.strength = 0;
+    opts.tileBatchSize = 2;
+    opts.inferenceWorkers = 3;
+    opts.pipelineBatch = true;
+
+    Core::Engine engine(opts);
+    CHECK(engine.Initialize());
+    engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr);
+
+    for (int i = 0; i < 4; ++i) {
+        cv::Mat out = Core::ImageUtils::LoadImage((dir / "out" / ("img" + std::to_string(i) + "_upscaled.png")).wstring());
+        cv::Mat expected;
+        cv::resize(images[i], expected, cv::Size(images[i].cols * 2, images[i].rows * 2), 0, 0, cv::INTER_NEAREST);
+        CHECK(out.size() == expected.size());
+        CHECK(cv::norm(out, expected, cv::NORM_INF) <= 1);
+    }
+    // No temporary files left behind by the encoders
+    CHECK(std::distance(fs::directory_iterator(dir / "out"), fs::directory_iterator()) == 4);
+
+    std::cout << "Parallel tile workers OK." << std::endl;
+}
+
+void test_hash_and_mapping() {
+    std::cout << "Testing hashing and file mapping..." << std::endl;
+    // Reference XXH64 values
+    CHECK(Core::Hash::Bytes("", 0) == 0xEF46DB3751D8E999ULL);
+    CHECK(Core::Hash::String("abc") == 0x44BC2CF5AD770999ULL);
+    CHECK(Core::Hash::String("Nobody inspects the spammish repetition") == 0xFBCEA83C8A378BF1ULL);
+    CHECK(Core::Hash::ToHex(0xEF46DB3751D8E999ULL) == "ef46db3751d8e999");
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "enhancer_test_mapping.bin";
+    std::string content(100000, '\0');
+    for (size_t i = 0; i < content.size(); ++i) content[i] = static_cast<char>(i * 31);
+    std::ofstream(path, std::ios::binary).write(content.data(), content.size());
+
+    Core::MappedFile file;
+    CHECK(file.Open(path.wstring()));
+    CHECK(file.Size() == content.size());
+    CHECK(std::memcmp(file.Data(), content.data(), content.size()) == 0);
+
+    uint64_t hash = 0;
+    CHECK(Core::Hash::File(path.wstring(), hash));
+    CHECK(hash == Core::Hash::String(content));
+
+    file.Close();
+    std::filesystem::remove(path);
+    CHECK(!file.Open(path.wstring()));
+    std::cout << "Hashing and file mapping OK." << std::endl;
+}
+
+void test_result_cache() {
+    std::cout << "Testing result cache..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_result_cache", {"out"});
+
+    std::vector<std::wstring> inputs;
+    for (int i = 0; i < 3; ++i) {
+        cv::Mat img(30 + i, 40, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        inputs.push_back(path.wstring());
+    }
+    fs::copy_file(dir / "img0.png", dir / "dup.png"); // Same bytes, different name
+    inputs.push_back((dir / "dup.png").wstring());
+
+    for (bool pipelined : {false, true}) {
+        fs::remove_all(dir / "cache");
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.pipelineBatch = pipelined;
+        opts.decodeThreads = 1; // Keeps the duplicate a guaranteed hit
+        opts.resultCacheDir = (dir / "cache").wstring();
+
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        Core::BatchSummary first = engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr);
+        CHECK(first.succeeded == 4 && first.failed == 0);
+        CHECK(first.cacheMisses + first.cacheHits == 4);
+        cv::Mat reference = Core::ImageUtils::LoadImage((dir / "out" / "img0_upscaled.png").wstring());
+        fs::remove_all(dir / "out");
+        fs::create_directories(dir / "out");
+
+        Core::BatchSummary second = engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr);
+        CHECK(second.succeeded == 4 && second.cacheHits == 4 && second.cacheMisses == 0);
+        cv::Mat cached = Core::ImageUtils::LoadImage((dir / "out" / "dup_upscaled.png").wstring());
+        CHECK(cv::norm(cached, reference, cv::NORM_INF) == 0);
+
+        // Different settings must not reuse the entries
+        opts.strength = 0.25;
+        Core::Engine other(opts);
+        CHECK(other.Initialize());
+        Core::BatchSummary third = other.ProcessBatch({inputs[1]}, (dir / "out").wstring(), nullptr);
+        CHECK(third.cacheHits == 0 && third.cacheMisses == 1);
+    }
+
+    // LRU cap: storing a third entry evicts the least recently used one
+    fs::path cacheDir = dir / "lru";
+    uint64_t entrySize = fs::file_size(dir / "img0.png");
+    Core::ResultCache cache(cacheDir.wstring(), entrySize * 2 + entrySize / 2);
+    std::string keyA = cache.Key(inputs[0], "a", L".png");
+    std::string keyB = cache.Key(inputs[0], "b", L".png");
+    std::string keyC = cache.Key(inputs[0], "c", L".png");
+    CHECK(keyA != keyB);
+    cache.Store(keyA, inputs[0]);
+    cache.Store(keyB, inputs[0]);
+    fs::last_write_time(cacheDir / (keyA + ".out"), fs::file_time_type::clock::now() - std::chrono::hours(2));
+    fs::last_write_time(cacheDir / (keyB + ".out"), fs::file_time_type::clock::now() - std::chrono::hours(1));
+    CHECK(cache.Fetch(keyA, (dir / "fetched.png").wstring())); // A becomes the most recent
+    cache.Store(keyC, inputs[0]);
+    CHECK(fs::exists(cacheDir / (keyA + ".out")));
+    CHECK(!fs::exists(cacheDir / (keyB + ".out")));
+    CHECK(fs::exists(cacheDir / (keyC + ".out")));
+
+    std::cout << "Result cache OK." << std::endl;
+}
+
+void test_telemetry() {
+    std::cout << "Testing telemetry..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_telemetry", {"out"});
+
+    std::vector<std::wstring> inputs;
+    for (int i = 0; i < 3; ++i) {
+        cv::Mat img(40, 50, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        inputs.push_back(path.wstring());
+    }
+
+    // Disabled: nothing is collected, and instrumented code runs without a file
+    {
+        Core::EngineOptions opts;
+        opts.modelPath = dir.StubModel();
+        Core::Engine engine(opts);
+        CHECK(engine.Stats() == nullptr);
+        CHECK(Core::Telemetry::Current() == nullptr);
+    }
+
+    for (bool pipelined : {false, true}) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.inferenceWorkers = 2;
+        opts.pipelineBatch = pipelined;
+        opts.collectTrace = true;
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        Core::BatchSummary summary = engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr);
+        CHECK(summary.succeeded == 3);
+
+        Core::Telemetry::BatchReport report = engine.Stats()->Report();
+        CHECK(report.files.size() == 3);
+        size_t tilesPerImage = Core::ImageUtils::TileRects(cv::Size(50, 40), 16, 4).size();
+        for (size_t i = 0; i < report.files.size(); ++i) {
+            const Core::Telemetry::FileReport& file = report.files[i];
+            CHECK(file.ok);
+            CHECK(file.file == fs::path(inputs[i]).u8string()); // Input order, also when pipelined
+            CHECK(file.stats.Value(Core::Telemetry::Counter::Tiles) == tilesPerImage);
+            CHECK(file.stats.Value(Core::Telemetry::Counter::BytesRead) == fs::file_size(inputs[i]));
+            CHECK(file.stats.Value(Core::Telemetry::Counter::BytesWritten) > 0);
+            CHECK(file.stats.stageCalls[static_cast<size_t>(Core::Telemetry::Stage::Decode)] == 1);
+            CHECK(file.stats.stageCalls[static_cast<size_t>(Core::Telemetry::Stage::Encode)] == 1);
+            CHECK(file.stats.stageCalls[static_cast<size_t>(Core::Telemetry::Stage::Inference)] == tilesPerImage);
+            CHECK(file.wallMs > 0 && file.wallMs <= report.wallMs);
+        }
+        CHECK(report.totals.Value(Core::Telemetry::Counter::Tiles) == 3 * tilesPerImage);
+        CHECK(report.Peak(Core::Telemetry::Gauge::TileQueueDepth) >= 1);
+
+        std::ostringstream json, trace;
+        engine.Stats()->WriteJson(json);
+        engine.Stats()->WriteChromeTrace(trace);
+        CHECK(json.str().find("\"per_file\"") != std::string::npos);
+        CHECK(trace.str().find("\"name\": \"inference\"") != std::string::npos);
+    }
+    std::cout << "Telemetry OK." << std::endl;
+}
+
+void test_buffer_pool() {
+    std::cout << "Testing buffer pool..." << std::endl;
+    namespace fs = std::filesystem;
+
+    // Released buffers are handed out again; handles may outlive the pool
+    std::shared_ptr<void> survivor;
+    {
+        Core::BufferPool pool;
+        void* first = nullptr;
+        {
+            std::shared_ptr<void> a = pool.Acquire(100000);
+            first = a.get();
+            CHECK(reinterpret_cast<uintptr_t>(first) % 64 == 0);
+        }
+        std::shared_ptr<void> b = pool.Acquire(90000); // Same size class
+        CHECK(b.get() == first);
+        survivor = pool.Acquire(1 << 20);
+        Core::BufferPool::Stats stats = pool.GetStats();
+        CHECK(stats.acquired == 3 && stats.reused == 1 && stats.allocated == 2);
+    }
+    std::memset(survivor.get(), 0, 1 << 20);
+    survivor.reset();
+
+    TestDir dir("enhancer_test_buffer_pool", {"out"});
+
+    std::vector<std::wstring> inputs;
+    for (int i = 0; i < 4; ++i) {
+        cv::Mat img(40, 50, CV_8UC3);
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        inputs.push_back(path.wstring());
+    }
+
+    // After the first batch every scratch buffer comes from the pool
+    for (bool pipelined : {false, true}) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.pipelineBatch = pipelined;
+        opts.tileReuseBytes = 0; // Reused tiles would finish the second batch faster, with more images in flight
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr).succeeded == 4);
+        Core::BufferPool::Stats warm = engine.BufferPoolStats();
+        CHECK(warm.allocated > 0 && warm.reused > 0);
+
+        CHECK(engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr).succeeded == 4);
+        Core::BufferPool::Stats stats = engine.BufferPoolStats();
+        // How many images a pipelined batch keeps in flight depends on timing, so it may
+        // need a canvas or two more than the first batch did
+        if (pipelined) CHECK(stats.allocated - warm.allocated < stats.reused - warm.reused);
+        else CHECK(stats.allocated == warm.allocated);
+        CHECK(stats.reused > warm.reused);
+        CHECK(stats.bytesInUse == 0);
+    }
+
+    std::cout << "Buffer pool OK." << std::endl;
+}
+
+void test_job_server() {
+    std::cout << "Testing job server..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_job_server", {"out"});
+
+    cv::Mat img(40, 50, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    fs::path input = dir / "img.png";
+    CHECK(Core::ImageUtils::SaveImage(input.wstring(), img));
+    std::ifstream file(input, std::ios::binary);
+    std::vector<uint8_t> encoded((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Core::EngineOptions opts = StubEngineOptions(dir, 16);
+    opts.inferenceWorkers = 2;
+    Core::Engine engine(opts);
+    CHECK(engine.Initialize());
+
+    // Reference output, for checking that per-job overrides are applied
+    CHECK(engine.ProcessFile(input.wstring(), (dir / "ref.png").wstring()));
+    Core::EngineOptions crop = opts;
+    crop.mergeMode = Core::TileMergeMode::CropToCenter;
+    crop.strength = 0;
+    CHECK(engine.ProcessFile(input.wstring(), (dir / "ref_crop.png").wstring(), crop));
+
+    Core::JobServerOptions serverOpts;
+    serverOpts.socketPath = (dir / "jobs.sock").wstring();
+    serverOpts.concurrentJobs = 2;
+    serverOpts.queueDepth = 1; // Clients block on the queue
+    Core::JobServer server(engine, serverOpts);
+    CHECK(server.Start());
+
+    // Concurrent clients, by path and by bytes, some with overrides
+    const int clients = 6;
+    std::vector<Core::JobMessage> responses(clients);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i]() {
+            Core::JobMessage request;
+            request.Set("id", std::to_string(i));
+            request.Set("output", (dir / "out" / ("job" + std::to_string(i) + ".png")).u8string());
+            if (i % 2) request.payload = encoded;
+            else request.Set("input", input.u8string());
+            if (i % 3 == 2) {
+                request.Set("merge", "crop");
+                request.Set("strength", "0");
+            }
+            CHECK(Core::JobServer::Submit(serverOpts.socketPath, request, responses[i]));
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    cv::Mat ref = Core::ImageUtils::LoadImage((dir / "ref.png").wstring());
+    cv::Mat refCrop = Core::ImageUtils::LoadImage((dir / "ref_crop.png").wstring());
+    CHECK(cv::norm(ref, refCrop, cv::NORM_INF) > 0);
+    for (int i = 0; i < clients; ++i) {
+        const Core::JobMessage& response = responses[i];
+        CHECK(response.Get("status") == "ok");
+        CHECK(response.Get("id") == std::to_string(i));
+        CHECK(std::stod(response.Get("total_ms")) > 0);
+        CHECK(std::stoul(response.Get("tiles")) == Core::ImageUtils::TileRects(img.size(), 16, 4).size());
+        cv::Mat out = Core::ImageUtils::LoadImage((dir / "out" / ("job" + std::to_string(i) + ".png")).wstring());
+        CHECK(cv::norm(out, i % 3 == 2 ? refCrop : ref, cv::NORM_INF) == 0);
+    }
+
+    // Errors come back as responses; the connection stays usable
+    {
+        Core::JobMessage request, response;
+        request.Set("input", (dir / "missing.png").u8string());
+        request.Set("output", (dir / "out" / "missing.png").u8string());
+        CHECK(Core::JobServer::Submit(serverOpts.socketPath, request, response));
+        CHECK(response.Get("status") == "error");
+        request.Set("merge", "bogus");
+        CHECK(Core::JobServer::Submit(serverOpts.socketPath, request, response));
+        CHECK(response.Get("error").find("merge") != std::string::npos);
+    }
+
+    // A second server cannot take over a live socket
+    Core::JobServer second(engine, serverOpts);
+    CHECK(!second.Start());
+
+    Core::JobMessage shutdown, ack;
+    shutdown.Set("command", "shutdown");
+    CHECK(Core::JobServer::Submit(serverOpts.socketPath, shutdown, ack));
+    server.Wait();
+    server.Stop();
+    CHECK(!fs::exists(serverOpts.socketPath));
+
+    // A stale socket left by a dead server is replaced; any other file is never removed
+    {
+        Core::LocalSocket stale = Core::LocalSocket::Listen(serverOpts.socketPath, 1);
+        CHECK(stale.IsValid());
+    }
+    CHECK(fs::exists(serverOpts.socketPath));
+    {
+        Core::JobServer replacing(engine, serverOpts);
+        bool started = replacing.Start();
+        CHECK(started);
+    }
+    Core::JobServerOptions misdirected = serverOpts;
+    misdirected.socketPath = input.wstring();
+    Core::JobServer onFile(engine, misdirected);
+    bool started = onFile.Start();
+    CHECK(!started);
+    cv::Mat kept = Core::ImageUtils::LoadImage(input.wstring());
+    CHECK(kept.size() == img.size());
+
+#ifndef _WIN32
+    // A signal landing in a blocked read is retried, not taken for a closed connection
+    {
+        struct sigaction action = {};
+        struct sigaction previous = {};
+        action.sa_handler = [](int) {};
+        sigaction(SIGUSR1, &action, &previous); // No SA_RESTART: recv fails with EINTR
+        std::wstring path = (dir / "eintr.sock").wstring();
+        Core::LocalSocket listener = Core::LocalSocket::Listen(path, 1);
+        Core::LocalSocket client = Core::LocalSocket::Connect(path);
+        Core::LocalSocket accepted = listener.Accept();
+        std::atomic<bool> read{false};
+        uint32_t value = 0;
+        std::thread reader([&]() { read = accepted.ReadAll(&value, sizeof(value)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pthread_kill(reader.native_handle(), SIGUSR1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uint32_t sent = 42;
+        CHECK(client.WriteAll(&sent, sizeof(sent)));
+        reader.join();
+        CHECK(read && value == 42);
+        sigaction(SIGUSR1, &previous, nullptr);
+    }
+#endif
+
+    // A job without overrides keeps the server's own strength and merge mode
+    {
+        Core::EngineOptions soft = opts;
+        soft.strength = 0;
+        Core::Engine softEngine(soft);
+        bool ok = softEngine.Initialize();
+        CHECK(ok);
+        ok = softEngine.ProcessFile(input.wstring(), (dir / "ref_soft.png").wstring());
+        CHECK(ok);
+        cv::Mat refSoft = Core::ImageUtils::LoadImage((dir / "ref_soft.png").wstring());
+        CHECK(cv::norm(refSoft, ref, cv::NORM_INF) > 0);
+
+        serverOpts.socketPath = (dir / "soft.sock").wstring();
+        Core::JobServer softServer(softEngine, serverOpts);
+        ok = softServer.Start();
+        CHECK(ok);
+        Core::JobMessage request, response;
+        request.Set("input", input.u8string());
+        request.Set("output", (dir / "out" / "soft.png").u8string());
+        ok = Core::JobServer::Submit(serverOpts.socketPath, request, response);
+        CHECK(ok && response.Get("status") == "ok");
+        cv::Mat out = Core::ImageUtils::LoadImage((dir / "out" / "soft.png").wstring());
+        CHECK(cv::norm(out, refSoft, cv::NORM_INF) == 0);
+        ok = Core::JobServer::Submit(serverOpts.socketPath, shutdown, ack);
+        CHECK(ok);
+        softServer.Wait();
+        softServer.Stop();
+    }
+
+    std::cout << "Job server OK." << std::endl;
+}
+
+void test_in_memory_api() {
+    std::cout << "Testing in-memory API..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_in_memory");
+
+    const int w = 50, h = 40, scale = 2;
+    cv::Mat img(h, w, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    fs::path input = dir / "img.png";
+    CHECK(Core::ImageUtils::SaveImage(input.wstring(), img));
+
+    Core::EngineOptions opts = StubEngineOptions(dir, 16);
+    Core::Engine engine(opts);
+    CHECK(engine.Initialize());
+    CHECK(engine.ProcessFile(input.wstring(), (dir / "ref.png").wstring()));
+    cv::Mat ref = Core::ImageUtils::LoadImage((dir / "ref.png").wstring());
+
+    // BGR in and out, both with padded rows; the padding must stay untouched
+    {
+        size_t inStride = w * 3 + 7, outStride = w * scale * 3 + 13;
+        std::vector<uint8_t> in(inStride * h, 0);
+        for (int y = 0; y < h; ++y) std::memcpy(&in[y * inStride], img.ptr(y), w * 3);
+        std::vector<uint8_t> out(outStride * h * scale, 0xAB);
+        Core::ImageView inView(in.data(), w, h, Core::PixelFormat::BGR, inStride);
+        Core::ImageView outView(out.data(), w * scale, h * scale, Core::PixelFormat::BGR, outStride);
+        CHECK(engine.ProcessPixels(inView, outView));
+        cv::Mat result(h * scale, w * scale, CV_8UC3, out.data(), outStride);
+        CHECK(cv::norm(result, ref, cv::NORM_INF) == 0);
+        for (int y = 0; y < h * scale; ++y) {
+            for (size_t x = w * scale * 3; x < outStride; ++x) CHECK(out[y * outStride + x] == 0xAB);
+        }
+
+        // Output of the wrong size is rejected
+        Core::ImageView small(out.data(), w, h, Core::PixelFormat::BGR, outStride);
+        CHECK(!engine.ProcessPixels(inView, small));
+    }
+
+    // RGB in, RGBA out: same pixels, opaque alpha
+    {
+        cv::Mat rgb;
+        cv::cvtColor(img, rgb, cv::COLOR_BGR2RGB);
+        cv::Mat rgba(h * scale, w * scale, CV_8UC4);
+        Core::ImageView inView(rgb.data, w, h, Core::PixelFormat::RGB, rgb.step[0]);
+        Core::ImageView outView(rgba.data, w * scale, h * scale, Core::PixelFormat::RGBA, rgba.step[0]);
+        CHECK(engine.ProcessPixels(inView, outView));
+        cv::Mat bgr, alpha;
+        cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+        cv::extractChannel(rgba, alpha, 3);
+        CHECK(cv::norm(bgr, ref, cv::NORM_INF) == 0);
+        CHECK(cv::norm(alpha, cv::Mat(alpha.rows, alpha.cols, CV_8UC1, cv::Scalar(255)), cv::NORM_INF) == 0);
+    }
+
+    // Encoded bytes in, encoded bytes out
+    {
+        std::ifstream file(input, std::ios::binary);
+        std::vector<uint8_t> encoded((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<uint8_t> result;
+        CHECK(engine.ProcessEncoded(encoded.data(), encoded.size(), ".png", result, engine.Options()));
+        cv::Mat decoded = Core::ImageUtils::DecodeImage(result.data(), result.size());
+        CHECK(cv::norm(decoded, ref, cv::NORM_INF) == 0);
+        CHECK(!engine.ProcessEncoded(encoded.data(), 10, ".png", result, engine.Options()));
+    }
+
+    std::cout << "In-memory API OK." << std::endl;
+}
+
+void test_reorder_window() {
+    std::cout << "Testing ReorderWindow..." << std::endl;
+    const size_t count = 50;
+    Core::ReorderWindow<size_t> window(4);
+    std::atomic<size_t> next{0};
+
+    // Several producers finish out of order; the consumer must still see 0, 1, 2, ...
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 3; ++t) {
+        producers.emplace_back([&]() {
+            for (;;) {
+                size_t i = next.fetch_add(1);
+                if (i >= count || !window.WaitForSlot(i)) break;
+                window.Put(i, i * 10);
+            }
+        });
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t value = 0;
+        bool ok = window.Take(value);
+        CHECK(ok);
+        CHECK(value == i * 10);
+    }
+    window.Close();
+    for (auto& t : producers) t.join();
+
+    std::cout << "ReorderWindow OK." << std::endl;
+}
+
+void test_file_prefetch() {
+    std::cout << "Testing input mapping and prefetch..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_prefetch");
+
+    // LoadImage decodes from a mapping of the file
+    cv::Mat img(30, 40, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    std::vector<std::wstring> paths;
+    for (int i = 0; i < 6; ++i) {
+        fs::path p = dir / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(p.wstring(), img));
+        paths.push_back(p.wstring());
+    }
+    cv::Mat loaded = Core::ImageUtils::LoadImage(paths[0]);
+    CHECK(!loaded.empty() && cv::norm(loaded, img, cv::NORM_INF) == 0);
+    std::ofstream(dir / "empty.png").close();
+    CHECK(Core::ImageUtils::LoadImage((dir / "empty.png").wstring()).empty());
+    CHECK(Core::ImageUtils::LoadImage((dir / "missing.png").wstring()).empty());
+
+    auto waitFor = [](const Core::FilePrefetcher& prefetcher, size_t count) {
+        for (int i = 0; i < 500 && prefetcher.PrefetchedFiles() < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return prefetcher.PrefetchedFiles();
+    };
+    {
+        // Decoding file 0 reads files 1 and 2; jumping to 4 skips 3 and reads 5
+        Core::FilePrefetcher prefetcher(paths, 2);
+        prefetcher.Advance(0);
+        CHECK(waitFor(prefetcher, 2) == 2);
+        prefetcher.Advance(4);
+        CHECK(waitFor(prefetcher, 3) == 3);
+        prefetcher.Advance(5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(prefetcher.PrefetchedFiles() == 3);
+    }
+    {
+        Core::FilePrefetcher off(paths, 0);
+        off.Advance(0);
+        CHECK(off.PrefetchedFiles() == 0);
+    }
+
+    std::cout << "Input mapping and prefetch OK." << std::endl;
+}
+
+void test_autotune() {
+    std::cout << "Testing autotune..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_autotune");
+
+    Core::AutotuneOptions tune;
+    tune.modelPath = dir.StubModel();
+    tune.scale = 2;
+    tune.tileOverlap = 4;
+    tune.tileSizes = {4, 16, 24}; // 4 leaves nothing past the overlap
+    tune.batchSizes = {1, 2};
+    tune.workerCounts = {1, 2};
+    tune.secondsPerCandidate = 0.01;
+
+    Core::TuneProfile best;
+    CHECK(Core::Autotuner::Tune(tune, best));
+    CHECK(best.tileSize == 16 || best.tileSize == 24);
+    CHECK(best.tileBatchSize >= 1 && best.tileBatchSize <= 2);
+    CHECK(best.inferenceWorkers >= 1 && best.inferenceWorkers <= 2);
+    CHECK(best.pixelsPerSecond > 0);
+
+    // Only the smallest candidate fits this budget
+    tune.memoryBudgetBytes = Core::Autotuner::EstimateMemory(16, 1, 1, 2);
+    CHECK(Core::Autotuner::Tune(tune, best));
+    CHECK(best.tileSize == 16 && best.tileBatchSize == 1 && best.inferenceWorkers == 1);
+    tune.memoryBudgetBytes = 1;
+    CHECK(!Core::Autotuner::Tune(tune, best));
+
+    // Profiles round-trip and depend on the settings they were measured with
+    std::wstring path = Core::Autotuner::ProfilePath(dir.path.wstring(), tune);
+    tune.scale = 4;
+    CHECK(Core::Autotuner::ProfilePath(dir.path.wstring(), tune) != path);
+    best.tileSize = 24;
+    best.intraOpThreads = 3;
+    CHECK(Core::Autotuner::SaveProfile(path, best));
+    Core::TuneProfile loaded;
+    CHECK(Core::Autotuner::LoadProfile(path, loaded));
+    CHECK(loaded.tileSize == 24 && loaded.tileBatchSize == 1 && loaded.inferenceWorkers == 1 && loaded.intraOpThreads == 3);
+    std::ofstream(fs::path(path)) << "tile_size=zero\n";
+    CHECK(!Core::Autotuner::LoadProfile(path, loaded));
+    CHECK(!Core::Autotuner::LoadProfile((dir / "missing.tune").wstring(), loaded));
+
+    // The engine tunes on first use, then later engines load the stored profile
+    cv::Mat img(40, 50, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::SaveImage((dir / "in.png").wstring(), img));
+    Core::EngineOptions opts = StubEngineOptions(dir, 64);
+    opts.tuneProfileDir = (dir / "profiles").wstring();
+    opts.autotuneMemoryBytes = Core::Autotuner::EstimateMemory(128, 1, 1, 2);
+    {
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(!engine.UsedTuneProfile()); // autotune is off
+        CHECK(engine.Options().tileSize == 64);
+    }
+    opts.autotune = true;
+    {
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.UsedTuneProfile());
+        CHECK(engine.Options().tileSize == 128 && engine.Options().inferenceWorkers == 1);
+        CHECK(engine.ProcessFile((dir / "in.png").wstring(), (dir / "out.png").wstring()));
+    }
+    CHECK(std::distance(fs::directory_iterator(dir / "profiles"), fs::directory_iterator()) == 1);
+    opts.autotune = false;
+    {
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.UsedTuneProfile());
+        CHECK(engine.Options().tileSize == 128);
+    }
+    {
+        // Settings the caller chose explicitly are kept
+        opts.tileBatchSize = 3;
+        opts.explicitTuning.tileBatchSize = true;
+        opts.explicitTuning.tileSize = true;
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.UsedTuneProfile());
+        CHECK(engine.Options().tileSize == 64 && engine.Options().tileBatchSize == 3);
+        CHECK(engine.Options().inferenceWorkers == 1);
+    }
+
+    std::cout << "Autotune OK." << std::endl;
+}
+
+void test_model_precision() {
+    std::cout << "Testing model precision variants..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_precision", {"samples"});
+
+    std::wstring model = dir.StubModel();
+    CHECK(Core::ModelVariants::VariantPath(model, Core::ModelPrecision::FP32) == model);
+    CHECK(Core::ModelVariants::VariantPath(model, Core::ModelPrecision::INT8) == (dir / "stub.int8.onnx").wstring());
+    CHECK(Core::ModelVariants::VariantPath(model, Core::ModelPrecision::FP16) == (dir / "stub.fp16.onnx").wstring());
+
+    // PSNR: identical is infinite; an error of 0.1 everywhere is 20 dB; values are clamped
+    std::vector<float> a(300, 0.5f), b(300, 0.6f);
+    CHECK(std::isinf(Core::ModelVariants::Psnr(a.data(), a.data(), a.size())));
+    CHECK(std::abs(Core::ModelVariants::Psnr(a.data(), b.data(), a.size()) - 20.0) < 1e-3);
+    std::vector<float> over(300, 1.5f), one(300, 1.0f);
+    CHECK(std::isinf(Core::ModelVariants::Psnr(one.data(), over.data(), one.size())));
+
+    // Sample tiles: image centers, or one synthetic tile without images
+    CHECK(Core::ModelVariants::SampleTiles((dir / "samples").wstring(), 32, 4).size() == 1);
+    cv::Mat img(20, 50, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::SaveImage((dir / "samples" / "a.png").wstring(), img));
+    CHECK(Core::ImageUtils::SaveImage((dir / "samples" / "b.png").wstring(), img));
+    std::vector<cv::Mat> tiles = Core::ModelVariants::SampleTiles((dir / "samples").wstring(), 32, 1);
+    CHECK(tiles.size() == 1 && tiles[0].cols == 32 && tiles[0].rows == 20);
+    CHECK(cv::norm(tiles[0], img(cv::Rect(9, 0, 32, 20)), cv::NORM_INF) == 0);
+
+    Core::EngineOptions opts = StubEngineOptions(dir, 32);
+    opts.precision = Core::ModelPrecision::INT8;
+    opts.calibrationDir = (dir / "samples").wstring();
+    opts.modelCacheDir = (dir / "cache").wstring();
+    {
+        // No variant yet: FP32
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.LoadedPrecision() == Core::ModelPrecision::FP32);
+    }
+    std::ofstream(dir / "stub.int8.onnx").close();
+    {
+        // The stub variant matches the FP32 stub exactly, so it passes any threshold
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.LoadedPrecision() == Core::ModelPrecision::INT8);
+        CHECK(engine.ProcessFile((dir / "samples" / "a.png").wstring(), (dir / "out.png").wstring()));
+        cv::Mat out = Core::ImageUtils::LoadImage((dir / "out.png").wstring());
+        CHECK(out.cols == 100 && out.rows == 40);
+    }
+    {
+        // The check ran once and its result is cached: a stored low PSNR is trusted as is
+        std::vector<fs::path> verdicts;
+        for (const auto& entry : fs::directory_iterator(dir / "cache")) {
+            if (entry.path().extension() == ".psnr") verdicts.push_back(entry.path());
+        }
+        CHECK(verdicts.size() == 1);
+        double psnr = 0;
+        bool loaded = Core::ModelVariants::LoadVerdict(verdicts[0].wstring(), psnr);
+        CHECK(loaded && std::isinf(psnr));
+        bool saved = Core::ModelVariants::SaveVerdict(verdicts[0].wstring(), 10.0);
+        CHECK(saved);
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.LoadedPrecision() == Core::ModelPrecision::FP32);
+
+        // A different threshold is a different verdict
+        opts.minPrecisionPsnr = 30.0;
+        Core::Engine other(opts);
+        CHECK(other.Initialize());
+        CHECK(other.LoadedPrecision() == Core::ModelPrecision::INT8);
+    }
+
+    std::cout << "Model precision variants OK." << std::endl;
+}
+
+void test_output_publishing() {
+    std::cout << "Testing output publishing..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir test("enhancer_test_publish", {"files"});
+    fs::path dir = test / "files"; // Holds only what the test writes
+    auto fileCount = [&]() { return std::distance(fs::directory_iterator(dir), fs::directory_iterator()); };
+
+    // SaveImage leaves exactly the output behind; a failed save leaves nothing
+    cv::Mat img(12, 10, CV_8UC3);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::FormatFor(L"a/b.JPG") == ".JPG" && Core::ImageUtils::FormatFor(L"noext") == ".png");
+    CHECK(Core::ImageUtils::SaveImage((dir / "a.png").wstring(), img));
+    CHECK(fileCount() == 1);
+    CHECK(!Core::ImageUtils::SaveImage((dir / "missing" / "b.png").wstring(), img));
+    CHECK(fileCount() == 1);
+
+    // Streamed PNGs appear only once complete
+    {
+        auto writer = Core::RowWriter::ForPath((dir / "s.png").wstring());
+        CHECK(writer && writer->Open((dir / "s.png").wstring(), img.cols, img.rows));
+        CHECK(writer->WriteRows(img.rowRange(0, 6)));
+        CHECK(!fs::exists(dir / "s.png"));
+        CHECK(writer->WriteRows(img.rowRange(6, 12)));
+        CHECK(writer->Close());
+        CHECK(fs::exists(dir / "s.png") && fileCount() == 2);
+        cv::Mat back = Core::ImageUtils::LoadImage((dir / "s.png").wstring());
+        CHECK(cv::norm(back, img, cv::NORM_INF) == 0);
+    }
+    {
+        // Abandoned half way: neither the output nor the temporary file remains
+        Core::EncodeOptions encode;
+        encode.pngCompression = 9;
+        encode.pngStrategy = Core::PngStrategy::HuffmanOnly;
+        auto writer = Core::RowWriter::ForPath((dir / "t.png").wstring(), encode);
+        CHECK(writer && writer->Open((dir / "t.png").wstring(), img.cols, img.rows));
+        CHECK(writer->WriteRows(img.rowRange(0, 6)));
+        CHECK(!writer->Close());
+    }
+    CHECK(!fs::exists(dir / "t.png") && fileCount() == 2);
+
+    // Completion actions run in index order, whatever order the indices finish in
+    const size_t count = 200;
+    Core::InOrderCompletion completion;
+    std::vector<size_t> order;
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                if (i % 3 == 0) {
+                    completion.Done(i, nullptr); // Skipped indices must not block later ones
+                } else {
+                    completion.Done(i, [&order, i]() { order.push_back(i); });
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(order.size() == count - (count + 2) / 3);
+    for (size_t k = 1; k < order.size(); ++k) CHECK(order[k - 1] < order[k]);
+
+    // A slow action does not hold up other threads calling Done; their actions run after it
+    {
+        Core::InOrderCompletion slow;
+        std::atomic<bool> otherReturned{false};
+        std::vector<int> ran;
+        std::thread other;
+        slow.Done(0, [&]() {
+            other = std::thread([&]() {
+                slow.Done(1, [&ran]() { ran.push_back(1); });
+                otherReturned = true;
+            });
+            for (int i = 0; i < 2000 && !otherReturned; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ran.push_back(0);
+        });
+        other.join();
+        CHECK(otherReturned);
+        CHECK((ran == std::vector<int>{0, 1}));
+    }
+
+    std::cout << "Output publishing OK." << std::endl;
+}
+
+void test_work_queue() {
+    std::cout << "Testing work queue..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_queue", {"in", "out"});
+
+    std::vector<std::wstring> files, names;
+    cv::Mat img(16, 24, CV_8UC3);
+    for (int i = 0; i < 12; ++i) {
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / "in" / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        files.push_back(path.wstring());
+        names.push_back(path.filename().wstring());
+    }
+
+    // Three workers with their own queue and engine: every file is processed exactly once
+    Core::EngineOptions opts = StubEngineOptions(dir, 32);
+    std::atomic<int> processed{0};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 3; ++w) {
+        workers.emplace_back([&, w]() {
+            Core::WorkQueueOptions queueOpts;
+            queueOpts.dir = (dir / "queue").wstring();
+            queueOpts.workerId = "worker" + std::to_string(w);
+            Core::WorkQueue queue(queueOpts, names);
+            CHECK(queue.Open());
+            Core::Engine engine(opts);
+            CHECK(engine.Initialize());
+            Core::BatchSummary summary = engine.ProcessQueued(files, (dir / "out").wstring(), queue, nullptr);
+            CHECK(summary.failed == 0 && summary.succeeded == summary.totalFiles);
+            CHECK(queue.FinishedCount() == files.size());
+            processed += summary.totalFiles;
+        });
+    }
+    for (auto& t : workers) t.join();
+    CHECK(processed == 12);
+    CHECK(std::distance(fs::directory_iterator(dir / "out"), fs::directory_iterator()) == 12);
+
+    // A later worker finds nothing left to do
+    {
+        Core::WorkQueueOptions queueOpts;
+        queueOpts.dir = (dir / "queue").wstring();
+        Core::WorkQueue queue(queueOpts, names);
+        CHECK(queue.Open());
+        size_t index = 0;
+        CHECK(!queue.Claim(index));
+    }
+
+    // Leases of a worker that stops refreshing them are taken over after leaseTimeout
+    Core::WorkQueueOptions queueOpts;
+    queueOpts.dir = (dir / "queue2").wstring();
+    queueOpts.leaseTimeout = std::chrono::milliseconds(300);
+    std::vector<std::wstring> items = {L"a", L"b"};
+    {
+        queueOpts.workerId = "crashed";
+        Core::WorkQueue crashed(queueOpts, items);
+        CHECK(crashed.Open());
+        size_t index = 0;
+        CHECK(crashed.Claim(index));
+        CHECK(crashed.Claim(index));
+        // A crash leaves the leases behind; a clean exit removes them
+        fs::copy(dir / "queue2" / "lease", dir / "leases", fs::copy_options::recursive);
+    }
+    fs::copy(dir / "leases", dir / "queue2" / "lease", fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+    {
+        queueOpts.workerId = "survivor";
+        Core::WorkQueue survivor(queueOpts, items);
+        CHECK(survivor.Open());
+        auto start = std::chrono::steady_clock::now();
+        size_t first = 0, second = 0, third = 0;
+        CHECK(survivor.Claim(first));
+        CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(200));
+        survivor.Complete(first, true);
+        CHECK(survivor.Claim(second) && second != first);
+        survivor.Complete(second, false); // Failed items are not retried either
+        CHECK(!survivor.Claim(third));
+        CHECK(survivor.FinishedCount() == 2);
+    }
+
+    // A live worker keeps its lease past leaseTimeout through heartbeats
+    {
+        queueOpts.dir = (dir / "queue3").wstring();
+        queueOpts.workerId = "slow";
+        Core::WorkQueue slow(queueOpts, {L"a"});
+        CHECK(slow.Open());
+        size_t index = 0;
+        CHECK(slow.Claim(index));
+        std::this_thread::sleep_for(std::chrono::milliseconds(700));
+
+        queueOpts.workerId = "other";
+        Core::WorkQueue other(queueOpts, {L"a"});
+        CHECK(other.Open());
+        std::atomic<bool> claimed{false};
+        std::thread waiter([&]() {
+            size_t i = 0;
+            claimed = other.Claim(i);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(!claimed);
+        slow.Complete(index, true);
+        waiter.join();
+        CHECK(!claimed); // Finished by the first worker
+    }
+
+    // Heartbeats never bring back a lease that is gone, and a lost lease records no outcome
+    {
+        queueOpts.dir = (dir / "queue4").wstring();
+        queueOpts.workerId = "stalled";
+        Core::WorkQueue stalled(queueOpts, {L"a", L"b"});
+        CHECK(stalled.Open());
+        size_t first = 0, second = 0;
+        bool claimed = stalled.Claim(first) && stalled.Claim(second);
+        CHECK(claimed);
+        fs::path leases = dir / "queue4" / "lease";
+        std::vector<fs::path> paths;
+        for (const auto& entry : fs::recursive_directory_iterator(leases)) {
+            if (entry.is_regular_file()) paths.push_back(entry.path());
+        }
+        CHECK(paths.size() == 2);
+        fs::remove(paths[0]);
+        std::ofstream(paths[1], std::ios::trunc) << "other\n";
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        CHECK(!fs::exists(paths[0]));
+        std::ifstream owner(paths[1]);
+        std::string line;
+        std::getline(owner, line);
+        CHECK(line == "other");
+        bool completed = stalled.Complete(first, true);
+        CHECK(!completed);
+        completed = stalled.Complete(second, true);
+        CHECK(!completed);
+        CHECK(fs::is_empty(dir / "queue4" / "done" / paths[0].parent_path().filename()));
+        CHECK(fs::is_empty(dir / "queue4" / "done" / paths[1].parent_path().filename()));
+    }
+
+    std::cout << "Work queue OK." << std::endl;
+}
+
+void test_batch_journal() {
+    std::cout << "Testing batch journal..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_journal", {"in", "out"});
+
+    std::vector<std::wstring> files;
+    cv::Mat img(20, 30, CV_8UC3);
+    for (int i = 0; i < 4; ++i) {
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        fs::path path = dir / "in" / ("img" + std::to_string(i) + ".png");
+        CHECK(Core::ImageUtils::SaveImage(path.wstring(), img));
+        files.push_back(path.wstring());
+    }
+    std::ofstream(dir / "in" / "broken.png") << "not an image";
+    files.push_back((dir / "in" / "broken.png").wstring());
+
+    Core::EngineOptions opts = StubEngineOptions(dir, 32);
+    opts.journalPath = (dir / "journal").wstring();
+    auto run = [&](const Core::EngineOptions& o) {
+        Core::Engine engine(o);
+        CHECK(engine.Initialize());
+        return engine.ProcessBatch(files, (dir / "out").wstring(), nullptr);
+    };
+
+    // Failures are listed, not dropped
+    Core::BatchSummary summary = run(opts);
+    CHECK(summary.totalFiles == 5 && summary.succeeded == 4 && summary.failed == 1 && summary.resumed == 0);
+    CHECK(summary.failedFiles.size() == 1 && summary.failedFiles[0] == files[4]);
+
+    // Resume skips finished files; failed ones are retried. A torn last line is ignored.
+    std::ofstream(dir / "journal", std::ios::app) << "F\t1\tgarbage";
+    opts.resume = true;
+    summary = run(opts);
+    CHECK(summary.totalFiles == 5 && summary.resumed == 4 && summary.succeeded == 0 && summary.failed == 1);
+
+    // Changed inputs, missing outputs and other settings are processed again; also pipelined
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+    CHECK(Core::ImageUtils::SaveImage(files[0], img(cv::Rect(0, 0, 25, 20))));
+    fs::remove(dir / "out" / "img1_upscaled.png");
+    opts.pipelineBatch = true;
+    summary = run(opts);
+    CHECK(summary.resumed == 2 && summary.succeeded == 2 && summary.failed == 1);
+    CHECK(summary.failedFiles.size() == 1 && summary.failedFiles[0] == files[4]);
+    CHECK(Core::ImageUtils::LoadImage((dir / "out" / "img0_upscaled.png").wstring()).cols == 50);
+    opts.strength = 0.25;
+    summary = run(opts);
+    CHECK(summary.resumed == 0 && summary.succeeded == 4);
+    opts.pipelineBatch = false;
+
+    // A streamed output continues after its last durable band
+    fs::remove_all(dir / "in");
+    fs::create_directories(dir / "in");
+    cv::Mat tall(200, 40, CV_8UC3);
+    cv::randu(tall, cv::Scalar::all(0), cv::Scalar::all(255));
+    files = {(dir / "in" / "tall.png").wstring()};
+    CHECK(Core::ImageUtils::SaveImage(files[0], tall));
+    opts.strength = 0.5;
+    opts.maxMemoryBytes = 1; // One tile row per band
+    opts.resume = false;
+    opts.journalPath.clear();
+    CHECK(run(opts).succeeded == 1);
+    fs::path output = dir / "out" / "tall_upscaled.png";
+    cv::Mat expected = Core::ImageUtils::LoadImage(output.wstring());
+    fs::remove(output);
+
+    // Interrupted: every band is written, but the output cannot be published
+    opts.journalPath = (dir / "journal").wstring();
+    fs::create_directories(output / "blocked");
+    CHECK(run(opts).failed == 1);
+    CHECK(fs::exists(dir / "out" / "tall_upscaled.png.partial"));
+    fs::remove_all(output);
+
+    // Keep only the first bands, as if the process had died there
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(dir / "journal");
+        std::string line;
+        int bands = 0;
+        while (std::getline(in, line)) {
+            if (line[0] == 'B' && ++bands > 3) continue;
+            if (line[0] != 'F') lines.push_back(line);
+        }
+        CHECK(bands > 5);
+    }
+    {
+        std::ofstream out(dir / "journal", std::ios::trunc);
+        for (const auto& line : lines) out << line << "\n";
+    }
+
+    opts.resume = true;
+    opts.collectStats = true;
+    {
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        summary = engine.ProcessBatch(files, (dir / "out").wstring(), nullptr);
+        CHECK(summary.succeeded == 1);
+        uint64_t tiles = engine.Stats()->Report().totals.Value(Core::Telemetry::Counter::Tiles);
+        CHECK(tiles > 0 && tiles < 2 * Core::ImageUtils::TileOrigins(200, 32, 4).size());
+    }
+    CHECK(!fs::exists(dir / "out" / "tall_upscaled.png.partial"));
+    cv::Mat out = Core::ImageUtils::LoadImage(output.wstring());
+    CHECK(out.size() == expected.size() && cv::norm(out, expected, cv::NORM_INF) == 0);
+
+    std::cout << "Batch journal OK." << std::endl;
+}
+
+void test_incremental_sync() {
+    std::cout << "Testing incremental sync..." << std::endl;
+    namespace fs = std::filesystem;
+    TestDir dir("enhancer_test_sync");
+    fs::path in = dir / "in";
+    fs::create_directories(in / "sub" / "deeper");
+    fs::create_directories(in / "out");
+
+    cv::Mat img(12, 14, CV_8UC3);
+    auto write = [&](const fs::path& path) {
+        // Through the PNG row writer, which always writes real PNG signatures
+        cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+        auto writer = Core::RowWriter::ForPath(path.wstring());
+        CHECK(writer && writer->Open(path.wstring(), img.cols, img.rows));
+        CHECK(writer->WriteRows(img) && writer->Close());
+    };
+    write(in / "a.png");
+    write(in / "sub" / "b.PNG");
+    write(in / "sub" / "deeper" / "c.png");
+    write(in / "a_upscaled.png");  // An earlier output
+    write(in / "out" / "d.png");   // Inside the excluded output tree
+    std::ofstream(in / "notes.txt") << "text";
+    std::ofstream(in / "fake.png") << "not really an image";
+
+    // Names and extensions decide without opening anything
+    Core::ScanOptions scanOpts;
+    scanOpts.root = in.wstring();
+    scanOpts.excludeDirs = {(in / "out").wstring()};
+    std::vector<Core::ScannedFile> files = Core::DirectoryScan::Scan(scanOpts);
+    std::vector<std::wstring> names;
+    for (const auto& file : files) names.push_back(fs::path(file.relative).generic_wstring());
+    CHECK((names == std::vector<std::wstring>{L"a.png", L"fake.png", L"sub/b.PNG", L"sub/deeper/c.png"}));
+    CHECK(files[0].size == fs::file_size(in / "a.png"));
+    scanOpts.recursive = false;
+    CHECK(Core::DirectoryScan::Scan(scanOpts).size() == 2); // a and fake
+    scanOpts.recursive = true;
+    CHECK(Core::DirectoryScan::HasImageSignature((in / "a.png").wstring()));
+    CHECK(!Core::DirectoryScan::HasImageSignature((in / "fake.png").wstring()));
+
+    // First run: everything is new; the signature check rejects the fake
+    std::wstring manifestPath = (dir / "manifest").wstring();
+    Core::SyncPlan plan;
+    {
+        Core::SyncManifest manifest(manifestPath, "settings");
+        CHECK(!manifest.Load());
+        plan = manifest.Plan(files, 3);
+        CHECK(plan.added == 3 && plan.rejected == 1 && plan.unchanged == 0 && plan.process.size() == 3);
+
+        // Mirrored outputs, then only successful files go into the manifest
+        Core::EngineOptions opts = StubEngineOptions(dir, 32);
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        std::vector<std::wstring> inputs, outputs;
+        for (size_t index : plan.process) {
+            fs::path outDir = dir / "mirror" / fs::path(files[index].relative).parent_path();
+            fs::create_directories(outDir);
+            inputs.push_back(files[index].path);
+            outputs.push_back(Core::Engine::OutputPathFor(files[index].path, outDir.wstring()));
+        }
+        Core::BatchSummary summary = engine.ProcessBatch(inputs, outputs, nullptr);
+        CHECK(summary.succeeded == 3);
+        CHECK(fs::exists(dir / "mirror" / "sub" / "deeper" / "c_upscaled.png"));
+        CHECK(fs::exists(dir / "mirror" / "sub" / "b_upscaled.PNG"));
+        for (size_t k = 0; k < plan.process.size(); ++k) manifest.Update(files[plan.process[k]], plan.hashes[k]);
+        CHECK(manifest.Save());
+    }
+
+    // Second run: nothing to do
+    {
+        Core::SyncManifest manifest(manifestPath, "settings");
+        CHECK(manifest.Load() && manifest.Size() == 3);
+        plan = manifest.Plan(files, 3);
+        CHECK(plan.unchanged == 3 && plan.process.empty() && plan.rejected == 1);
+    }
+
+    // Touched, modified and removed files
+    fs::last_write_time(in / "sub" / "b.PNG", fs::last_write_time(in / "sub" / "b.PNG") + std::chrono::seconds(10));
+    write(in / "sub" / "deeper" / "c.png");
+    fs::last_write_time(in / "sub" / "deeper" / "c.png", fs::last_write_time(in / "sub" / "deeper" / "c.png") + std::chrono::seconds(10));
+    fs::remove(in / "a.png");
+    files = Core::DirectoryScan::Scan(scanOpts);
+    {
+        Core::SyncManifest manifest(manifestPath, "settings");
+        CHECK(manifest.Load());
+        plan = manifest.Plan(files, 3);
+        CHECK(plan.touched == 1 && plan.modified == 1 && plan.removed == 1 && plan.unchanged == 0);
+        CHECK(plan.process.size() == 1 && files[plan.process[0]].relative == (fs::path("sub") / "deeper" / "c.png").wstring());
+        CHECK(manifest.Size() == 2);
+    }
+
+    // A directory the scan could not read keeps its entries
+    {
+        std::vector<std::wstring> unreadable;
+        files = Core::DirectoryScan::Scan(scanOpts, &unreadable);
+        CHECK(unreadable.empty());
+        std::vector<Core::ScannedFile> partial;
+        for (const auto& file : files) {
+            if (fs::path(file.relative).begin()->wstring() != L"sub") partial.push_back(file);
+        }
+        Core::SyncManifest manifest(manifestPath, "settings");
+        bool loaded = manifest.Load();
+        CHECK(loaded && manifest.Size() == 3);
+        plan = manifest.Plan(partial, 3, {L"sub"});
+        CHECK(plan.removed == 1 && plan.unlisted == 2 && manifest.Size() == 2);
+    }
+
+    // Other settings: every input is new again
+    {
+        Core::SyncManifest manifest(manifestPath, "other settings");
+        CHECK(!manifest.Load());
+        CHECK(manifest.Plan(files, 1).added == 2);
+    }
+
+    // Malformed lines are skipped, the rest of the manifest still loads
+    {
+        {
+            std::ofstream out(dir / "damaged", std::ios::binary);
+            out << "enhancer-manifest 1 settings\n"
+                << "00000000000000ff\t10\t20\tgood.png\n"
+                << "not-hex\t10\t20\tbad-hash.png\n"
+                << "ff\t-1\t20\tbad-size.png\n"
+                << "ff\t10\t20x\tbad-time.png\n"
+                << "ff\t10\t20\n"
+                << "ff\t\t20\tempty-size.png\n";
+        }
+        Core::SyncManifest manifest((dir / "damaged").wstring(), "settings");
+        CHECK(manifest.Load());
+        CHECK(manifest.Size() == 1 && manifest.Ignored() == 5);
+    }
+
+    // A different model file is other settings too, even without a result cache or journal
+    {
+        Core::EngineOptions opts = StubEngineOptions(dir, 32);
+        std::string key;
+        {
+            Core::Engine engine(opts);
+            bool ok = engine.Initialize();
+            CHECK(ok);
+            key = engine.OutputSettingsKey();
+        }
+        Core::SyncManifest manifest(manifestPath, key);
+        plan = manifest.Plan(files, 1);
+        for (size_t k = 0; k < plan.process.size(); ++k) manifest.Update(files[plan.process[k]], plan.hashes[k]);
+        bool saved = manifest.Save();
+        CHECK(saved);
+
+        std::ofstream(dir / "stub.onnx", std::ios::binary) << "retrained";
+        Core::Engine engine(opts);
+        bool ok = engine.Initialize();
+        CHECK(ok && engine.OutputSettingsKey() != key);
+        Core::SyncManifest swapped(manifestPath, engine.OutputSettingsKey());
+        CHECK(!swapped.Load());
+        plan = swapped.Plan(files, 1);
+        CHECK(plan.added == 2 && plan.process.size() == 2);
+    }
+
+    std::cout << "Incremental sync OK." << std::endl;
+}
+
+void test_tile_skipping() {
+    std::cout << "Testing tile skipping..." << std::endl;
+    namespace fs = std::filesystem;
+    using Core::Telemetry::Counter;
+    TestDir dir("enhancer_test_tile_skip", {"out"});
+
+    // Left: a pattern repeating with the tile stride (12), so its tiles are identical.
+    // Top right: one colour. Bottom right: noise.
+    cv::Mat img(60, 100, CV_8UC3);
+    cv::Mat noise(60, 100, CV_8UC3);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(255));
+    for (int y = 0; y < img.rows; ++y) {
+        for (int x = 0; x < img.cols; ++x) {
+            cv::Vec3b& px = img.at<cv::Vec3b>(y, x);
+            if (x < 48) px = noise.at<cv::Vec3b>(y % 12, x % 12);
+            else if (y < 30) px = cv::Vec3b(40, 120, 200);
+            else px = noise.at<cv::Vec3b>(y, x);
+        }
+    }
+    std::vector<std::wstring> inputs;
+    for (const char* name : {"a.png", "b.png"}) {
+        inputs.push_back((dir / name).wstring());
+        CHECK(Core::ImageUtils::SaveImage(inputs.back(), img));
+    }
+    size_t tileCount = Core::ImageUtils::TileRects(img.size(), 16, 4).size();
+
+    auto run = [&](size_t reuseBytes, int flatTolerance, int tileBatch, std::vector<Core::Telemetry::Stats>& stats) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.tileBatchSize = tileBatch;
+        opts.inferenceWorkers = 2;
+        opts.tileReuseBytes = reuseBytes;
+        opts.flatTileTolerance = flatTolerance;
+        opts.collectStats = true;
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.ProcessBatch(inputs, (dir / "out").wstring(), nullptr).succeeded == 2);
+        stats.clear();
+        for (const auto& file : engine.Stats()->Report().files) stats.push_back(file.stats);
+        std::ostringstream json;
+        engine.Stats()->WriteJson(json);
+        CHECK(json.str().find("\"tile_skip_ratio\"") != std::string::npos);
+        return Core::ImageUtils::LoadImage((dir / "out" / "b_upscaled.png").wstring());
+    };
+
+    // Reference: every tile inferred
+    std::vector<Core::Telemetry::Stats> stats;
+    cv::Mat expected = run(0, -1, 1, stats);
+    CHECK(stats[0].Value(Counter::Tiles) == tileCount && stats[1].Value(Counter::Tiles) == tileCount);
+    CHECK(stats[0].TileSkipRatio() == 0);
+
+    for (int tileBatch : {1, 3}) {
+        // Repeated tiles reuse the first one's output, the second image reuses the first's
+        // and single-colour tiles are filled: all bit for bit
+        cv::Mat out = run(256 << 20, 0, tileBatch, stats);
+        CHECK(cv::norm(out, expected, cv::NORM_INF) == 0);
+        uint64_t filled = stats[0].Value(Counter::TilesFilled);
+        uint64_t reused = stats[0].Value(Counter::TilesReused);
+        CHECK(filled > 0 && reused > 0);
+        CHECK(stats[0].Value(Counter::Tiles) + filled + reused == tileCount);
+        CHECK(stats[0].TileSkipRatio() > 0 && stats[0].TileSkipRatio() < 1);
+        CHECK(stats[1].Value(Counter::Tiles) == 0 && stats[1].TileSkipRatio() == 1);
+    }
+
+    // One budget covers cached outputs and those jobs reserve for themselves
+    {
+        Core::TileOutputCache cache(1000);
+        cv::Mat tile(4, 4, CV_8UC3);
+        tile.setTo(cv::Scalar(1, 2, 3));
+        std::vector<float> output(100, 0.5f); // With the tile, 448 bytes
+        uint64_t hash = Core::TileOutputCache::TileHash(tile);
+        CHECK(cache.Insert(hash, tile, 2, output.data(), output.size(), false) != nullptr);
+        CHECK(cache.Find(hash, tile, 2) != nullptr && cache.Find(hash, tile, 4) == nullptr);
+        bool reserved = cache.Reserve(600);
+        CHECK(reserved);
+        CHECK(cache.Find(hash, tile, 2) == nullptr); // Evicted for the reservation
+        CHECK(cache.Insert(hash, tile, 2, output.data(), output.size(), false) == nullptr);
+        CHECK(cache.Insert(hash, tile, 2, output.data(), output.size(), true) != nullptr);
+        reserved = cache.Reserve(500);
+        CHECK(!reserved);
+        cache.Release(600);
+        CHECK(cache.Insert(hash, tile, 2, output.data(), output.size(), false) != nullptr);
+    }
+
+    // Too small a budget to keep any output: nothing is reused, results are unchanged
+    CHECK(cv::norm(run(64, -1, 1, stats), expected, cv::NORM_INF) == 0);
+    CHECK(stats[0].Value(Counter::TilesReused) == 0 && stats[0].Value(Counter::Tiles) == tileCount);
+
+    // Near-constant tiles are filled with their mean within the tolerance
+    for (int y = 0; y < 30; ++y) {
+        for (int x = 48; x < img.cols; ++x) img.at<cv::Vec3b>(y, x)[(x + y) % 3] += (x * 7 + y * 3) % 4;
+    }
+    for (const auto& input : inputs) CHECK(Core::ImageUtils::SaveImage(input, img));
+    cv::Mat exact = run(0, -1, 1, stats);
+    cv::Mat filled = run(0, 4, 1, stats);
+    CHECK(stats[0].Value(Counter::TilesFilled) > 0 && stats[0].Value(Counter::TilesReused) == 0);
+    CHECK(cv::norm(filled, exact, cv::NORM_INF) <= 4);
+
+    std::cout << "Tile skipping OK." << std::endl;
+}
+
+void test_adaptive_routing() {
+    std::cout << "Testing adaptive tile routing..." << std::endl;
+    namespace fs = std::filesystem;
+    using Core::Telemetry::Counter;
+    TestDir dir("enhancer_test_adaptive");
+
+    // Left: a smooth gradient. Right: noise.
+    cv::Mat img(60, 100, CV_8UC3);
+    cv::Mat noise(60, 100, CV_8UC3);
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(255));
+    for (int y = 0; y < img.rows; ++y) {
+        for (int x = 0; x < img.cols; ++x) {
+            img.at<cv::Vec3b>(y, x) = x < 48 ? cv::Vec3b(x + 60, y + 80, x + y + 20) : noise.at<cv::Vec3b>(y, x);
+        }
+    }
+    fs::path input = dir / "in.png";
+    fs::path output = dir / "out.png";
+    CHECK(Core::ImageUtils::SaveImage(input.wstring(), img));
+    CHECK(Core::TileDetail(img(cv::Rect(0, 0, 16, 16))) < 5);
+    CHECK(Core::TileDetail(img(cv::Rect(60, 0, 16, 16))) > 1000);
+    size_t tileCount = Core::ImageUtils::TileRects(img.size(), 16, 4).size();
+
+    auto run = [&](double threshold, Core::Telemetry::Stats& stats, double sharpen = 0) {
+        Core::EngineOptions opts = StubEngineOptions(dir, 16);
+        opts.inferenceWorkers = 2;
+        opts.tileBatchSize = 3;
+        opts.tileReuseBytes = 0;
+        opts.detailThreshold = threshold;
+        opts.lowDetailSharpen = sharpen;
+        opts.collectStats = true;
+        Core::Engine engine(opts);
+        CHECK(engine.Initialize());
+        CHECK(engine.ProcessFile(input.wstring(), output.wstring()));
+        stats = engine.Stats()->Report().totals;
+        return Core::ImageUtils::LoadImage(output.wstring());
+    };
+
+    Core::Telemetry::Stats stats;
+    cv::Mat expected = run(0, stats);
+    CHECK(stats.Value(Counter::Tiles) == tileCount && stats.Value(Counter::TilesResampled) == 0);
+
+    // Smooth tiles take the cheap path; detailed ones, and pixels only they cover, are unchanged
+    cv::Mat out = run(20, stats);
+    CHECK(out.size() == expected.size());
+    CHECK(stats.Value(Counter::TilesResampled) > 0 && stats.Value(Counter::Tiles) > 0);
+    CHECK(stats.Value(Counter::Tiles) + stats.Value(Counter::TilesResampled) == tileCount);
+    CHECK(stats.TileSkipRatio() > 0 && stats.TileSkipRatio() < 1);
+    cv::Rect detailed(120, 0, 80, 120);
+    CHECK(cv::norm(out(detailed), expected(detailed), cv::NORM_INF) == 0);
+    double error = 0;
+    for (int y = 0; y < out.rows; ++y) {
+        for (int x = 0; x < 96; ++x) {
+            for (int c = 0; c < 3; ++c) error += std::abs(out.at<cv::Vec3b>(y, x)[c] - expected.at<cv::Vec3b>(y, x)[c]);
+        }
+    }
+    CHECK(error / (out.rows * 96 * 3) < 2.0);
+
+    // An extra unsharp mask on resampled tiles leaves the inferred ones alone
+    out = run(20, stats, 1.0);
+    CHECK(cv::norm(out(detailed), expected(detailed), cv::NORM_INF) == 0);
+
+    // Every tile resampled: no inference at all
+    out = run(1e9, stats);
+    CHECK(out.size() == expected.size());
+    CHECK(stats.Value(Counter::Tiles) == 0 && stats.Value(Counter::TilesResampled) == tileCount);
+
+    std::cout << "Adaptive tile routing OK." << std::endl;
+}
+
 int main() {
     test_tiling();
     test_preprocess();
+    test_postprocess();
+    test_merge_tiles();
+    test_blending_identity();
+    test_unsharp_mask();
+    test_streaming();
+    test_parallel_workers();
+    test_hash_and_mapping();
+    test_result_cache();
+    test_telemetry();
+    test_buffer_pool();
+    test_job_server();
+    test_in_memory_api();
+    test_file_prefetch();
+    test_autotune();
+    test_model_precision();
+    test_output_publishing();
+    test_work_queue();
+    test_batch_journal();
+    test_incremental_sync();
+    test_tile_skipping();
+    test_adaptive_routing();
+    test_reorder_window();
     std::cout << "All tests passed!" << std::endl;
     return 0;
 }